@@ -0,0 +1,433 @@
+#ifndef LAGRANGE_ASSEMBLY
+#define LAGRANGE_ASSEMBLY
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Run body(tid, begin, end) on nthreads threads, thread tid taking the
+/// contiguous chunk [begin, end) of [0, n). The calling thread runs chunk 0
+/// and the call returns when all chunks are done.
+void LG_ParallelFor(
+    const int nthreads,
+    const int n,
+    const std::function<void(int, int, int)> &body);
+
+/// Run body(tid, begin, end) over the consecutive ranges [offsets[r],
+/// offsets[r+1]) one after the other, thread tid taking the contiguous chunk
+/// [begin, end) of every range (indices into [offsets[0], offsets[last])).
+/// The nthreads threads are started once and meet at a barrier between two
+/// ranges, so no two ranges run at the same time.
+void LG_ParallelForRanges(
+    const int nthreads,
+    const Array<int> &offsets,
+    const std::function<void(int, int, int)> &body);
+
+/// Reusable barrier for a fixed number of threads
+class LG_Barrier
+{
+protected:
+  std::mutex mutex;
+  std::condition_variable cv;
+  int nthreads, count;
+  long generation;
+
+public:
+  LG_Barrier(const int nthreads);
+
+  /// Block until all the threads have called Wait
+  void Wait();
+};
+
+/// Shared memory assembly of the global matrix and vector of a scalar
+/// conforming FiniteElementSpace.
+///
+/// The elements are greedily colored so that no two elements of one color
+/// share a dof. The colors are assembled one after the other, and the
+/// elements of a color are split among the threads. The threads add their
+/// element matrices straight into the rows of a SparseMatrix whose
+/// sparsity pattern is built once in the constructor: the coloring makes
+/// the rows a thread writes exclusive, so the merge needs no locks or
+/// atomics.
+///
+/// BilinearFormIntegrators keep scratch data, so every thread needs its own
+/// integrator: the Assemble calls take one integrator per thread. Element
+/// transformations are thread local too, and the LG elements only use
+/// stack scratch in CalcShape/CalcDShape. IntRules.Get fills its tables on
+/// first use and is not thread safe, so one element of every geometry is
+/// assembled serially before the threads start, which fetches the rules
+/// the integrators pick. The threads are started once per Assemble call and
+/// synchronize between the colors (LG_ParallelForRanges).
+///
+/// On curved meshes (mesh->GetNodes() set) the element transformations read
+/// the shared nodal GridFunction and are not thread safe, so the elements
+/// are assembled on one thread there (with integs[0]).
+class LG_ThreadedAssembler
+{
+protected:
+  const FiniteElementSpace *fes;
+  int nthreads, ne, ndofs;
+  Array<int> elem_offsets, elem_dofs;    // element to dof table
+  Array<int> color_offsets, color_elems; // elements grouped by color
+  Array<int> I, J;                       // sparsity pattern (CSR)
+  Array<int> geom_elems;                 // one element of every geometry
+
+  // color the elements using the dof to element table
+  void ColorElements(const Array<int> &dof_offsets, const Array<int> &dof_elems);
+  // build I and J (sorted rows) from the dof to element table
+  void BuildSparsity(const Array<int> &dof_offsets, const Array<int> &dof_elems);
+  // threads of the element loops: one on curved meshes, see above
+  int GetAssemblyThreads() const
+  { return fes->GetMesh()->GetNodes() ? 1 : nthreads; }
+
+public:
+  LG_ThreadedAssembler(const FiniteElementSpace *fes, const int nthreads);
+
+  int GetNumThreads() const
+  { return nthreads; }
+  int GetNumColors() const
+  { return color_offsets.Size() - 1; }
+
+  /// Assemble the element matrices of integs[t] (one integrator per thread)
+  /// into a new SparseMatrix with the precomputed sparsity pattern
+  SparseMatrix *AssembleMatrix(
+      const Array<BilinearFormIntegrator*> &integs) const;
+  /// Assemble the element vectors of integs[t] (one per thread) into b
+  void AssembleVector(
+      const Array<LinearFormIntegrator*> &integs,
+      Vector &b) const;
+};
+
+
+void LG_ParallelFor(
+    const int nthreads,
+    const int n,
+    const std::function<void(int, int, int)> &body)
+{
+  std::vector<std::thread> threads;
+  for (int t = 1; t < nthreads; t++)
+  {
+    threads.push_back(std::thread(body, t, (t*long(n))/nthreads,
+                                  ((t + 1)*long(n))/nthreads));
+  }
+  body(0, 0, n/max(nthreads, 1));
+  for (size_t t = 0; t < threads.size(); t++)
+  {
+    threads[t].join();
+  }
+}
+
+void LG_ParallelForRanges(
+    const int nthreads,
+    const Array<int> &offsets,
+    const std::function<void(int, int, int)> &body)
+{
+  const int nranges = offsets.Size() - 1;
+  LG_Barrier barrier(nthreads);
+  auto worker = [&](int t)
+  {
+    for (int r = 0; r < nranges; r++)
+    {
+      const long first = offsets[r], n = offsets[r+1] - first;
+      body(t, first + (t*n)/nthreads, first + ((t + 1)*n)/nthreads);
+      if (r + 1 < nranges)
+        barrier.Wait();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 1; t < nthreads; t++)
+  {
+    threads.push_back(std::thread(worker, t));
+  }
+  worker(0);
+  for (size_t t = 0; t < threads.size(); t++)
+  {
+    threads[t].join();
+  }
+}
+
+
+// LG_Barrier implementation
+LG_Barrier::LG_Barrier(const int nthreads_)
+   : nthreads(nthreads_), count(0), generation(0)
+{
+}
+
+void LG_Barrier::Wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  const long gen = generation;
+  if (++count == nthreads)
+  {
+    // the last thread releases this generation
+    count = 0;
+    generation++;
+    cv.notify_all();
+  }
+  else
+  {
+    cv.wait(lock, [&] { return generation != gen; });
+  }
+}
+
+
+// LG_ThreadedAssembler implementation
+LG_ThreadedAssembler::LG_ThreadedAssembler(
+    const FiniteElementSpace *fes_,
+    const int nthreads_)
+   : fes(fes_), nthreads(nthreads_)
+{
+  MFEM_VERIFY(nthreads >= 1, "at least one thread is needed");
+  MFEM_VERIFY(fes->GetVDim() == 1, "scalar spaces only");
+  MFEM_VERIFY(fes->GetConformingProlongation() == NULL,
+      "LG_ThreadedAssembler requires a conforming space");
+
+  ne = fes->GetNE();
+  ndofs = fes->GetVSize();
+
+  // element to dof table
+  Array<int> dofs;
+  std::vector<bool> geom_seen(Geometry::NumGeom, false);
+  elem_offsets.SetSize(ne + 1);
+  elem_offsets[0] = 0;
+  for (int e = 0; e < ne; e++)
+  {
+    elem_offsets[e+1] = elem_offsets[e] + fes->GetFE(e)->GetDof();
+    const int geom = fes->GetFE(e)->GetGeomType();
+    if (!geom_seen[geom])
+    {
+      geom_seen[geom] = true;
+      geom_elems.Append(e);
+    }
+  }
+  elem_dofs.SetSize(elem_offsets[ne]);
+  for (int e = 0; e < ne; e++)
+  {
+    fes->GetElementDofs(e, dofs);
+    for (int i = 0; i < dofs.Size(); i++)
+    {
+      MFEM_VERIFY(dofs[i] >= 0, "signed dofs are not supported");
+      elem_dofs[elem_offsets[e] + i] = dofs[i];
+    }
+  }
+
+  // dof to element table, the transpose of the above
+  Array<int> dof_offsets(ndofs + 1), dof_elems(elem_dofs.Size());
+  dof_offsets = 0;
+  for (int k = 0; k < elem_dofs.Size(); k++)
+    dof_offsets[elem_dofs[k] + 1]++;
+  for (int i = 0; i < ndofs; i++)
+    dof_offsets[i+1] += dof_offsets[i];
+  Array<int> pos(ndofs);
+  for (int i = 0; i < ndofs; i++)
+    pos[i] = dof_offsets[i];
+  for (int e = 0; e < ne; e++)
+    for (int k = elem_offsets[e]; k < elem_offsets[e+1]; k++)
+      dof_elems[pos[elem_dofs[k]]++] = e;
+
+  ColorElements(dof_offsets, dof_elems);
+  BuildSparsity(dof_offsets, dof_elems);
+}
+
+void LG_ThreadedAssembler::ColorElements(
+    const Array<int> &dof_offsets,
+    const Array<int> &dof_elems)
+{
+  // greedy: the first color not used by an element sharing a dof
+  Array<int> color(ne), mark;
+  color = -1;
+  int ncolors = 0;
+  for (int e = 0; e < ne; e++)
+  {
+    for (int k = elem_offsets[e]; k < elem_offsets[e+1]; k++)
+    {
+      const int d = elem_dofs[k];
+      for (int m = dof_offsets[d]; m < dof_offsets[d+1]; m++)
+      {
+        const int c = color[dof_elems[m]];
+        if (c >= 0)
+          mark[c] = e;
+      }
+    }
+    int c = 0;
+    while (c < ncolors && mark[c] == e)
+      c++;
+    if (c == ncolors)
+    {
+      mark.Append(-1);
+      ncolors++;
+    }
+    color[e] = c;
+  }
+
+  color_offsets.SetSize(ncolors + 1);
+  color_offsets = 0;
+  for (int e = 0; e < ne; e++)
+    color_offsets[color[e] + 1]++;
+  for (int c = 0; c < ncolors; c++)
+    color_offsets[c+1] += color_offsets[c];
+  Array<int> pos(ncolors);
+  for (int c = 0; c < ncolors; c++)
+    pos[c] = color_offsets[c];
+  color_elems.SetSize(ne);
+  for (int e = 0; e < ne; e++)
+    color_elems[pos[color[e]]++] = e;
+}
+
+void LG_ThreadedAssembler::BuildSparsity(
+    const Array<int> &dof_offsets,
+    const Array<int> &dof_elems)
+{
+  // row i couples to the dofs of all elements containing i; rows are
+  // independent, so both passes run in parallel with a marker per thread
+  I.SetSize(ndofs + 1);
+  I[0] = 0;
+  LG_ParallelFor(nthreads, ndofs, [&](int tid, int begin, int end)
+  {
+    std::vector<int> mark(ndofs, -1);
+    for (int i = begin; i < end; i++)
+    {
+      int nnz = 0;
+      for (int m = dof_offsets[i]; m < dof_offsets[i+1]; m++)
+      {
+        const int e = dof_elems[m];
+        for (int k = elem_offsets[e]; k < elem_offsets[e+1]; k++)
+          if (mark[elem_dofs[k]] != i)
+          {
+            mark[elem_dofs[k]] = i;
+            nnz++;
+          }
+      }
+      I[i+1] = nnz;
+    }
+  });
+  for (int i = 0; i < ndofs; i++)
+    I[i+1] += I[i];
+
+  J.SetSize(I[ndofs]);
+  LG_ParallelFor(nthreads, ndofs, [&](int tid, int begin, int end)
+  {
+    std::vector<int> mark(ndofs, -1);
+    for (int i = begin; i < end; i++)
+    {
+      int *row = J.GetData() + I[i];
+      int nnz = 0;
+      for (int m = dof_offsets[i]; m < dof_offsets[i+1]; m++)
+      {
+        const int e = dof_elems[m];
+        for (int k = elem_offsets[e]; k < elem_offsets[e+1]; k++)
+          if (mark[elem_dofs[k]] != i)
+          {
+            mark[elem_dofs[k]] = i;
+            row[nnz++] = elem_dofs[k];
+          }
+      }
+      std::sort(row, row + nnz);
+    }
+  });
+}
+
+SparseMatrix *LG_ThreadedAssembler::AssembleMatrix(
+    const Array<BilinearFormIntegrator*> &integs) const
+{
+  MFEM_VERIFY(integs.Size() == nthreads, "one integrator per thread");
+
+  int *i_A = new int[ndofs + 1];
+  int *j_A = new int[J.Size()];
+  double *a_A = new double[J.Size()];
+  std::copy(I.GetData(), I.GetData() + ndofs + 1, i_A);
+  std::copy(J.GetData(), J.GetData() + J.Size(), j_A);
+  LG_ParallelFor(nthreads, J.Size(), [&](int tid, int begin, int end)
+  {
+    std::fill(a_A + begin, a_A + end, 0.0);
+  });
+
+  // fetch the quadrature rules before the threads start
+  Mesh *mesh = fes->GetMesh();
+  IsoparametricTransformation T0;
+  DenseMatrix elmat0;
+  for (int k = 0; k < geom_elems.Size(); k++)
+  {
+    mesh->GetElementTransformation(geom_elems[k], &T0);
+    integs[0]->AssembleElementMatrix(*fes->GetFE(geom_elems[k]), T0, elmat0);
+  }
+
+  // the colors one after the other, no two threads share a row within one
+  LG_ParallelForRanges(GetAssemblyThreads(), color_offsets,
+                       [&](int tid, int begin, int end)
+  {
+    IsoparametricTransformation T;
+    DenseMatrix elmat;
+    for (int m = begin; m < end; m++)
+    {
+      const int e = color_elems[m];
+      const int *dofs = elem_dofs.GetData() + elem_offsets[e];
+      const int nd = elem_offsets[e+1] - elem_offsets[e];
+
+      mesh->GetElementTransformation(e, &T);
+      integs[tid]->AssembleElementMatrix(*fes->GetFE(e), T, elmat);
+
+      // no other thread owns an element with these rows
+      for (int a = 0; a < nd; a++)
+      {
+        const int *row_begin = j_A + i_A[dofs[a]];
+        const int *row_end = j_A + i_A[dofs[a]+1];
+        double *row_data = a_A + i_A[dofs[a]];
+        for (int b = 0; b < nd; b++)
+        {
+          const int k = std::lower_bound(row_begin, row_end, dofs[b]) - row_begin;
+          row_data[k] += elmat(a,b);
+        }
+      }
+    }
+  });
+  return new SparseMatrix(i_A, j_A, a_A, ndofs, ndofs);
+}
+
+void LG_ThreadedAssembler::AssembleVector(
+    const Array<LinearFormIntegrator*> &integs,
+    Vector &b) const
+{
+  MFEM_VERIFY(integs.Size() == nthreads, "one integrator per thread");
+
+  b.SetSize(ndofs);
+  b = 0.0;
+
+  // fetch the quadrature rules before the threads start
+  Mesh *mesh = fes->GetMesh();
+  IsoparametricTransformation T0;
+  Vector elvect0;
+  for (int k = 0; k < geom_elems.Size(); k++)
+  {
+    mesh->GetElementTransformation(geom_elems[k], &T0);
+    integs[0]->AssembleRHSElementVect(*fes->GetFE(geom_elems[k]), T0, elvect0);
+  }
+
+  LG_ParallelForRanges(GetAssemblyThreads(), color_offsets,
+                       [&](int tid, int begin, int end)
+  {
+    IsoparametricTransformation T;
+    Vector elvect;
+    for (int m = begin; m < end; m++)
+    {
+      const int e = color_elems[m];
+      const int *dofs = elem_dofs.GetData() + elem_offsets[e];
+      const int nd = elem_offsets[e+1] - elem_offsets[e];
+
+      mesh->GetElementTransformation(e, &T);
+      integs[tid]->AssembleRHSElementVect(*fes->GetFE(e), T, elvect);
+      for (int a = 0; a < nd; a++)
+        b(dofs[a]) += elvect(a);
+    }
+  });
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef LAGRANGE_BLOCK_SOLVE
+#define LAGRANGE_BLOCK_SOLVE
+
+#include <vector>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeSmoothers.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Multi-vectors of k columns over n dofs are stored interleaved in a
+/// k x n DenseMatrix: X(j,i) is column j at dof i, so the k values of a dof
+/// are contiguous and a matrix entry is loaded once for all the columns.
+
+/// Y = A X for the interleaved multi-vector X (SpMM)
+void LG_SpMM(const SparseMatrix &A, const DenseMatrix &X, DenseMatrix &Y);
+
+/// Symmetric Gauss-Seidel (one forward and one backward sweep from zero, as
+/// GSSmoother) on interleaved multi-vectors
+class LG_BlockGSSmoother
+{
+protected:
+  const SparseMatrix &A;
+  Vector dinv;
+  mutable Vector s;
+
+public:
+  LG_BlockGSSmoother(const SparseMatrix &A);
+
+  void Mult(const DenseMatrix &B, DenseMatrix &X) const;
+};
+
+/// Preconditioned CG on all the columns of an interleaved multi-vector at
+/// once: the columns run their own CG recurrences in lock step, sharing the
+/// matrix and preconditioner sweeps. A column stops updating once it meets
+/// the tolerance, so every column gets the iterates of a single PCG solve.
+class LG_BlockPCG
+{
+protected:
+  const SparseMatrix *A;
+  const LG_BlockGSSmoother *M;
+  double rel_tol, abs_tol;
+  int max_iter;
+  mutable Array<int> iterations;
+
+public:
+  LG_BlockPCG();
+
+  void SetOperator(const SparseMatrix &A_)
+  { A = &A_; }
+  void SetPreconditioner(const LG_BlockGSSmoother &M_)
+  { M = &M_; }
+  void SetRelTol(double rtol)
+  { rel_tol = rtol; }
+  void SetAbsTol(double atol)
+  { abs_tol = atol; }
+  void SetMaxIter(int max_it)
+  { max_iter = max_it; }
+
+  /// Iterations of column j in the last Mult
+  int GetNumIterations(int j) const
+  { return iterations[j]; }
+
+  /// Solve A X = B column by column, starting from X = 0
+  void Mult(const DenseMatrix &B, DenseMatrix &X) const;
+};
+
+
+void LG_SpMM(const SparseMatrix &A, const DenseMatrix &X, DenseMatrix &Y)
+{
+  const int k = X.Height();
+  const int n = A.Height();
+  MFEM_VERIFY(X.Width() == A.Width(), "size mismatch");
+  Y.SetSize(k, n);
+
+  const int *I = A.GetI();
+  const int *J = A.GetJ();
+  const double *a = A.GetData();
+  const double *x = X.Data();
+  double *y = Y.Data();
+  for (int i = 0; i < n; i++)
+  {
+    double *yi = y + i*k;
+    for (int j = 0; j < k; j++)
+      yi[j] = 0.0;
+    for (int m = I[i]; m < I[i+1]; m++)
+    {
+      const double aim = a[m];
+      const double *xc = x + J[m]*k;
+      for (int j = 0; j < k; j++)
+        yi[j] += aim*xc[j];
+    }
+  }
+}
+
+
+// LG_BlockGSSmoother implementation
+LG_BlockGSSmoother::LG_BlockGSSmoother(const SparseMatrix &A_)
+   : A(A_), dinv(A_.Height())
+{
+  Vector diag;
+  A.GetDiag(diag);
+  for (int i = 0; i < diag.Size(); i++)
+  {
+    MFEM_VERIFY(diag(i) != 0.0, "zero on the diagonal at row " << i);
+    dinv(i) = 1.0/diag(i);
+  }
+}
+
+void LG_BlockGSSmoother::Mult(const DenseMatrix &B, DenseMatrix &X) const
+{
+  const int k = B.Height();
+  const int n = A.Height();
+  X.SetSize(k, n);
+  s.SetSize(k);
+  LG_SymmetricGSSweep<double, 0>(n, A.GetI(), A.GetJ(), A.GetData(),
+                                  dinv.GetData(), B.Data(), X.Data(),
+                                  s.GetData(), k);
+}
+
+
+// LG_BlockPCG implementation
+LG_BlockPCG::LG_BlockPCG()
+   : A(NULL), M(NULL), rel_tol(1e-6), abs_tol(0.0), max_iter(1000)
+{
+}
+
+void LG_BlockPCG::Mult(const DenseMatrix &B, DenseMatrix &X) const
+{
+  MFEM_VERIFY(A && M, "set the operator and the preconditioner first");
+  const int k = B.Height();
+  const int n = B.Width();
+
+  DenseMatrix R(B), Z, P, Q;
+  X.SetSize(k, n);
+  X = 0.0;
+  M->Mult(R, Z);
+  P = Z;
+
+  std::vector<double> rz(k, 0.0), pq(k), tol(k);
+  std::vector<bool> active(k, true);
+  iterations.SetSize(k);
+  iterations = 0;
+  double *x = X.Data(), *r = R.Data(), *z = Z.Data(), *p = P.Data();
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < k; j++)
+      rz[j] += r[i*k + j]*z[i*k + j];
+  int nactive = 0;
+  for (int j = 0; j < k; j++)
+  {
+    tol[j] = max(rel_tol*sqrt(rz[j]), abs_tol);
+    active[j] = sqrt(rz[j]) > tol[j];
+    nactive += active[j];
+  }
+
+  for (int it = 1; it <= max_iter && nactive > 0; it++)
+  {
+    LG_SpMM(*A, P, Q);
+    const double *q = Q.Data();
+    std::fill(pq.begin(), pq.end(), 0.0);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < k; j++)
+        pq[j] += p[i*k + j]*q[i*k + j];
+
+    // converged columns get alpha = 0 and keep their iterates
+    std::vector<double> alpha(k, 0.0);
+    for (int j = 0; j < k; j++)
+      if (active[j])
+        alpha[j] = rz[j]/pq[j];
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < k; j++)
+      {
+        x[i*k + j] += alpha[j]*p[i*k + j];
+        r[i*k + j] -= alpha[j]*q[i*k + j];
+      }
+
+    M->Mult(R, Z);
+    z = Z.Data();
+    std::vector<double> rz_new(k, 0.0), beta(k, 0.0);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < k; j++)
+        rz_new[j] += r[i*k + j]*z[i*k + j];
+    nactive = 0;
+    for (int j = 0; j < k; j++)
+    {
+      if (!active[j])
+        continue;
+      iterations[j] = it;
+      if (sqrt(rz_new[j]) <= tol[j])
+      {
+        active[j] = false;
+        continue;
+      }
+      beta[j] = rz_new[j]/rz[j];
+      rz[j] = rz_new[j];
+      nactive++;
+    }
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < k; j++)
+        p[i*k + j] = active[j] ? z[i*k + j] + beta[j]*p[i*k + j] : 0.0;
+  }
+}
+
+#endif
@@ -5,12 +5,345 @@
 #include <fstream>
 #include <iostream>
 #include <queue>
+#include <map>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+
+#include "LagrangeKernels.hpp"
 
 using namespace std;
 using namespace mfem;
 
-class LG_SegmentElement : public NodalTensorFiniteElement
+/// Highest order supported by the LG elements. Shape evaluation uses fixed
+/// size scratch arrays of this length, so no memory is shared between calls.
+const int LG_MAX_ORDER = 10;
+/// Largest number of dofs of an LG element (the hexahedron)
+const int LG_MAX_DOF = (LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 1);
+
+/// Alignment (in bytes) of the batched shape tables
+const int LG_SIMD_ALIGN = 64;
+
+/// Shapes and reference gradients of an element at all the points of an
+/// IntegrationRule. Both tables are contiguous and start on LG_SIMD_ALIGN
+/// byte boundaries. Point q owns the row
+///   shape(q)  = B + q*ndof           (ndof values)
+///   dshape(q) = G + q*ndof*dim       (ndof x dim, column major)
+/// so dshape(q) can be wrapped in a DenseMatrix exactly like the output of
+/// FiniteElement::CalcDShape.
+///
+/// The table also owns a scratch buffer (GetWork) for the intermediate
+/// arrays of the batched kernels, so refilling a table does not allocate.
+class LG_ShapeTable
+{
+protected:
+  int nqpt, ndof, dim, capacity, work_capacity;
+  double *B, *G;
+  double *mem, *work;
+
+  // tables own raw memory, so they are not copyable
+  LG_ShapeTable(const LG_ShapeTable &);
+  LG_ShapeTable &operator=(const LG_ShapeTable &);
+
+public:
+  LG_ShapeTable()
+    : nqpt(0), ndof(0), dim(0), capacity(0), work_capacity(0),
+      B(NULL), G(NULL), mem(NULL), work(NULL) { }
+
+  /// Resize the table, reusing the current allocation when it is big enough
+  void SetSize(const int nqpt, const int ndof, const int dim);
+
+  /// Scratch space of at least size doubles, kept between calls. Its
+  /// contents are undefined on return.
+  double *GetWork(const int size);
+
+  int GetNPoints() const
+  { return nqpt; }
+  int GetDof() const
+  { return ndof; }
+  int GetDim() const
+  { return dim; }
+
+  double *GetShapeData() const
+  { return B; }
+  double *GetDShapeData() const
+  { return G; }
+  double *GetShape(const int q) const
+  { return B + q*ndof; }
+  double *GetDShape(const int q) const
+  { return G + q*ndof*dim; }
+
+  ~LG_ShapeTable()
+  {
+    delete [] mem;
+    delete [] work;
+  }
+};
+
+/// Largest number of 1D quadrature points accepted by the tensor kernels
+const int LG_MAX_Q1D = 2*LG_MAX_ORDER + 2;
+
+/// Number of points LG_Basis1D's batched Eval keeps on the stack at a time
+const int LG_EVAL_BLOCK = 64;
+
+/// 1D basis matrices of a tensor product LG element at the points of a 1D
+/// rule, in lexicographic dof order: B(q,i) = l_i(x_q) and G(q,i) = l_i'(x_q).
+/// Both are nqpt1d x ndof1d and column major, i.e. B.Data()[q + i*nqpt1d].
+class LG_TensorMaps
+{
+public:
+  int ndof1d, nqpt1d;
+  DenseMatrix B, G;
+
+  LG_TensorMaps()
+    : ndof1d(0), nqpt1d(0) { }
+};
+
+/// Run K::Run<D, Q> on the 1D sizes of maps, with D and Q fixed at compile
+/// time when LG_TensorKernel has a kernel for them and taken from the maps
+/// (K::Run<0, 0>) otherwise. This is the one switch in front of all the
+/// sum-factorized kernels of the quad and the hex.
+template <typename K>
+inline void LG_TensorDispatch(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *in,
+    double *out)
+{
+  switch (LG_TensorKernel(maps.ndof1d, maps.nqpt1d))
+  {
+    case 1: K::template Run<2,2>(maps, dof_map, in, out); break;
+    case 2: K::template Run<2,3>(maps, dof_map, in, out); break;
+    case 3: K::template Run<3,3>(maps, dof_map, in, out); break;
+    case 4: K::template Run<3,4>(maps, dof_map, in, out); break;
+    case 5: K::template Run<4,4>(maps, dof_map, in, out); break;
+    case 6: K::template Run<4,5>(maps, dof_map, in, out); break;
+    case 7: K::template Run<5,5>(maps, dof_map, in, out); break;
+    case 8: K::template Run<5,6>(maps, dof_map, in, out); break;
+    default: K::template Run<0,0>(maps, dof_map, in, out);
+  }
+}
+
+/// Sum-factorized kernels of LG_QuadrilateralElement and LG_HexahedronElement
+/// (see their Interpolate* members) with D_ dofs and Q_ points per direction,
+/// fixed at compile time or taken from the maps when zero. dof_map takes the
+/// lexicographic dof index to the native one.
+struct LG_QuadInterpolate
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *u, double *uq);
+};
+struct LG_QuadInterpolateGrad
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *u, double *duq);
+};
+struct LG_QuadAddInterpolateTranspose
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *uq, double *v);
+};
+struct LG_QuadAddInterpolateGradTranspose
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *duq, double *v);
+};
+struct LG_HexInterpolate
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *u, double *uq);
+};
+struct LG_HexInterpolateGrad
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *u, double *duq);
+};
+struct LG_HexAddInterpolateTranspose
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *uq, double *v);
+};
+struct LG_HexAddInterpolateGradTranspose
+{
+  template <int D_, int Q_>
+  static void Run(const LG_TensorMaps &maps, const int *dof_map,
+                  const double *duq, double *v);
+};
+
+/// Lagrange basis on the closed 1D points of order p and basis type btype.
+/// Nodes are stored in increasing order (x[0] = 0, x[p] = 1) together with
+/// their barycentric weights w[i] = 1/prod_{j != i}(x[i] - x[j]).
+class LG_Basis1D
+{
+protected:
+  int p;
+  double x[LG_MAX_ORDER+1];
+  double w[LG_MAX_ORDER+1];
+
+public:
+  LG_Basis1D(const int p, const int btype);
+
+  int GetOrder() const
+  { return p; }
+  const double *GetNodes() const
+  { return x; }
+  const double *GetWeights() const
+  { return w; }
+
+  /// Evaluate the p+1 Lagrange polynomials at t
+  void Eval(const double t, double *u) const;
+  /// Evaluate the p+1 Lagrange polynomials and their derivatives at t
+  void Eval(const double t, double *u, double *d) const;
+
+  /// Evaluate the p+1 Lagrange polynomials at the n points t. The loops run
+  /// across blocks of LG_EVAL_BLOCK points, u[i*n + k] = l_i(t[k]).
+  void Eval(const int n, const double *t, double *u) const;
+  /// Batched values and derivatives, d[i*n + k] = l_i'(t[k])
+  void Eval(const int n, const double *t, double *u, double *d) const;
+  /// Fill the 1D tensor maps at the points of the 1D rule ir1d
+  void Eval(const IntegrationRule &ir1d, LG_TensorMaps &maps) const;
+};
+
+/// Inverse Vandermonde table used to evaluate the nodal basis of a triangle
+/// of order p from a hierarchical basis of P_p.
+class LG_TriangleBasis
+{
+protected:
+  int p, dof;
+  DenseMatrix Ti;
+
+public:
+  LG_TriangleBasis(const int p, const IntegrationRule &nodes);
+
+  int GetOrder() const
+  { return p; }
+  const DenseMatrix &GetInverseVandermonde() const
+  { return Ti; }
+
+  void Eval(const double x, const double y, double *shape) const;
+  void Eval(const double x, const double y, double *shape,
+      double *dshape_x, double *dshape_y) const;
+  /// Fill the (points x dofs) shape table B and the gradient table G (see
+  /// LG_ShapeTable) for all the points of ir with two matrix products. work
+  /// holds the 3*dof*nq doubles of the hierarchical basis.
+  void Eval(const IntegrationRule &ir, double *B, double *G,
+      double *work) const;
+};
+
+/// Inverse Vandermonde table of the nodal basis of a tetrahedron of order p,
+/// the 3D analogue of LG_TriangleBasis
+class LG_TetrahedronBasis
+{
+protected:
+  int p, dof;
+  DenseMatrix Ti;
+
+public:
+  LG_TetrahedronBasis(const int p, const IntegrationRule &nodes);
+
+  int GetOrder() const
+  { return p; }
+  const DenseMatrix &GetInverseVandermonde() const
+  { return Ti; }
+
+  void Eval(const double x, const double y, const double z,
+      double *shape) const;
+  void Eval(const double x, const double y, const double z, double *shape,
+      double *dshape_x, double *dshape_y, double *dshape_z) const;
+  /// Fill the (points x dofs) shape and gradient tables for all points of
+  /// ir, with 4*dof*nq doubles of scratch in work
+  void Eval(const IntegrationRule &ir, double *B, double *G,
+      double *work) const;
+};
+
+/// Inverse Vandermonde table of the nodal serendipity basis of a quad of
+/// order p. The space is S_p = P_p + span{x^p y, x y^p} (Q_1 for p = 1), of
+/// dimension 4p + (p-2)(p-3)/2 for p >= 4 and 4p below.
+class LG_SerendipityBasis
+{
+protected:
+  int p, dof;
+  DenseMatrix Ti;
+
+  /// Hierarchical basis of S_p (and its gradient) at (x,y)
+  void EvalHierarchical(const double x, const double y, double *u) const;
+  void EvalHierarchical(const double x, const double y, double *u,
+      double *du_x, double *du_y) const;
+
+public:
+  LG_SerendipityBasis(const int p, const IntegrationRule &nodes);
+
+  int GetOrder() const
+  { return p; }
+  const DenseMatrix &GetInverseVandermonde() const
+  { return Ti; }
+
+  void Eval(const double x, const double y, double *shape) const;
+  void Eval(const double x, const double y, double *shape,
+      double *dshape_x, double *dshape_y) const;
+  /// Fill the (points x dofs) shape and gradient tables for all points of
+  /// ir, with 3*dof*nq doubles of scratch in work
+  void Eval(const IntegrationRule &ir, double *B, double *G,
+      double *work) const;
+};
+
+/// Number of dofs of the serendipity quad of order p
+inline int LG_SerendipityDof(const int p)
+{
+  return 4*p + ((p >= 4) ? ((p - 2)*(p - 3))/2 : 0);
+}
+
+/// Get the 1D table for (p, btype). Tables are built on first request and
+/// then shared by every element of that order and basis type.
+const LG_Basis1D &LG_GetBasis1D(const int p, const int btype);
+/// Get the triangle table for (p, btype), built from nodes on first request
+const LG_TriangleBasis &LG_GetTriangleBasis(
+    const int p,
+    const int btype,
+    const IntegrationRule &nodes);
+/// Get the tetrahedron table for (p, btype), built from nodes on first request
+const LG_TetrahedronBasis &LG_GetTetrahedronBasis(
+    const int p,
+    const int btype,
+    const IntegrationRule &nodes);
+
+/// Get the serendipity table of order p, built from nodes on first request
+const LG_SerendipityBasis &LG_GetSerendipityBasis(
+    const int p,
+    const IntegrationRule &nodes);
+
+/// Interface of the LG elements that evaluate a whole IntegrationRule at once
+class LG_BatchedElement
 {
+public:
+  /// Fill table with the shapes and reference gradients at all points of ir
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const = 0;
+  virtual ~LG_BatchedElement() { }
+};
+
+/// Fill table for any FiniteElement: LG elements use their batched kernels,
+/// any other element falls back to a CalcShape/CalcDShape loop
+void LG_CalcShapeTable(
+    const FiniteElement &fe,
+    const IntegrationRule &ir,
+    LG_ShapeTable &table);
+
+class LG_SegmentElement : public NodalTensorFiniteElement,
+                          public LG_BatchedElement
+{
+protected:
+  const LG_Basis1D &lg_basis;
+
 public:
   LG_SegmentElement(
       const int p,
@@ -21,10 +354,27 @@ public:
   virtual void CalcDShape(
       const IntegrationPoint &ip,
       DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  const LG_Basis1D &GetLGBasis() const
+  { return lg_basis; }
 };
 
-class LG_QuadrilateralElement : public NodalTensorFiniteElement
+/// Lagrange quadrilateral on the tensor grid of the 1D LG nodes.
+///
+/// Besides the pointwise and batched evaluation, the element provides
+/// sum-factorized kernels acting on the tensor rule ir1d x ir1d (point
+/// q = qx + qy*nq1d, the ordering of IntegrationRule(ir1d, ir1d)) with the
+/// maps from GetTensorMaps. They contract one direction at a time and cost
+/// O(p^3) per element instead of the O(p^4) of a (points x dofs) table.
+/// Dof vectors are in the native (vertices, edges, interior) ordering.
+class LG_QuadrilateralElement : public NodalTensorFiniteElement,
+                                public LG_BatchedElement
 {
+protected:
+  const LG_Basis1D &lg_basis;
+
 public:
   LG_QuadrilateralElement(
       const int p,
@@ -35,11 +385,102 @@ public:
   virtual void CalcDShape(
       const IntegrationPoint &ip,
       DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  const LG_Basis1D &GetLGBasis() const
+  { return lg_basis; }
+
+  /// Get the 1D maps of this element (the LG_SegmentElement basis of the
+  /// same order) at the points of ir1d
+  void GetTensorMaps(
+      const IntegrationRule &ir1d,
+      LG_TensorMaps &maps) const
+  { lg_basis.Eval(ir1d, maps); }
+  /// uq(q) = sum_k u(k) shape_k(x_q)
+  void Interpolate(
+      const LG_TensorMaps &maps,
+      const double *u,
+      double *uq) const;
+  /// duq(q) and duq(q + nq) are the reference x and y derivatives at x_q
+  void InterpolateGrad(
+      const LG_TensorMaps &maps,
+      const double *u,
+      double *duq) const;
+  /// v(k) += sum_q uq(q) shape_k(x_q), the transpose of Interpolate
+  void AddInterpolateTranspose(
+      const LG_TensorMaps &maps,
+      const double *uq,
+      double *v) const;
+  /// v(k) += sum_q duq(q) dshape_k/dx(x_q) + duq(q + nq) dshape_k/dy(x_q)
+  void AddInterpolateGradTranspose(
+      const LG_TensorMaps &maps,
+      const double *duq,
+      double *v) const;
+};
+
+/// Lagrange hexahedron on the tensor grid of the 1D LG nodes. It has the
+/// same sum-factorized kernels as LG_QuadrilateralElement, acting on the
+/// tensor rule ir1d x ir1d x ir1d with point q = qx + (qy + qz*nq1d)*nq1d
+/// (the ordering of IntegrationRule(ir1d, ir1d, ir1d)), at O(p^4) per
+/// element instead of O(p^6).
+class LG_HexahedronElement : public NodalTensorFiniteElement,
+                             public LG_BatchedElement
+{
+protected:
+  const LG_Basis1D &lg_basis;
+
+public:
+  LG_HexahedronElement(
+      const int p,
+      const int btype = BasisType::GaussLobatto);
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  const LG_Basis1D &GetLGBasis() const
+  { return lg_basis; }
+
+  /// Get the 1D maps of this element at the points of ir1d
+  void GetTensorMaps(
+      const IntegrationRule &ir1d,
+      LG_TensorMaps &maps) const
+  { lg_basis.Eval(ir1d, maps); }
+  /// uq(q) = sum_k u(k) shape_k(x_q)
+  void Interpolate(
+      const LG_TensorMaps &maps,
+      const double *u,
+      double *uq) const;
+  /// duq(q), duq(q + nq) and duq(q + 2nq) are the reference x, y and z
+  /// derivatives at x_q
+  void InterpolateGrad(
+      const LG_TensorMaps &maps,
+      const double *u,
+      double *duq) const;
+  /// v(k) += sum_q uq(q) shape_k(x_q), the transpose of Interpolate
+  void AddInterpolateTranspose(
+      const LG_TensorMaps &maps,
+      const double *uq,
+      double *v) const;
+  /// The transpose of InterpolateGrad, added to v
+  void AddInterpolateGradTranspose(
+      const LG_TensorMaps &maps,
+      const double *duq,
+      double *v) const;
 };
 
 
-class LG_TriangleElement : public NodalFiniteElement
+class LG_TriangleElement : public NodalFiniteElement,
+                           public LG_BatchedElement
 {
+protected:
+  const LG_TriangleBasis *lg_basis;
+
 public:
   LG_TriangleElement(
       const int p,
@@ -50,8 +491,156 @@ public:
   virtual void CalcDShape(
       const IntegrationPoint &ip,
       DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  /// Inverse Vandermonde matrix of the nodes (dof x dof)
+  const DenseMatrix &GetInverseVandermonde() const
+  { return lg_basis->GetInverseVandermonde(); }
+};
+
+class LG_TetrahedronElement : public NodalFiniteElement,
+                              public LG_BatchedElement
+{
+protected:
+  const LG_TetrahedronBasis *lg_basis;
+
+public:
+  LG_TetrahedronElement(
+      const int p,
+      const int btype = BasisType::GaussLobatto);
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  /// Inverse Vandermonde matrix of the nodes (dof x dof)
+  const DenseMatrix &GetInverseVandermonde() const
+  { return lg_basis->GetInverseVandermonde(); }
+};
+
+/// LG elements of a fixed order P <= LG_MAX_KERNEL_ORDER on the Gauss-Lobatto
+/// nodes. CalcShape and CalcDShape run the compile-time kernels of
+/// LagrangeKernels.hpp directly, so the order is resolved once, when
+/// LG_NewElement picks the class, instead of on every call.
+template <int P>
+class LG_SegmentElementP : public LG_SegmentElement
+{
+public:
+  explicit LG_SegmentElementP(const int btype = BasisType::GaussLobatto)
+    : LG_SegmentElement(P, btype) { }
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+};
+
+template <int P>
+class LG_QuadrilateralElementP : public LG_QuadrilateralElement
+{
+public:
+  explicit LG_QuadrilateralElementP(const int btype = BasisType::GaussLobatto)
+    : LG_QuadrilateralElement(P, btype) { }
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+};
+
+template <int P>
+class LG_HexahedronElementP : public LG_HexahedronElement
+{
+public:
+  explicit LG_HexahedronElementP(const int btype = BasisType::GaussLobatto)
+    : LG_HexahedronElement(P, btype) { }
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+};
+
+/// The simplex kernels hold the coefficients of LG_TriTable and LG_TetTable,
+/// computed for the nodes of the base constructor; the constructors check
+/// that the shapes are nodal at Nodes.
+template <int P>
+class LG_TriangleElementP : public LG_TriangleElement
+{
+public:
+  explicit LG_TriangleElementP(const int btype = BasisType::GaussLobatto);
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+};
+
+template <int P>
+class LG_TetrahedronElementP : public LG_TetrahedronElement
+{
+public:
+  explicit LG_TetrahedronElementP(const int btype = BasisType::GaussLobatto);
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+};
+
+/// New LG element of order p and basis type btype: E<p> when the pair has
+/// compile-time kernels (see LG_KernelOrder), the generic Base otherwise
+template <template <int> class E, typename Base>
+Base *LG_NewElement(const int p, const int btype)
+{
+  switch (LG_KernelOrder(p, btype))
+  {
+    case 1: return new E<1>(btype);
+    case 2: return new E<2>(btype);
+    case 3: return new E<3>(btype);
+    case 4: return new E<4>(btype);
+    default: return new Base(p, btype);
+  }
+}
+
+/// Serendipity quadrilateral: the vertex and edge nodes of the LG quad and,
+/// for p >= 4, (p-2)(p-3)/2 interior nodes on a triangular lattice of the
+/// interior LG nodes of order p-2. It is not a tensor product element, so
+/// it uses the (points x dofs) tables instead of the sum-factorized kernels.
+class LG_SerendipityQuadElement : public NodalFiniteElement,
+                                  public LG_BatchedElement
+{
+protected:
+  const LG_SerendipityBasis *lg_basis;
+
+public:
+  LG_SerendipityQuadElement(const int p);
+  virtual void CalcShape(
+      const IntegrationPoint &ip,
+      Vector &shape) const;
+  virtual void CalcDShape(
+      const IntegrationPoint &ip,
+      DenseMatrix &dshape) const;
+  virtual void CalcShapeTable(
+      const IntegrationRule &ir,
+      LG_ShapeTable &table) const;
+  const DenseMatrix &GetInverseVandermonde() const
+  { return lg_basis->GetInverseVandermonde(); }
 };
 
+/// Lagrange collection with the Gauss-Lobatto nodes. With btype
+/// BasisType::Serendipity (dim <= 2) quads use LG_SerendipityQuadElement
+/// and all other geometries the usual LG elements.
 class LG_FECollection : public FiniteElementCollection
 {
 protected:
@@ -61,6 +650,23 @@ protected:
   int LG_dof[Geometry::NumGeom];
   int *SegDofOrd[2], *TriDofOrd[6], *QuadDofOrd[8], *TetDofOrd[24];
 
+  // shape tables of one geometry, keyed by the integration rule address.
+  // Entries are immutable once published at the head of the list.
+  struct ShapeTableEntry
+  {
+    const IntegrationRule *ir;
+    LG_ShapeTable table;
+    ShapeTableEntry *next;
+  };
+  mutable std::atomic<ShapeTableEntry*> shape_tables[Geometry::NumGeom];
+  // serializes the insertions only, lookups never take it
+  mutable std::mutex shape_tables_mutex;
+  mutable std::atomic<long> shape_table_hits, shape_table_misses;
+
+  static const LG_ShapeTable *FindShapeTable(
+      const ShapeTableEntry *entry,
+      const IntegrationRule &ir);
+
 public:
   explicit LG_FECollection(
       const int p,
@@ -83,216 +689,1520 @@ public:
 
   int GetBasisType() const
   { return b_type; }
-  /// Get the Cartesian to local LG dof map
+  /// Get the Cartesian to local LG dof map of the tensor product geometries
+  /// (SEGMENT, SQUARE and CUBE): entry i + j*(p+1) (+ k*(p+1)^2) is the
+  /// local dof of the node with lexicographic index (i,j,k)
   const int *GetDofMap(Geometry::Type GeomType) const;
 
+  /// Get the shapes and reference gradients of the element for GeomType at
+  /// the points of ir. The table is computed on the first request for the
+  /// (geometry, ir) pair and returned unchanged afterwards, so ir
+  /// must outlive the collection (e.g. a rule from IntRules). Safe to call
+  /// from several threads: cached tables are read without locking and only
+  /// the computation of a new table is serialized.
+  const LG_ShapeTable &GetShapeTable(
+      Geometry::Type GeomType,
+      const IntegrationRule &ir) const;
+  /// Number of GetShapeTable calls served from the cache
+  long GetShapeTableHits() const;
+  /// Number of GetShapeTable calls that had to compute a table
+  long GetShapeTableMisses() const;
+
   virtual ~LG_FECollection();
 };
 
+/// The LG collection of the faces of a dim-dimensional mesh, i.e. an
+/// LG_FECollection of dimension dim-1. It has no dofs in the element
+/// interiors, which is what static condensation and hybridization build
+/// their reduced spaces from.
+class LG_Trace_FECollection : public LG_FECollection
+{
+public:
+  LG_Trace_FECollection(
+      const int p,
+      const int dim,
+      const int btype = BasisType::GaussLobatto);
+};
 
-// LG_SegmentElement implementation
-LG_SegmentElement::LG_SegmentElement(
-    const int p,
-    const int btype)
-   : NodalTensorFiniteElement(1, p, VerifyClosed(btype), H1_DOF_MAP)
+
+// LG_ShapeTable implementation
+void LG_ShapeTable::SetSize(const int nqpt_, const int ndof_, const int dim_)
 {
-  const double *cp = poly1d.ClosedPoints(p, b_type);
+  nqpt = nqpt_;
+  ndof = ndof_;
+  dim = dim_;
 
-  Nodes.IntPoint(0).x = cp[0];
-  Nodes.IntPoint(1).x = cp[p];
-  for (int i = 1; i < p; i++)
+  // round the shape table up so the gradient table is aligned too
+  const int align = LG_SIMD_ALIGN/sizeof(double);
+  const int nb = ((nqpt*ndof + align - 1)/align)*align;
+  const int size = nb + nqpt*ndof*dim + align;
+  if (size > capacity)
   {
-    Nodes.IntPoint(i+1).x = cp[i];
+    delete [] mem;
+    mem = new double[size];
+    capacity = size;
   }
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(mem);
+  B = reinterpret_cast<double*>(
+      (addr + LG_SIMD_ALIGN - 1) & ~uintptr_t(LG_SIMD_ALIGN - 1));
+  G = B + nb;
 }
 
-void LG_SegmentElement::CalcShape(
-    const IntegrationPoint &ip,
-    Vector &shape) const
+double *LG_ShapeTable::GetWork(const int size)
 {
-  // get the order from the class member "order"
-  const int p = order;
-  // Note: in all cases boundary nodes are the first two and then the mid nodes
-  if (p == 1)
+  if (size > work_capacity)
   {
-    // TODO: implement 1st order shapes for segments
-    // Note the parametric coordinate is ip.x
-    shape(0) = 0.;
-    shape(1) = 0.;
+    delete [] work;
+    work = new double[size];
+    work_capacity = size;
   }
-  else if (p == 2)
+  return work;
+}
+
+// LG_Basis1D implementation
+LG_Basis1D::LG_Basis1D(const int p_, const int btype)
+   : p(p_)
+{
+  MFEM_VERIFY(p >= 1 && p <= LG_MAX_ORDER, "unimplemented order");
+  const double *cp = poly1d.ClosedPoints(p, btype);
+
+  for (int i = 0; i <= p; i++)
   {
-    // TODO: implement 2nd order shapes for segments
-    shape(0) = 0.;
-    shape(1) = 0.;
-    shape(2) = 0.;
+    x[i] = cp[i];
   }
-  else
+  for (int i = 0; i <= p; i++)
   {
-    MFEM_VERIFY(0, "unimplemented order");
+    double d = 1.;
+    for (int j = 0; j <= p; j++)
+    {
+      if (j != i)
+        d *= x[i] - x[j];
+    }
+    w[i] = 1./d;
   }
 }
 
-void LG_SegmentElement::CalcDShape(
-    const IntegrationPoint &ip,
-    DenseMatrix &dshape) const
+void LG_Basis1D::Eval(const double t, double *u) const
 {
-  // get the order from the class member "order"
-  const int p = order;
-  // Note: in all cases boundary nodes are the first two and then the mid nodes
-  if (p == 1)
+  // l_i(t) = w_i * prod_{j < i}(t - x_j) * prod_{j > i}(t - x_j), built from
+  // running left and right products so no division by (t - x_j) is needed
+  double l = 1.;
+  for (int i = 0; i <= p; i++)
   {
-    // TODO: implement first derivative of 1st order shapes for segments
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
+    u[i] = w[i] * l;
+    l *= t - x[i];
   }
-  else if (p == 2)
+  double r = 1.;
+  for (int i = p; i >= 0; i--)
   {
-    // TODO: implement first derivative of 2st order shapes for segments
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
-    dshape(2,0) = 0.;
+    u[i] *= r;
+    r *= t - x[i];
   }
-  else
+}
+
+void LG_Basis1D::Eval(const double t, double *u, double *d) const
+{
+  double l = 1., dl = 0.;
+  for (int i = 0; i <= p; i++)
   {
-    MFEM_VERIFY(0, "unimplemented order");
+    u[i] = l;
+    d[i] = dl;
+    dl = dl * (t - x[i]) + l;
+    l *= t - x[i];
+  }
+  double r = 1., dr = 0.;
+  for (int i = p; i >= 0; i--)
+  {
+    d[i] = w[i] * (d[i] * r + u[i] * dr);
+    u[i] = w[i] * u[i] * r;
+    dr = dr * (t - x[i]) + r;
+    r *= t - x[i];
   }
 }
 
-// LG_QuadrilateralElement implementation
-LG_QuadrilateralElement::LG_QuadrilateralElement(
-    const int p,
-    const int btype)
-   : NodalTensorFiniteElement(2, p, VerifyClosed(btype), H1_DOF_MAP)
+void LG_Basis1D::Eval(const int n, const double *t, double *u) const
+{
+  // same left/right products as the pointwise version, with the point loop
+  // innermost so it vectorizes; the right products of one block of points
+  // live on the stack
+  double r[LG_EVAL_BLOCK];
+  for (int k0 = 0; k0 < n; k0 += LG_EVAL_BLOCK)
+  {
+    const int k1 = std::min(n, k0 + LG_EVAL_BLOCK);
+    for (int k = k0; k < k1; k++)
+    {
+      u[k] = 1.;
+    }
+    for (int i = 1; i <= p; i++)
+    {
+      const double *ul = u + (i-1)*n;
+      double *ui = u + i*n;
+      for (int k = k0; k < k1; k++)
+      {
+        ui[k] = ul[k]*(t[k] - x[i-1]);
+      }
+    }
+    for (int k = k0; k < k1; k++)
+    {
+      r[k-k0] = 1.;
+    }
+    for (int i = p; i >= 0; i--)
+    {
+      double *ui = u + i*n;
+      for (int k = k0; k < k1; k++)
+      {
+        ui[k] *= w[i]*r[k-k0];
+        r[k-k0] *= t[k] - x[i];
+      }
+    }
+  }
+}
+
+void LG_Basis1D::Eval(const int n, const double *t, double *u, double *d) const
+{
+  double r[LG_EVAL_BLOCK], dr[LG_EVAL_BLOCK];
+  for (int k0 = 0; k0 < n; k0 += LG_EVAL_BLOCK)
+  {
+    const int k1 = std::min(n, k0 + LG_EVAL_BLOCK);
+    for (int k = k0; k < k1; k++)
+    {
+      u[k] = 1.;
+      d[k] = 0.;
+    }
+    for (int i = 1; i <= p; i++)
+    {
+      const double *ul = u + (i-1)*n, *dl = d + (i-1)*n;
+      double *ui = u + i*n, *di = d + i*n;
+      for (int k = k0; k < k1; k++)
+      {
+        di[k] = dl[k]*(t[k] - x[i-1]) + ul[k];
+        ui[k] = ul[k]*(t[k] - x[i-1]);
+      }
+    }
+    for (int k = k0; k < k1; k++)
+    {
+      r[k-k0] = 1.;
+      dr[k-k0] = 0.;
+    }
+    for (int i = p; i >= 0; i--)
+    {
+      double *ui = u + i*n, *di = d + i*n;
+      for (int k = k0; k < k1; k++)
+      {
+        const int b = k - k0;
+        di[k] = w[i]*(di[k]*r[b] + ui[k]*dr[b]);
+        ui[k] = w[i]*ui[k]*r[b];
+        dr[b] = dr[b]*(t[k] - x[i]) + r[b];
+        r[b] *= t[k] - x[i];
+      }
+    }
+  }
+}
+
+void LG_Basis1D::Eval(const IntegrationRule &ir1d, LG_TensorMaps &maps) const
+{
+  const int nq = ir1d.GetNPoints();
+  MFEM_VERIFY(nq <= LG_MAX_Q1D, "too many 1D quadrature points");
+
+  double t[LG_MAX_Q1D];
+  for (int q = 0; q < nq; q++)
+  {
+    t[q] = ir1d.IntPoint(q).x;
+  }
+  maps.ndof1d = p + 1;
+  maps.nqpt1d = nq;
+  maps.B.SetSize(nq, p + 1);
+  maps.G.SetSize(nq, p + 1);
+  // u[i*nq + q] is exactly the column major layout of B(q,i)
+  Eval(nq, t, maps.B.Data(), maps.G.Data());
+}
+
+// LG_TriangleBasis implementation
+LG_TriangleBasis::LG_TriangleBasis(const int p_, const IntegrationRule &nodes)
+   : p(p_), dof(((p_ + 1)*(p_ + 2))/2), Ti(dof)
+{
+  MFEM_VERIFY(p >= 1 && p <= LG_MAX_ORDER, "unimplemented order");
+  MFEM_VERIFY(nodes.GetNPoints() == dof, "wrong number of triangle nodes");
+
+  // T(o,m) is the o-th hierarchical basis function at node m, so that the
+  // nodal shapes are shape = T^{-1} u(x,y)
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_l[LG_MAX_ORDER+1];
+  DenseMatrix T(dof);
+  for (int m = 0; m < dof; m++)
+  {
+    const IntegrationPoint &ip = nodes.IntPoint(m);
+    Poly_1D::CalcBasis(p, ip.x, shape_x);
+    Poly_1D::CalcBasis(p, ip.y, shape_y);
+    Poly_1D::CalcBasis(p, 1. - ip.x - ip.y, shape_l);
+
+    for (int o = 0, j = 0; j <= p; j++)
+      for (int i = 0; i + j <= p; i++)
+        T(o++, m) = shape_x[i]*shape_y[j]*shape_l[p-i-j];
+  }
+  DenseMatrixInverse Tinv(T);
+  Tinv.GetInverseMatrix(Ti);
+}
+
+void LG_TriangleBasis::Eval(
+    const double x,
+    const double y,
+    double *shape) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_l[LG_MAX_ORDER+1];
+  double u[((LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 2))/2];
+
+  Poly_1D::CalcBasis(p, x, shape_x);
+  Poly_1D::CalcBasis(p, y, shape_y);
+  Poly_1D::CalcBasis(p, 1. - x - y, shape_l);
+
+  for (int o = 0, j = 0; j <= p; j++)
+    for (int i = 0; i + j <= p; i++)
+      u[o++] = shape_x[i]*shape_y[j]*shape_l[p-i-j];
+
+  Ti.Mult(u, shape);
+}
+
+void LG_TriangleBasis::Eval(
+    const double x,
+    const double y,
+    double *shape,
+    double *dshape_x,
+    double *dshape_y) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_l[LG_MAX_ORDER+1];
+  double dshape_xi[LG_MAX_ORDER+1], dshape_yi[LG_MAX_ORDER+1];
+  double dshape_l[LG_MAX_ORDER+1];
+  double u[((LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 2))/2];
+  double du_x[((LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 2))/2];
+  double du_y[((LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 2))/2];
+
+  Poly_1D::CalcBasis(p, x, shape_x, dshape_xi);
+  Poly_1D::CalcBasis(p, y, shape_y, dshape_yi);
+  Poly_1D::CalcBasis(p, 1. - x - y, shape_l, dshape_l);
+
+  for (int o = 0, j = 0; j <= p; j++)
+    for (int i = 0; i + j <= p; i++)
+    {
+      const int k = p - i - j;
+      u[o] = shape_x[i]*shape_y[j]*shape_l[k];
+      du_x[o] = (dshape_xi[i]*shape_l[k] - shape_x[i]*dshape_l[k])*shape_y[j];
+      du_y[o] = (dshape_yi[j]*shape_l[k] - shape_y[j]*dshape_l[k])*shape_x[i];
+      o++;
+    }
+
+  Ti.Mult(u, shape);
+  Ti.Mult(du_x, dshape_x);
+  Ti.Mult(du_y, dshape_y);
+}
+
+void LG_TriangleBasis::Eval(
+    const IntegrationRule &ir,
+    double *B,
+    double *G,
+    double *work) const
+{
+  const int nq = ir.GetNPoints();
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_l[LG_MAX_ORDER+1];
+  double dshape_x[LG_MAX_ORDER+1], dshape_y[LG_MAX_ORDER+1];
+  double dshape_l[LG_MAX_ORDER+1];
+
+  // hierarchical basis at all points: U is dof x nq and dU is dof x (2 nq)
+  // with the x and y derivatives of point q in columns 2q and 2q+1
+  DenseMatrix U(work, dof, nq), dU(work + dof*nq, dof, 2*nq);
+  for (int q = 0; q < nq; q++)
+  {
+    const IntegrationPoint &ip = ir.IntPoint(q);
+    Poly_1D::CalcBasis(p, ip.x, shape_x, dshape_x);
+    Poly_1D::CalcBasis(p, ip.y, shape_y, dshape_y);
+    Poly_1D::CalcBasis(p, 1. - ip.x - ip.y, shape_l, dshape_l);
+
+    for (int o = 0, j = 0; j <= p; j++)
+      for (int i = 0; i + j <= p; i++)
+      {
+        const int k = p - i - j;
+        U(o,q) = shape_x[i]*shape_y[j]*shape_l[k];
+        dU(o,2*q) = (dshape_x[i]*shape_l[k] - shape_x[i]*dshape_l[k])*shape_y[j];
+        dU(o,2*q+1) = (dshape_y[j]*shape_l[k] - shape_y[j]*dshape_l[k])*shape_x[i];
+        o++;
+      }
+  }
+
+  // the column major dof x nq (dof x 2nq) products are exactly the
+  // point-major layouts of the shape (gradient) tables
+  DenseMatrix Bm(B, dof, nq), Gm(G, dof, 2*nq);
+  Mult(Ti, U, Bm);
+  Mult(Ti, dU, Gm);
+}
+
+// LG_TetrahedronBasis implementation
+LG_TetrahedronBasis::LG_TetrahedronBasis(
+    const int p_,
+    const IntegrationRule &nodes)
+   : p(p_), dof(((p_ + 1)*(p_ + 2)*(p_ + 3))/6), Ti(dof)
+{
+  MFEM_VERIFY(p >= 1 && p <= LG_MAX_ORDER, "unimplemented order");
+  MFEM_VERIFY(nodes.GetNPoints() == dof, "wrong number of tetrahedron nodes");
+
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_z[LG_MAX_ORDER+1], shape_l[LG_MAX_ORDER+1];
+  DenseMatrix T(dof);
+  for (int m = 0; m < dof; m++)
+  {
+    const IntegrationPoint &ip = nodes.IntPoint(m);
+    Poly_1D::CalcBasis(p, ip.x, shape_x);
+    Poly_1D::CalcBasis(p, ip.y, shape_y);
+    Poly_1D::CalcBasis(p, ip.z, shape_z);
+    Poly_1D::CalcBasis(p, 1. - ip.x - ip.y - ip.z, shape_l);
+
+    for (int o = 0, k = 0; k <= p; k++)
+      for (int j = 0; j + k <= p; j++)
+        for (int i = 0; i + j + k <= p; i++)
+          T(o++, m) = shape_x[i]*shape_y[j]*shape_z[k]*shape_l[p-i-j-k];
+  }
+  DenseMatrixInverse Tinv(T);
+  Tinv.GetInverseMatrix(Ti);
+}
+
+void LG_TetrahedronBasis::Eval(
+    const double x,
+    const double y,
+    const double z,
+    double *shape) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_z[LG_MAX_ORDER+1], shape_l[LG_MAX_ORDER+1];
+  double u[LG_MAX_DOF];
+
+  Poly_1D::CalcBasis(p, x, shape_x);
+  Poly_1D::CalcBasis(p, y, shape_y);
+  Poly_1D::CalcBasis(p, z, shape_z);
+  Poly_1D::CalcBasis(p, 1. - x - y - z, shape_l);
+
+  for (int o = 0, k = 0; k <= p; k++)
+    for (int j = 0; j + k <= p; j++)
+      for (int i = 0; i + j + k <= p; i++)
+        u[o++] = shape_x[i]*shape_y[j]*shape_z[k]*shape_l[p-i-j-k];
+
+  Ti.Mult(u, shape);
+}
+
+void LG_TetrahedronBasis::Eval(
+    const double x,
+    const double y,
+    const double z,
+    double *shape,
+    double *dshape_x,
+    double *dshape_y,
+    double *dshape_z) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_z[LG_MAX_ORDER+1], shape_l[LG_MAX_ORDER+1];
+  double dshape_xi[LG_MAX_ORDER+1], dshape_yi[LG_MAX_ORDER+1];
+  double dshape_zi[LG_MAX_ORDER+1], dshape_l[LG_MAX_ORDER+1];
+  double u[LG_MAX_DOF], du_x[LG_MAX_DOF], du_y[LG_MAX_DOF], du_z[LG_MAX_DOF];
+
+  Poly_1D::CalcBasis(p, x, shape_x, dshape_xi);
+  Poly_1D::CalcBasis(p, y, shape_y, dshape_yi);
+  Poly_1D::CalcBasis(p, z, shape_z, dshape_zi);
+  Poly_1D::CalcBasis(p, 1. - x - y - z, shape_l, dshape_l);
+
+  for (int o = 0, k = 0; k <= p; k++)
+    for (int j = 0; j + k <= p; j++)
+      for (int i = 0; i + j + k <= p; i++)
+      {
+        const int l = p - i - j - k;
+        u[o] = shape_x[i]*shape_y[j]*shape_z[k]*shape_l[l];
+        du_x[o] = (dshape_xi[i]*shape_l[l] - shape_x[i]*dshape_l[l])*
+                  shape_y[j]*shape_z[k];
+        du_y[o] = (dshape_yi[j]*shape_l[l] - shape_y[j]*dshape_l[l])*
+                  shape_x[i]*shape_z[k];
+        du_z[o] = (dshape_zi[k]*shape_l[l] - shape_z[k]*dshape_l[l])*
+                  shape_x[i]*shape_y[j];
+        o++;
+      }
+
+  Ti.Mult(u, shape);
+  Ti.Mult(du_x, dshape_x);
+  Ti.Mult(du_y, dshape_y);
+  Ti.Mult(du_z, dshape_z);
+}
+
+void LG_TetrahedronBasis::Eval(
+    const IntegrationRule &ir,
+    double *B,
+    double *G,
+    double *work) const
+{
+  const int nq = ir.GetNPoints();
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double shape_z[LG_MAX_ORDER+1], shape_l[LG_MAX_ORDER+1];
+  double dshape_x[LG_MAX_ORDER+1], dshape_y[LG_MAX_ORDER+1];
+  double dshape_z[LG_MAX_ORDER+1], dshape_l[LG_MAX_ORDER+1];
+
+  // U is dof x nq and dU is dof x (3 nq) with the x, y and z derivatives of
+  // point q in columns 3q, 3q+1 and 3q+2
+  DenseMatrix U(work, dof, nq), dU(work + dof*nq, dof, 3*nq);
+  for (int q = 0; q < nq; q++)
+  {
+    const IntegrationPoint &ip = ir.IntPoint(q);
+    Poly_1D::CalcBasis(p, ip.x, shape_x, dshape_x);
+    Poly_1D::CalcBasis(p, ip.y, shape_y, dshape_y);
+    Poly_1D::CalcBasis(p, ip.z, shape_z, dshape_z);
+    Poly_1D::CalcBasis(p, 1. - ip.x - ip.y - ip.z, shape_l, dshape_l);
+
+    for (int o = 0, k = 0; k <= p; k++)
+      for (int j = 0; j + k <= p; j++)
+        for (int i = 0; i + j + k <= p; i++)
+        {
+          const int l = p - i - j - k;
+          U(o,q) = shape_x[i]*shape_y[j]*shape_z[k]*shape_l[l];
+          dU(o,3*q) = (dshape_x[i]*shape_l[l] - shape_x[i]*dshape_l[l])*
+                      shape_y[j]*shape_z[k];
+          dU(o,3*q+1) = (dshape_y[j]*shape_l[l] - shape_y[j]*dshape_l[l])*
+                        shape_x[i]*shape_z[k];
+          dU(o,3*q+2) = (dshape_z[k]*shape_l[l] - shape_z[k]*dshape_l[l])*
+                        shape_x[i]*shape_y[j];
+          o++;
+        }
+  }
+
+  DenseMatrix Bm(B, dof, nq), Gm(G, dof, 3*nq);
+  Mult(Ti, U, Bm);
+  Mult(Ti, dU, Gm);
+}
+
+// LG_SerendipityBasis implementation
+LG_SerendipityBasis::LG_SerendipityBasis(
+    const int p_,
+    const IntegrationRule &nodes)
+   : p(p_), dof(LG_SerendipityDof(p_)), Ti(dof)
+{
+  MFEM_VERIFY(p >= 1 && p <= LG_MAX_ORDER, "unimplemented order");
+  MFEM_VERIFY(nodes.GetNPoints() == dof, "wrong number of serendipity nodes");
+
+  // T(o,m) is the o-th hierarchical basis function at node m
+  double u[LG_MAX_DOF];
+  DenseMatrix T(dof);
+  for (int m = 0; m < dof; m++)
+  {
+    const IntegrationPoint &ip = nodes.IntPoint(m);
+    EvalHierarchical(ip.x, ip.y, u);
+    for (int o = 0; o < dof; o++)
+      T(o, m) = u[o];
+  }
+  DenseMatrixInverse Tinv(T);
+  Tinv.GetInverseMatrix(Ti);
+}
+
+void LG_SerendipityBasis::EvalHierarchical(
+    const double x,
+    const double y,
+    double *u) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+
+  Poly_1D::CalcBasis(p, x, shape_x);
+  Poly_1D::CalcBasis(p, y, shape_y);
+
+  // P_p, then the two superlinear terms of degree p+1 (one for p = 1)
+  int o = 0;
+  for (int j = 0; j <= p; j++)
+    for (int i = 0; i + j <= p; i++)
+      u[o++] = shape_x[i]*shape_y[j];
+  u[o++] = shape_x[p]*shape_y[1];
+  if (p > 1)
+    u[o++] = shape_x[1]*shape_y[p];
+}
+
+void LG_SerendipityBasis::EvalHierarchical(
+    const double x,
+    const double y,
+    double *u,
+    double *du_x,
+    double *du_y) const
+{
+  double shape_x[LG_MAX_ORDER+1], shape_y[LG_MAX_ORDER+1];
+  double dshape_x[LG_MAX_ORDER+1], dshape_y[LG_MAX_ORDER+1];
+
+  Poly_1D::CalcBasis(p, x, shape_x, dshape_x);
+  Poly_1D::CalcBasis(p, y, shape_y, dshape_y);
+
+  int o = 0;
+  for (int j = 0; j <= p; j++)
+    for (int i = 0; i + j <= p; i++)
+    {
+      u[o] = shape_x[i]*shape_y[j];
+      du_x[o] = dshape_x[i]*shape_y[j];
+      du_y[o] = shape_x[i]*dshape_y[j];
+      o++;
+    }
+  u[o] = shape_x[p]*shape_y[1];
+  du_x[o] = dshape_x[p]*shape_y[1];
+  du_y[o] = shape_x[p]*dshape_y[1];
+  o++;
+  if (p > 1)
+  {
+    u[o] = shape_x[1]*shape_y[p];
+    du_x[o] = dshape_x[1]*shape_y[p];
+    du_y[o] = shape_x[1]*dshape_y[p];
+  }
+}
+
+void LG_SerendipityBasis::Eval(
+    const double x,
+    const double y,
+    double *shape) const
+{
+  double u[LG_MAX_DOF];
+
+  EvalHierarchical(x, y, u);
+  Ti.Mult(u, shape);
+}
+
+void LG_SerendipityBasis::Eval(
+    const double x,
+    const double y,
+    double *shape,
+    double *dshape_x,
+    double *dshape_y) const
+{
+  double u[LG_MAX_DOF], du_x[LG_MAX_DOF], du_y[LG_MAX_DOF];
+
+  EvalHierarchical(x, y, u, du_x, du_y);
+  Ti.Mult(u, shape);
+  Ti.Mult(du_x, dshape_x);
+  Ti.Mult(du_y, dshape_y);
+}
+
+void LG_SerendipityBasis::Eval(
+    const IntegrationRule &ir,
+    double *B,
+    double *G,
+    double *work) const
+{
+  const int nq = ir.GetNPoints();
+
+  // same column layout as LG_TriangleBasis::Eval
+  DenseMatrix U(work, dof, nq), dU(work + dof*nq, dof, 2*nq);
+  for (int q = 0; q < nq; q++)
+  {
+    const IntegrationPoint &ip = ir.IntPoint(q);
+    EvalHierarchical(ip.x, ip.y, U.GetColumn(q), dU.GetColumn(2*q),
+                     dU.GetColumn(2*q+1));
+  }
+
+  DenseMatrix Bm(B, dof, nq), Gm(G, dof, 2*nq);
+  Mult(Ti, U, Bm);
+  Mult(Ti, dU, Gm);
+}
+
+const LG_Basis1D &LG_GetBasis1D(const int p, const int btype)
+{
+  // populated from element constructors, i.e. before any concurrent use
+  static std::map<std::pair<int,int>, LG_Basis1D> tables;
+
+  const std::pair<int,int> key(p, btype);
+  auto it = tables.find(key);
+  if (it == tables.end())
+  {
+    it = tables.insert(std::make_pair(key, LG_Basis1D(p, btype))).first;
+  }
+  return it->second;
+}
+
+const LG_TriangleBasis &LG_GetTriangleBasis(
+    const int p,
+    const int btype,
+    const IntegrationRule &nodes)
+{
+  static std::map<std::pair<int,int>, LG_TriangleBasis> tables;
+
+  const std::pair<int,int> key(p, btype);
+  auto it = tables.find(key);
+  if (it == tables.end())
+  {
+    it = tables.insert(std::make_pair(key, LG_TriangleBasis(p, nodes))).first;
+  }
+  return it->second;
+}
+
+const LG_TetrahedronBasis &LG_GetTetrahedronBasis(
+    const int p,
+    const int btype,
+    const IntegrationRule &nodes)
+{
+  static std::map<std::pair<int,int>, LG_TetrahedronBasis> tables;
+
+  const std::pair<int,int> key(p, btype);
+  auto it = tables.find(key);
+  if (it == tables.end())
+  {
+    it = tables.insert(
+        std::make_pair(key, LG_TetrahedronBasis(p, nodes))).first;
+  }
+  return it->second;
+}
+
+const LG_SerendipityBasis &LG_GetSerendipityBasis(
+    const int p,
+    const IntegrationRule &nodes)
+{
+  static std::map<int, LG_SerendipityBasis> tables;
+
+  auto it = tables.find(p);
+  if (it == tables.end())
+  {
+    it = tables.insert(std::make_pair(p, LG_SerendipityBasis(p, nodes))).first;
+  }
+  return it->second;
+}
+
+// LG_SegmentElement implementation
+LG_SegmentElement::LG_SegmentElement(
+    const int p,
+    const int btype)
+   : NodalTensorFiniteElement(1, p, VerifyClosed(btype), H1_DOF_MAP),
+     lg_basis(LG_GetBasis1D(p, b_type))
+{
+  const double *cp = lg_basis.GetNodes();
+
+  Nodes.IntPoint(0).x = cp[0];
+  Nodes.IntPoint(1).x = cp[p];
+  for (int i = 1; i < p; i++)
+  {
+    Nodes.IntPoint(i+1).x = cp[i];
+  }
+}
+
+void LG_SegmentElement::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  // get the order from the class member "order"
+  const int p = order;
+  double u[LG_MAX_ORDER+1];
+
+  // Note: in all cases boundary nodes are the first two and then the mid
+  //       nodes, which is exactly what dof_map encodes
+  lg_basis.Eval(ip.x, u);
+  for (int i = 0; i <= p; i++)
+  {
+    shape(dof_map[i]) = u[i];
+  }
+}
+
+void LG_SegmentElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  // get the order from the class member "order"
+  const int p = order;
+  double u[LG_MAX_ORDER+1], d[LG_MAX_ORDER+1];
+
+  lg_basis.Eval(ip.x, u, d);
+  for (int i = 0; i <= p; i++)
+  {
+    dshape(dof_map[i],0) = d[i];
+  }
+}
+
+void LG_SegmentElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int p = order;
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 1);
+
+  // points, values and derivatives in the table's scratch
+  double *t = table.GetWork((2*p + 3)*nq);
+  double *u = t + nq, *d = u + (p+1)*nq;
+  for (int q = 0; q < nq; q++)
+  {
+    t[q] = ir.IntPoint(q).x;
+  }
+  lg_basis.Eval(nq, t, u, d);
+
+  double *B = table.GetShapeData(), *G = table.GetDShapeData();
+  for (int i = 0; i <= p; i++)
+  {
+    const int k = dof_map[i];
+    const double *ui = u + i*nq, *di = d + i*nq;
+    for (int q = 0; q < nq; q++)
+    {
+      B[q*dof + k] = ui[q];
+      G[q*dof + k] = di[q];
+    }
+  }
+}
+
+// LG_SegmentElementP implementation
+template <int P>
+void LG_SegmentElementP<P>::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  double u[P+1];
+  double *s = shape.GetData();
+
+  LG_Kernel1D<P>::Eval(ip.x, u);
+  s[0] = u[0];
+  s[1] = u[P];
+  for (int i = 1; i < P; i++)
+  {
+    s[i+1] = u[i];
+  }
+}
+
+template <int P>
+void LG_SegmentElementP<P>::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  double u[P+1], d[P+1];
+  double *ds = dshape.Data();
+
+  LG_Kernel1D<P>::Eval(ip.x, u, d);
+  ds[0] = d[0];
+  ds[1] = d[P];
+  for (int i = 1; i < P; i++)
+  {
+    ds[i+1] = d[i];
+  }
+}
+
+// LG_QuadrilateralElement implementation
+LG_QuadrilateralElement::LG_QuadrilateralElement(
+    const int p,
+    const int btype)
+   : NodalTensorFiniteElement(2, p, VerifyClosed(btype), H1_DOF_MAP),
+     lg_basis(LG_GetBasis1D(p, b_type))
+{
+  const double *cp = lg_basis.GetNodes();
+
+  int o = 0;
+  for (int j = 0; j <= p; j++)
+    for (int i = 0; i <= p; i++)
+      Nodes.IntPoint(dof_map[o++]).Set2(cp[i], cp[j]);
+}
+
+void LG_QuadrilateralElement::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  const int p = order;
+
+  // Note: In MFEM quads are defined on [0,1]x[0,1]
+  //       The shapes are products of the 1D shapes l_i(x)*l_j(y) and
+  //       dof_map takes the tensor index i + j*(p+1) to the local node
+  //       (vertices first, then edges, then interior) e.g. for p = 2
+  //       node 0: (0,0)
+  //       node 1: (1,0)
+  //       node 2: (1,1)
+  //       node 3: (0,1)
+  //       node 4: (1/2,0)
+  //       node 5: (1,1/2)
+  //       node 6: (1/2,1)
+  //       node 7: (0,1/2)
+  //       node 8: (1/2,1/2)
+  double ux[LG_MAX_ORDER+1], uy[LG_MAX_ORDER+1];
+  lg_basis.Eval(ip.x, ux);
+  lg_basis.Eval(ip.y, uy);
+
+  for (int o = 0, j = 0; j <= p; j++)
+    for (int i = 0; i <= p; i++)
+      shape(dof_map[o++]) = ux[i]*uy[j];
+}
+
+void LG_QuadrilateralElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  const int p = order;
+
+  double ux[LG_MAX_ORDER+1], uy[LG_MAX_ORDER+1];
+  double dx[LG_MAX_ORDER+1], dy[LG_MAX_ORDER+1];
+  lg_basis.Eval(ip.x, ux, dx);
+  lg_basis.Eval(ip.y, uy, dy);
+
+  for (int o = 0, j = 0; j <= p; j++)
+    for (int i = 0; i <= p; i++)
+    {
+      dshape(dof_map[o],0) = dx[i]*uy[j];
+      dshape(dof_map[o],1) = ux[i]*dy[j];
+      o++;
+    }
+}
+
+void LG_QuadrilateralElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int p = order;
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 2);
+
+  // per direction: points, values and derivatives in the table's scratch
+  const int n1 = (2*p + 3)*nq;
+  double *tx = table.GetWork(2*n1), *ty = tx + n1;
+  double *ux = tx + nq, *dx = ux + (p+1)*nq;
+  double *uy = ty + nq, *dy = uy + (p+1)*nq;
+  for (int q = 0; q < nq; q++)
+  {
+    tx[q] = ir.IntPoint(q).x;
+    ty[q] = ir.IntPoint(q).y;
+  }
+  lg_basis.Eval(nq, tx, ux, dx);
+  lg_basis.Eval(nq, ty, uy, dy);
+
+  double *B = table.GetShapeData(), *G = table.GetDShapeData();
+  for (int o = 0, j = 0; j <= p; j++)
+    for (int i = 0; i <= p; i++)
+    {
+      const int k = dof_map[o++];
+      const double *uxi = ux + i*nq, *dxi = dx + i*nq;
+      const double *uyj = uy + j*nq, *dyj = dy + j*nq;
+      for (int q = 0; q < nq; q++)
+      {
+        B[q*dof + k] = uxi[q]*uyj[q];
+        G[(2*q + 0)*dof + k] = dxi[q]*uyj[q];
+        G[(2*q + 1)*dof + k] = uxi[q]*dyj[q];
+      }
+    }
+}
+
+void LG_QuadrilateralElement::Interpolate(
+    const LG_TensorMaps &maps,
+    const double *u,
+    double *uq) const
+{
+  LG_TensorDispatch<LG_QuadInterpolate>(maps, dof_map.GetData(), u, uq);
+}
+
+template <int D_, int Q_>
+void LG_QuadInterpolate::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *u,
+    double *uq)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data();
+  double ul[(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double t[LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  for (int o = 0; o < D*D; o++)
+  {
+    ul[o] = u[dof_map[o]];
+  }
+  // t(qx,j) = sum_i B(qx,i) u(i,j)
+  for (int j = 0; j < D; j++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double s = 0.;
+      for (int i = 0; i < D; i++)
+        s += B[qx + i*Q]*ul[i + j*D];
+      t[qx + j*Q] = s;
+    }
+  // uq(qx,qy) = sum_j B(qy,j) t(qx,j)
+  for (int qy = 0; qy < Q; qy++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double s = 0.;
+      for (int j = 0; j < D; j++)
+        s += B[qy + j*Q]*t[qx + j*Q];
+      uq[qx + qy*Q] = s;
+    }
+}
+
+void LG_QuadrilateralElement::InterpolateGrad(
+    const LG_TensorMaps &maps,
+    const double *u,
+    double *duq) const
+{
+  LG_TensorDispatch<LG_QuadInterpolateGrad>(maps, dof_map.GetData(), u, duq);
+}
+
+template <int D_, int Q_>
+void LG_QuadInterpolateGrad::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *u,
+    double *duq)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data(), *G = maps.G.Data();
+  double ul[(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double tb[LG_MAX_Q1D*(LG_MAX_ORDER+1)], tg[LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  for (int o = 0; o < D*D; o++)
+  {
+    ul[o] = u[dof_map[o]];
+  }
+  // tb(qx,j) = sum_i B(qx,i) u(i,j), tg(qx,j) = sum_i G(qx,i) u(i,j)
+  for (int j = 0; j < D; j++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double sb = 0., sg = 0.;
+      for (int i = 0; i < D; i++)
+      {
+        sb += B[qx + i*Q]*ul[i + j*D];
+        sg += G[qx + i*Q]*ul[i + j*D];
+      }
+      tb[qx + j*Q] = sb;
+      tg[qx + j*Q] = sg;
+    }
+  // du/dx = sum_j B(qy,j) tg(qx,j), du/dy = sum_j G(qy,j) tb(qx,j)
+  double *dx = duq, *dy = duq + Q*Q;
+  for (int qy = 0; qy < Q; qy++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double sx = 0., sy = 0.;
+      for (int j = 0; j < D; j++)
+      {
+        sx += B[qy + j*Q]*tg[qx + j*Q];
+        sy += G[qy + j*Q]*tb[qx + j*Q];
+      }
+      dx[qx + qy*Q] = sx;
+      dy[qx + qy*Q] = sy;
+    }
+}
+
+void LG_QuadrilateralElement::AddInterpolateTranspose(
+    const LG_TensorMaps &maps,
+    const double *uq,
+    double *v) const
+{
+  LG_TensorDispatch<LG_QuadAddInterpolateTranspose>(maps, dof_map.GetData(), uq, v);
+}
+
+template <int D_, int Q_>
+void LG_QuadAddInterpolateTranspose::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *uq,
+    double *v)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data();
+  double t[LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  // t(qx,j) = sum_qy B(qy,j) uq(qx,qy)
+  for (int j = 0; j < D; j++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double s = 0.;
+      for (int qy = 0; qy < Q; qy++)
+        s += B[qy + j*Q]*uq[qx + qy*Q];
+      t[qx + j*Q] = s;
+    }
+  // v(i,j) += sum_qx B(qx,i) t(qx,j)
+  for (int o = 0, j = 0; j < D; j++)
+    for (int i = 0; i < D; i++)
+    {
+      double s = 0.;
+      for (int qx = 0; qx < Q; qx++)
+        s += B[qx + i*Q]*t[qx + j*Q];
+      v[dof_map[o++]] += s;
+    }
+}
+
+void LG_QuadrilateralElement::AddInterpolateGradTranspose(
+    const LG_TensorMaps &maps,
+    const double *duq,
+    double *v) const
+{
+  LG_TensorDispatch<LG_QuadAddInterpolateGradTranspose>(maps, dof_map.GetData(), duq, v);
+}
+
+template <int D_, int Q_>
+void LG_QuadAddInterpolateGradTranspose::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *duq,
+    double *v)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data(), *G = maps.G.Data();
+  const double *dx = duq, *dy = duq + Q*Q;
+  double tx[LG_MAX_Q1D*(LG_MAX_ORDER+1)], ty[LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  // tx(qx,j) = sum_qy B(qy,j) dx(qx,qy), ty(qx,j) = sum_qy G(qy,j) dy(qx,qy)
+  for (int j = 0; j < D; j++)
+    for (int qx = 0; qx < Q; qx++)
+    {
+      double sx = 0., sy = 0.;
+      for (int qy = 0; qy < Q; qy++)
+      {
+        sx += B[qy + j*Q]*dx[qx + qy*Q];
+        sy += G[qy + j*Q]*dy[qx + qy*Q];
+      }
+      tx[qx + j*Q] = sx;
+      ty[qx + j*Q] = sy;
+    }
+  // v(i,j) += sum_qx G(qx,i) tx(qx,j) + B(qx,i) ty(qx,j)
+  for (int o = 0, j = 0; j < D; j++)
+    for (int i = 0; i < D; i++)
+    {
+      double s = 0.;
+      for (int qx = 0; qx < Q; qx++)
+        s += G[qx + i*Q]*tx[qx + j*Q] + B[qx + i*Q]*ty[qx + j*Q];
+      v[dof_map[o++]] += s;
+    }
+}
+
+
+// LG_QuadrilateralElementP implementation
+template <int P>
+void LG_QuadrilateralElementP<P>::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  double ux[P+1], uy[P+1];
+  const int *map = dof_map.GetData();
+  double *s = shape.GetData();
+
+  LG_Kernel1D<P>::Eval(ip.x, ux);
+  LG_Kernel1D<P>::Eval(ip.y, uy);
+  for (int j = 0; j <= P; j++)
+    for (int i = 0; i <= P; i++)
+      s[map[i + j*(P+1)]] = ux[i]*uy[j];
+}
+
+template <int P>
+void LG_QuadrilateralElementP<P>::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  const int D = (P+1)*(P+1);
+  double ux[P+1], uy[P+1], dx[P+1], dy[P+1];
+  const int *map = dof_map.GetData();
+  double *ds = dshape.Data();
+
+  LG_Kernel1D<P>::Eval(ip.x, ux, dx);
+  LG_Kernel1D<P>::Eval(ip.y, uy, dy);
+  for (int j = 0; j <= P; j++)
+    for (int i = 0; i <= P; i++)
+    {
+      const int k = map[i + j*(P+1)];
+      ds[k] = dx[i]*uy[j];
+      ds[k + D] = ux[i]*dy[j];
+    }
+}
+
+// LG_HexahedronElement implementation
+LG_HexahedronElement::LG_HexahedronElement(
+    const int p,
+    const int btype)
+   : NodalTensorFiniteElement(3, p, VerifyClosed(btype), H1_DOF_MAP),
+     lg_basis(LG_GetBasis1D(p, b_type))
+{
+  const double *cp = lg_basis.GetNodes();
+
+  int o = 0;
+  for (int k = 0; k <= p; k++)
+    for (int j = 0; j <= p; j++)
+      for (int i = 0; i <= p; i++)
+        Nodes.IntPoint(dof_map[o++]).Set3(cp[i], cp[j], cp[k]);
+}
+
+void LG_HexahedronElement::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  const int p = order;
+
+  // Note: hexes are defined on [0,1]^3 and dof_map takes the tensor index
+  //       i + (j + k*(p+1))*(p+1) to the local node (vertices, edges, faces
+  //       and then the interior)
+  double ux[LG_MAX_ORDER+1], uy[LG_MAX_ORDER+1], uz[LG_MAX_ORDER+1];
+  lg_basis.Eval(ip.x, ux);
+  lg_basis.Eval(ip.y, uy);
+  lg_basis.Eval(ip.z, uz);
+
+  for (int o = 0, k = 0; k <= p; k++)
+    for (int j = 0; j <= p; j++)
+      for (int i = 0; i <= p; i++)
+        shape(dof_map[o++]) = ux[i]*uy[j]*uz[k];
+}
+
+void LG_HexahedronElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  const int p = order;
+
+  double ux[LG_MAX_ORDER+1], uy[LG_MAX_ORDER+1], uz[LG_MAX_ORDER+1];
+  double dx[LG_MAX_ORDER+1], dy[LG_MAX_ORDER+1], dz[LG_MAX_ORDER+1];
+  lg_basis.Eval(ip.x, ux, dx);
+  lg_basis.Eval(ip.y, uy, dy);
+  lg_basis.Eval(ip.z, uz, dz);
+
+  for (int o = 0, k = 0; k <= p; k++)
+    for (int j = 0; j <= p; j++)
+      for (int i = 0; i <= p; i++)
+      {
+        dshape(dof_map[o],0) = dx[i]*uy[j]*uz[k];
+        dshape(dof_map[o],1) = ux[i]*dy[j]*uz[k];
+        dshape(dof_map[o],2) = ux[i]*uy[j]*dz[k];
+        o++;
+      }
+}
+
+void LG_HexahedronElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int p = order;
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 3);
+
+  const int n1 = (2*p + 3)*nq;
+  double *tx = table.GetWork(3*n1), *ty = tx + n1, *tz = ty + n1;
+  double *ux = tx + nq, *dx = ux + (p+1)*nq;
+  double *uy = ty + nq, *dy = uy + (p+1)*nq;
+  double *uz = tz + nq, *dz = uz + (p+1)*nq;
+  for (int q = 0; q < nq; q++)
+  {
+    tx[q] = ir.IntPoint(q).x;
+    ty[q] = ir.IntPoint(q).y;
+    tz[q] = ir.IntPoint(q).z;
+  }
+  lg_basis.Eval(nq, tx, ux, dx);
+  lg_basis.Eval(nq, ty, uy, dy);
+  lg_basis.Eval(nq, tz, uz, dz);
+
+  double *B = table.GetShapeData(), *G = table.GetDShapeData();
+  for (int o = 0, k = 0; k <= p; k++)
+    for (int j = 0; j <= p; j++)
+      for (int i = 0; i <= p; i++)
+      {
+        const int m = dof_map[o++];
+        const double *uxi = ux + i*nq, *dxi = dx + i*nq;
+        const double *uyj = uy + j*nq, *dyj = dy + j*nq;
+        const double *uzk = uz + k*nq, *dzk = dz + k*nq;
+        for (int q = 0; q < nq; q++)
+        {
+          B[q*dof + m] = uxi[q]*uyj[q]*uzk[q];
+          G[(3*q + 0)*dof + m] = dxi[q]*uyj[q]*uzk[q];
+          G[(3*q + 1)*dof + m] = uxi[q]*dyj[q]*uzk[q];
+          G[(3*q + 2)*dof + m] = uxi[q]*uyj[q]*dzk[q];
+        }
+      }
+}
+
+void LG_HexahedronElement::Interpolate(
+    const LG_TensorMaps &maps,
+    const double *u,
+    double *uq) const
+{
+  LG_TensorDispatch<LG_HexInterpolate>(maps, dof_map.GetData(), u, uq);
+}
+
+template <int D_, int Q_>
+void LG_HexInterpolate::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *u,
+    double *uq)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data();
+  double ul[LG_MAX_DOF];
+  double t1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double t2[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  for (int o = 0; o < D*D*D; o++)
+  {
+    ul[o] = u[dof_map[o]];
+  }
+  // t1(qx,j,k) = sum_i B(qx,i) u(i,j,k)
+  for (int k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double s = 0.;
+        for (int i = 0; i < D; i++)
+          s += B[qx + i*Q]*ul[i + (j + k*D)*D];
+        t1[qx + (j + k*D)*Q] = s;
+      }
+  // t2(qx,qy,k) = sum_j B(qy,j) t1(qx,j,k)
+  for (int k = 0; k < D; k++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double s = 0.;
+        for (int j = 0; j < D; j++)
+          s += B[qy + j*Q]*t1[qx + (j + k*D)*Q];
+        t2[qx + (qy + k*Q)*Q] = s;
+      }
+  // uq(qx,qy,qz) = sum_k B(qz,k) t2(qx,qy,k)
+  for (int qz = 0; qz < Q; qz++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double s = 0.;
+        for (int k = 0; k < D; k++)
+          s += B[qz + k*Q]*t2[qx + (qy + k*Q)*Q];
+        uq[qx + (qy + qz*Q)*Q] = s;
+      }
+}
+
+void LG_HexahedronElement::InterpolateGrad(
+    const LG_TensorMaps &maps,
+    const double *u,
+    double *duq) const
+{
+  LG_TensorDispatch<LG_HexInterpolateGrad>(maps, dof_map.GetData(), u, duq);
+}
+
+template <int D_, int Q_>
+void LG_HexInterpolateGrad::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *u,
+    double *duq)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data(), *G = maps.G.Data();
+  double ul[LG_MAX_DOF];
+  double b1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double g1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double bb[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+  double gb[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+  double bg[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  for (int o = 0; o < D*D*D; o++)
+  {
+    ul[o] = u[dof_map[o]];
+  }
+  // contract x: b1 with B(qx,i), g1 with G(qx,i)
+  for (int k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double sb = 0., sg = 0.;
+        for (int i = 0; i < D; i++)
+        {
+          sb += B[qx + i*Q]*ul[i + (j + k*D)*D];
+          sg += G[qx + i*Q]*ul[i + (j + k*D)*D];
+        }
+        b1[qx + (j + k*D)*Q] = sb;
+        g1[qx + (j + k*D)*Q] = sg;
+      }
+  // contract y: bb = B_y b1, gb = B_y g1, bg = G_y b1
+  for (int k = 0; k < D; k++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double sbb = 0., sgb = 0., sbg = 0.;
+        for (int j = 0; j < D; j++)
+        {
+          const int t = qx + (j + k*D)*Q;
+          sbb += B[qy + j*Q]*b1[t];
+          sgb += B[qy + j*Q]*g1[t];
+          sbg += G[qy + j*Q]*b1[t];
+        }
+        const int r = qx + (qy + k*Q)*Q;
+        bb[r] = sbb;
+        gb[r] = sgb;
+        bg[r] = sbg;
+      }
+  // contract z: du/dx = B_z gb, du/dy = B_z bg, du/dz = G_z bb
+  const int nq = Q*Q*Q;
+  double *dx = duq, *dy = duq + nq, *dz = duq + 2*nq;
+  for (int qz = 0; qz < Q; qz++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double sx = 0., sy = 0., sz = 0.;
+        for (int k = 0; k < D; k++)
+        {
+          const int r = qx + (qy + k*Q)*Q;
+          sx += B[qz + k*Q]*gb[r];
+          sy += B[qz + k*Q]*bg[r];
+          sz += G[qz + k*Q]*bb[r];
+        }
+        const int q = qx + (qy + qz*Q)*Q;
+        dx[q] = sx;
+        dy[q] = sy;
+        dz[q] = sz;
+      }
+}
+
+void LG_HexahedronElement::AddInterpolateTranspose(
+    const LG_TensorMaps &maps,
+    const double *uq,
+    double *v) const
+{
+  LG_TensorDispatch<LG_HexAddInterpolateTranspose>(maps, dof_map.GetData(), uq, v);
+}
+
+template <int D_, int Q_>
+void LG_HexAddInterpolateTranspose::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *uq,
+    double *v)
+{
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data();
+  double t1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double t2[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+
+  // t2(qx,qy,k) = sum_qz B(qz,k) uq(qx,qy,qz)
+  for (int k = 0; k < D; k++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double s = 0.;
+        for (int qz = 0; qz < Q; qz++)
+          s += B[qz + k*Q]*uq[qx + (qy + qz*Q)*Q];
+        t2[qx + (qy + k*Q)*Q] = s;
+      }
+  // t1(qx,j,k) = sum_qy B(qy,j) t2(qx,qy,k)
+  for (int k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double s = 0.;
+        for (int qy = 0; qy < Q; qy++)
+          s += B[qy + j*Q]*t2[qx + (qy + k*Q)*Q];
+        t1[qx + (j + k*D)*Q] = s;
+      }
+  // v(i,j,k) += sum_qx B(qx,i) t1(qx,j,k)
+  for (int o = 0, k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int i = 0; i < D; i++)
+      {
+        double s = 0.;
+        for (int qx = 0; qx < Q; qx++)
+          s += B[qx + i*Q]*t1[qx + (j + k*D)*Q];
+        v[dof_map[o++]] += s;
+      }
+}
+
+void LG_HexahedronElement::AddInterpolateGradTranspose(
+    const LG_TensorMaps &maps,
+    const double *duq,
+    double *v) const
+{
+  LG_TensorDispatch<LG_HexAddInterpolateGradTranspose>(maps, dof_map.GetData(), duq, v);
+}
+
+template <int D_, int Q_>
+void LG_HexAddInterpolateGradTranspose::Run(
+    const LG_TensorMaps &maps,
+    const int *dof_map,
+    const double *duq,
+    double *v)
 {
-  const double *cp = poly1d.ClosedPoints(p, b_type);
+  const int D = D_ ? D_ : maps.ndof1d, Q = Q_ ? Q_ : maps.nqpt1d;
+  const double *B = maps.B.Data(), *G = maps.G.Data();
+  const int nq = Q*Q*Q;
+  const double *dx = duq, *dy = duq + nq, *dz = duq + 2*nq;
+  double b1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double g1[LG_MAX_Q1D*(LG_MAX_ORDER+1)*(LG_MAX_ORDER+1)];
+  double bb[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+  double gb[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
+  double bg[LG_MAX_Q1D*LG_MAX_Q1D*(LG_MAX_ORDER+1)];
 
-  int o = 0;
-  for (int j = 0; j <= p; j++)
-    for (int i = 0; i <= p; i++)
-      Nodes.IntPoint(dof_map[o++]).Set2(cp[i], cp[j]);
+  // contract z: gb = B_z^T dx, bg = B_z^T dy, bb = G_z^T dz
+  for (int k = 0; k < D; k++)
+    for (int qy = 0; qy < Q; qy++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double sx = 0., sy = 0., sz = 0.;
+        for (int qz = 0; qz < Q; qz++)
+        {
+          const int q = qx + (qy + qz*Q)*Q;
+          sx += B[qz + k*Q]*dx[q];
+          sy += B[qz + k*Q]*dy[q];
+          sz += G[qz + k*Q]*dz[q];
+        }
+        const int r = qx + (qy + k*Q)*Q;
+        gb[r] = sx;
+        bg[r] = sy;
+        bb[r] = sz;
+      }
+  // contract y: g1 = B_y^T gb, b1 = G_y^T bg + B_y^T bb
+  for (int k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int qx = 0; qx < Q; qx++)
+      {
+        double sg = 0., sb = 0.;
+        for (int qy = 0; qy < Q; qy++)
+        {
+          const int r = qx + (qy + k*Q)*Q;
+          sg += B[qy + j*Q]*gb[r];
+          sb += G[qy + j*Q]*bg[r] + B[qy + j*Q]*bb[r];
+        }
+        g1[qx + (j + k*D)*Q] = sg;
+        b1[qx + (j + k*D)*Q] = sb;
+      }
+  // contract x: v(i,j,k) += G_x^T g1 + B_x^T b1
+  for (int o = 0, k = 0; k < D; k++)
+    for (int j = 0; j < D; j++)
+      for (int i = 0; i < D; i++)
+      {
+        double s = 0.;
+        for (int qx = 0; qx < Q; qx++)
+        {
+          const int t = qx + (j + k*D)*Q;
+          s += G[qx + i*Q]*g1[t] + B[qx + i*Q]*b1[t];
+        }
+        v[dof_map[o++]] += s;
+      }
 }
 
-void LG_QuadrilateralElement::CalcShape(
+
+// LG_HexahedronElementP implementation
+template <int P>
+void LG_HexahedronElementP<P>::CalcShape(
     const IntegrationPoint &ip,
     Vector &shape) const
 {
-  const int p = order;
-
-  // Note: In MFEM quads are defined on [0,1]x[0,1]
-  //       Nodes for 1st order quads are as follows
-  //       node 0: (0,0)
-  //       node 1: (1,0)
-  //       node 2: (1,1)
-  //       node 3: (0,1)
-  //
-  //       Nodes for 2nd order quads are as follows
-  //       node 0: (0,0)
-  //       node 1: (1,0)
-  //       node 2: (1,1)
-  //       node 3: (0,1)
-  //       node 4: (1/2,0)
-  //       node 5: (1,1/2)
-  //       node 6: (1/2,1)
-  //       node 7: (0,1/2)
-  //       node 8: (1/2,1/2)
-  if (p == 1)
-  {
-    // TODO: implement 1st order shapes for quads
-    shape(0) = 0.;
-    shape(1) = 0.;
-    shape(2) = 0.;
-    shape(3) = 0.;
-  }
-  else if (p == 2)
-  {
-    // TODO: implement 2st order shapes for quads (9-nodes)
-    shape(0) = 0.;
-    shape(1) = 0.;
-    shape(2) = 0.;
-    shape(3) = 0.;
-    shape(4) = 0.;
-    shape(5) = 0.;
-    shape(6) = 0.;
-    shape(7) = 0.;
-    shape(8) = 0.;
-  }
-  else
-  {
-    MFEM_VERIFY(0, "unimplemented order");
-  }
+  double ux[P+1], uy[P+1], uz[P+1];
+  const int *map = dof_map.GetData();
+  double *s = shape.GetData();
 
+  LG_Kernel1D<P>::Eval(ip.x, ux);
+  LG_Kernel1D<P>::Eval(ip.y, uy);
+  LG_Kernel1D<P>::Eval(ip.z, uz);
+  for (int k = 0; k <= P; k++)
+    for (int j = 0; j <= P; j++)
+      for (int i = 0; i <= P; i++)
+        s[map[i + (j + k*(P+1))*(P+1)]] = ux[i]*uy[j]*uz[k];
 }
 
-void LG_QuadrilateralElement::CalcDShape(
+template <int P>
+void LG_HexahedronElementP<P>::CalcDShape(
     const IntegrationPoint &ip,
     DenseMatrix &dshape) const
 {
-  const int p = order;
-
-  // Note: In MFEM quads are defined on [0,1]x[0,1]
-  //       Nodes for 1st order quads are as follows
-  //       node 0: (0,0)
-  //       node 1: (1,0)
-  //       node 2: (1,1)
-  //       node 3: (0,1)
-  //
-  //       Nodes for 2nd order quads are as follows
-  //       node 0: (0,0)
-  //       node 1: (1,0)
-  //       node 2: (1,1)
-  //       node 3: (0,1)
-  //       node 4: (1/2,0)
-  //       node 5: (1,1/2)
-  //       node 6: (1/2,1)
-  //       node 7: (0,1/2)
-  //       node 8: (1/2,1/2)
-  if (p == 1)
-  {
-    // TODO: implement derivative of 1st order shapes for quads wrt ip.x
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
-    dshape(2,0) = 0.;
-    dshape(3,0) = 0.;
-
-    // TODO: implement derivative of 1st order shapes for quads wrt ip.y
-    dshape(0,1) = 0.;
-    dshape(1,1) = 0.;
-    dshape(2,1) = 0.;
-    dshape(3,1) = 0.;
-  }
-  else if (p == 2)
-  {
-    // TODO: implement derivative of 2nd order shapes for quads wrt ip.x
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
-    dshape(2,0) = 0.;
-    dshape(3,0) = 0.;
-    dshape(4,0) = 0.;
-    dshape(5,0) = 0.;
-    dshape(6,0) = 0.;
-    dshape(7,0) = 0.;
-    dshape(8,0) = 0.;
-
-    // TODO: implement derivative of 2nd order shapes for quads wrt ip.y
-    dshape(0,1) = 0.;
-    dshape(1,1) = 0.;
-    dshape(2,1) = 0.;
-    dshape(3,1) = 0.;
-    dshape(4,1) = 0.;
-    dshape(5,1) = 0.;
-    dshape(6,1) = 0.;
-    dshape(7,1) = 0.;
-    dshape(8,1) = 0.;
-  }
-  else
-  {
-    MFEM_VERIFY(0, "unimplemented order");
-  }
+  const int D = (P+1)*(P+1)*(P+1);
+  double ux[P+1], uy[P+1], uz[P+1], dx[P+1], dy[P+1], dz[P+1];
+  const int *map = dof_map.GetData();
+  double *ds = dshape.Data();
 
+  LG_Kernel1D<P>::Eval(ip.x, ux, dx);
+  LG_Kernel1D<P>::Eval(ip.y, uy, dy);
+  LG_Kernel1D<P>::Eval(ip.z, uz, dz);
+  for (int k = 0; k <= P; k++)
+    for (int j = 0; j <= P; j++)
+      for (int i = 0; i <= P; i++)
+      {
+        const int m = map[i + (j + k*(P+1))*(P+1)];
+        ds[m] = dx[i]*uy[j]*uz[k];
+        ds[m + D] = ux[i]*dy[j]*uz[k];
+        ds[m + 2*D] = ux[i]*uy[j]*dz[k];
+      }
 }
 
-
 // LG_TriangleElement implementation
 LG_TriangleElement::LG_TriangleElement(
     const int p,
@@ -300,7 +2210,8 @@ LG_TriangleElement::LG_TriangleElement(
    : NodalFiniteElement(2, Geometry::TRIANGLE, ((p + 1)*(p + 2))/2, p,
                         FunctionSpace::Pk)
 {
-  const double *cp = poly1d.ClosedPoints(p, VerifyNodal(VerifyClosed(btype)));
+  const int b_type = VerifyNodal(VerifyClosed(btype));
+  const double *cp = LG_GetBasis1D(p, b_type).GetNodes();
 
   // vertices
   Nodes.IntPoint(0).Set2(cp[0], cp[0]);
@@ -329,79 +2240,303 @@ LG_TriangleElement::LG_TriangleElement(
       const double w = cp[i] + cp[j] + cp[p-i-j];
       Nodes.IntPoint(o++).Set2(cp[i]/w, cp[j]/w);
     }
+
+  lg_basis = &LG_GetTriangleBasis(p, b_type, Nodes);
 }
 
 void LG_TriangleElement::CalcShape(
     const IntegrationPoint &ip,
     Vector &shape) const
 {
-  // get the order from the class member "order"
-  const int p = order;
-  // Note: in all cases boundary nodes are the first two and then the interior nodes
-  if (p == 1)
+  // Note: the parametric coordinates are ip.x and ip.y and the shapes are
+  //       ordered as the Nodes: vertices, edges and then the interior nodes
+  lg_basis->Eval(ip.x, ip.y, shape.GetData());
+}
+
+void LG_TriangleElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  double shape[((LG_MAX_ORDER + 1)*(LG_MAX_ORDER + 2))/2];
+
+  // dshape is column major, so column 0 holds d/dx and column 1 d/dy
+  lg_basis->Eval(ip.x, ip.y, shape, dshape.GetColumn(0), dshape.GetColumn(1));
+}
+
+void LG_TriangleElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 2);
+  lg_basis->Eval(ir, table.GetShapeData(), table.GetDShapeData(),
+                 table.GetWork(3*dof*nq));
+}
+
+// LG_TriangleElementP implementation
+template <int P>
+LG_TriangleElementP<P>::LG_TriangleElementP(const int btype)
+   : LG_TriangleElement(P, btype)
+{
+  Vector shape(dof);
+  for (int m = 0; m < dof; m++)
+  {
+    CalcShape(Nodes.IntPoint(m), shape);
+    shape(m) -= 1.;
+    MFEM_VERIFY(shape.Normlinf() < 1e-10, "the order " << P << " triangle "
+        "table does not match the nodes");
+  }
+}
+
+template <int P>
+void LG_TriangleElementP<P>::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  LG_TriKernel<P>::Eval(ip.x, ip.y, shape.GetData());
+}
+
+template <int P>
+void LG_TriangleElementP<P>::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  LG_TriKernel<P>::Eval(ip.x, ip.y, dshape.GetColumn(0), dshape.GetColumn(1));
+}
+
+// LG_TetrahedronElement implementation
+LG_TetrahedronElement::LG_TetrahedronElement(
+    const int p,
+    const int btype)
+   : NodalFiniteElement(3, Geometry::TETRAHEDRON,
+                        ((p + 1)*(p + 2)*(p + 3))/6, p, FunctionSpace::Pk)
+{
+  const int b_type = VerifyNodal(VerifyClosed(btype));
+  const double *cp = LG_GetBasis1D(p, b_type).GetNodes();
+
+  // vertices
+  Nodes.IntPoint(0).Set3(cp[0], cp[0], cp[0]);
+  Nodes.IntPoint(1).Set3(cp[p], cp[0], cp[0]);
+  Nodes.IntPoint(2).Set3(cp[0], cp[p], cp[0]);
+  Nodes.IntPoint(3).Set3(cp[0], cp[0], cp[p]);
+
+  // edges (see Tetrahedron::edges in mesh/tetrahedron.cpp)
+  int o = 4;
+  for (int i = 1; i < p; i++)  // (0,1)
   {
-    // TODO: implement 1st order shapes for triangles
-    // Note the parametric coordinates are ip.x and ip.y
-    shape(0) = 0.;
-    shape(1) = 0.;
-    shape(2) = 0.;
+    Nodes.IntPoint(o++).Set3(cp[i], cp[0], cp[0]);
   }
-  else if (p == 2)
+  for (int i = 1; i < p; i++)  // (0,2)
   {
-    // TODO: implement 2nd order shapes for triangles
-    shape(0) = 0.;
-    shape(1) = 0.;
-    shape(2) = 0.;
-    shape(3) = 0.;
-    shape(4) = 0.;
-    shape(5) = 0.;
+    Nodes.IntPoint(o++).Set3(cp[0], cp[i], cp[0]);
   }
-  else
+  for (int i = 1; i < p; i++)  // (0,3)
+  {
+    Nodes.IntPoint(o++).Set3(cp[0], cp[0], cp[i]);
+  }
+  for (int i = 1; i < p; i++)  // (1,2)
+  {
+    Nodes.IntPoint(o++).Set3(cp[p-i], cp[i], cp[0]);
+  }
+  for (int i = 1; i < p; i++)  // (1,3)
+  {
+    Nodes.IntPoint(o++).Set3(cp[p-i], cp[0], cp[i]);
+  }
+  for (int i = 1; i < p; i++)  // (2,3)
+  {
+    Nodes.IntPoint(o++).Set3(cp[0], cp[p-i], cp[i]);
+  }
+
+  // faces (see Mesh::GenerateFaces in mesh/mesh.cpp), each in the local
+  // ordering of the face triangle so that TriDofOrd applies
+  for (int j = 1; j < p; j++)
+    for (int i = 1; i + j < p; i++)  // (1,2,3)
+    {
+      const double w = cp[i] + cp[j] + cp[p-i-j];
+      Nodes.IntPoint(o++).Set3(cp[p-i-j]/w, cp[i]/w, cp[j]/w);
+    }
+  for (int j = 1; j < p; j++)
+    for (int i = 1; i + j < p; i++)  // (0,3,2)
+    {
+      const double w = cp[i] + cp[j] + cp[p-i-j];
+      Nodes.IntPoint(o++).Set3(cp[0], cp[j]/w, cp[i]/w);
+    }
+  for (int j = 1; j < p; j++)
+    for (int i = 1; i + j < p; i++)  // (0,1,3)
+    {
+      const double w = cp[i] + cp[j] + cp[p-i-j];
+      Nodes.IntPoint(o++).Set3(cp[i]/w, cp[0], cp[j]/w);
+    }
+  for (int j = 1; j < p; j++)
+    for (int i = 1; i + j < p; i++)  // (0,2,1)
+    {
+      const double w = cp[i] + cp[j] + cp[p-i-j];
+      Nodes.IntPoint(o++).Set3(cp[j]/w, cp[i]/w, cp[0]);
+    }
+
+  // interior
+  for (int k = 1; k < p; k++)
+    for (int j = 1; j + k < p; j++)
+      for (int i = 1; i + j + k < p; i++)
+      {
+        const double w = cp[i] + cp[j] + cp[k] + cp[p-i-j-k];
+        Nodes.IntPoint(o++).Set3(cp[i]/w, cp[j]/w, cp[k]/w);
+      }
+
+  lg_basis = &LG_GetTetrahedronBasis(p, b_type, Nodes);
+}
+
+void LG_TetrahedronElement::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  lg_basis->Eval(ip.x, ip.y, ip.z, shape.GetData());
+}
+
+void LG_TetrahedronElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  double shape[LG_MAX_DOF];
+
+  lg_basis->Eval(ip.x, ip.y, ip.z, shape, dshape.GetColumn(0),
+                 dshape.GetColumn(1), dshape.GetColumn(2));
+}
+
+void LG_TetrahedronElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 3);
+  lg_basis->Eval(ir, table.GetShapeData(), table.GetDShapeData(),
+                 table.GetWork(4*dof*nq));
+}
+
+// LG_TetrahedronElementP implementation
+template <int P>
+LG_TetrahedronElementP<P>::LG_TetrahedronElementP(const int btype)
+   : LG_TetrahedronElement(P, btype)
+{
+  Vector shape(dof);
+  for (int m = 0; m < dof; m++)
   {
-    MFEM_VERIFY(0, "unimplemented order");
+    CalcShape(Nodes.IntPoint(m), shape);
+    shape(m) -= 1.;
+    MFEM_VERIFY(shape.Normlinf() < 1e-10, "the order " << P << " tetrahedron "
+        "table does not match the nodes");
   }
 }
 
-void LG_TriangleElement::CalcDShape(
+template <int P>
+void LG_TetrahedronElementP<P>::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  LG_TetKernel<P>::Eval(ip.x, ip.y, ip.z, shape.GetData());
+}
+
+template <int P>
+void LG_TetrahedronElementP<P>::CalcDShape(
     const IntegrationPoint &ip,
     DenseMatrix &dshape) const
 {
-  // get the order from the class member "order"
-  const int p = order;
-  // Note: in all cases boundary nodes are the first two and then the interior nodes
-  if (p == 1)
-  {
-    // TODO: implement first derivative of 1st order shapes with respect to ip.x for triangles
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
-    dshape(2,0) = 0.;
-
-    // TODO: implement first derivative of 1st order shapes with respect to ip.y for triangles
-    dshape(0,1) = 0.;
-    dshape(1,1) = 0.;
-    dshape(2,1) = 0.;
-  }
-  else if (p == 2)
-  {
-    // TODO: implement first derivative of 2nd order shapes with respect to ip.x for triangles
-    dshape(0,0) = 0.;
-    dshape(1,0) = 0.;
-    dshape(2,0) = 0.;
-    dshape(3,0) = 0.;
-    dshape(4,0) = 0.;
-    dshape(5,0) = 0.;
-
-    // TODO: implement first derivative of 2nd order shapes with respect to ip.y for triangles
-    dshape(0,1) = 0.;
-    dshape(1,1) = 0.;
-    dshape(2,1) = 0.;
-    dshape(3,1) = 0.;
-    dshape(4,1) = 0.;
-    dshape(5,1) = 0.;
+  LG_TetKernel<P>::Eval(ip.x, ip.y, ip.z, dshape.GetColumn(0),
+                        dshape.GetColumn(1), dshape.GetColumn(2));
+}
+
+// LG_SerendipityQuadElement implementation
+LG_SerendipityQuadElement::LG_SerendipityQuadElement(const int p)
+   : NodalFiniteElement(2, Geometry::SQUARE, LG_SerendipityDof(p), p,
+                        FunctionSpace::Qk)
+{
+  const double *cp = LG_GetBasis1D(p, BasisType::GaussLobatto).GetNodes();
+
+  // vertices and edges exactly as in LG_QuadrilateralElement, so the two
+  // elements agree on the shared edges
+  Nodes.IntPoint(0).Set2(cp[0], cp[0]);
+  Nodes.IntPoint(1).Set2(cp[p], cp[0]);
+  Nodes.IntPoint(2).Set2(cp[p], cp[p]);
+  Nodes.IntPoint(3).Set2(cp[0], cp[p]);
+
+  int o = 4;
+  for (int i = 1; i < p; i++)  // (0,1)
+  {
+    Nodes.IntPoint(o++).Set2(cp[i], cp[0]);
   }
-  else
+  for (int i = 1; i < p; i++)  // (1,2)
+  {
+    Nodes.IntPoint(o++).Set2(cp[p], cp[i]);
+  }
+  for (int i = 1; i < p; i++)  // (2,3)
+  {
+    Nodes.IntPoint(o++).Set2(cp[p-i], cp[p]);
+  }
+  for (int i = 1; i < p; i++)  // (3,0)
+  {
+    Nodes.IntPoint(o++).Set2(cp[0], cp[p-i]);
+  }
+
+  // interior: the bubbles of S_p are x(1-x)y(1-y) P_{p-4}, so any set that
+  // is unisolvent for P_{p-4} works; a triangular lattice of the interior
+  // nodes of order p-2 is
+  if (p >= 4)
+  {
+    const double *ci = LG_GetBasis1D(p - 2, BasisType::GaussLobatto).GetNodes();
+    for (int j = 0; j <= p - 4; j++)
+      for (int i = 0; i + j <= p - 4; i++)
+        Nodes.IntPoint(o++).Set2(ci[i+1], ci[j+1]);
+  }
+
+  lg_basis = &LG_GetSerendipityBasis(p, Nodes);
+}
+
+void LG_SerendipityQuadElement::CalcShape(
+    const IntegrationPoint &ip,
+    Vector &shape) const
+{
+  lg_basis->Eval(ip.x, ip.y, shape.GetData());
+}
+
+void LG_SerendipityQuadElement::CalcDShape(
+    const IntegrationPoint &ip,
+    DenseMatrix &dshape) const
+{
+  double shape[LG_MAX_DOF];
+
+  lg_basis->Eval(ip.x, ip.y, shape, dshape.GetColumn(0), dshape.GetColumn(1));
+}
+
+void LG_SerendipityQuadElement::CalcShapeTable(
+    const IntegrationRule &ir,
+    LG_ShapeTable &table) const
+{
+  const int nq = ir.GetNPoints();
+  table.SetSize(nq, dof, 2);
+  lg_basis->Eval(ir, table.GetShapeData(), table.GetDShapeData(),
+                 table.GetWork(3*dof*nq));
+}
+
+void LG_CalcShapeTable(
+    const FiniteElement &fe,
+    const IntegrationRule &ir,
+    LG_ShapeTable &table)
+{
+  const LG_BatchedElement *lg_fe = dynamic_cast<const LG_BatchedElement*>(&fe);
+  if (lg_fe)
+  {
+    lg_fe->CalcShapeTable(ir, table);
+    return;
+  }
+
+  const int nd = fe.GetDof(), dim = fe.GetDim();
+  table.SetSize(ir.GetNPoints(), nd, dim);
+  for (int q = 0; q < ir.GetNPoints(); q++)
   {
-    MFEM_VERIFY(0, "unimplemented order");
+    Vector shape(table.GetShape(q), nd);
+    DenseMatrix dshape(table.GetDShape(q), nd, dim);
+    fe.CalcShape(ir.IntPoint(q), shape);
+    fe.CalcDShape(ir.IntPoint(q), dshape);
   }
 }
 
@@ -410,17 +2545,32 @@ void LG_TriangleElement::CalcDShape(
 LG_FECollection::LG_FECollection(const int p, const int dim, const int btype)
 {
   MFEM_VERIFY(p >= 1, "LG_FECollection requires order >= 1.");
-  MFEM_VERIFY(p <  3, "LG_FECollection requires order <  3.");
-  MFEM_VERIFY(dim == 2, "LG_FECollection requires dim == 2");
+  MFEM_VERIFY(p <= LG_MAX_ORDER, "LG_FECollection requires order <= "
+      << LG_MAX_ORDER << ".");
+  MFEM_VERIFY(dim >= 0 && dim <= 3, "LG_FECollection requires 0 <= dim <= 3");
+
+  shape_table_hits = shape_table_misses = 0;
+  for (int g = 0; g < Geometry::NumGeom; g++)
+  {
+    shape_tables[g] = NULL;
+  }
 
-  const int pm1 = p - 1, pm2 = pm1 - 1, pm3 = pm2 - 1, pm4 = pm3 - 1;
+  const int pm1 = p - 1, pm2 = pm1 - 1, pm3 = pm2 - 1;
 
-  int pt_type = BasisType::GetQuadrature1D(btype);
   b_type = BasisType::Check(btype);
-  MFEM_VERIFY(btype == BasisType::GaussLobatto,
-      "LG_FECollection requires btype == BasisType::GaussLobatto");
+  MFEM_VERIFY(btype == BasisType::GaussLobatto ||
+      btype == BasisType::Serendipity, "LG_FECollection requires btype == "
+      "BasisType::GaussLobatto or BasisType::Serendipity");
+  MFEM_VERIFY(btype != BasisType::Serendipity || dim <= 2,
+      "serendipity LG_FECollection requires dim <= 2");
+  // the nodes of all the elements (and of the serendipity edges) are the
+  // Gauss-Lobatto points
+  const int el_btype = BasisType::GaussLobatto;
 
-  snprintf(lg_name, 32, "LG_%dD_P%d", dim, p);
+  if (b_type == BasisType::Serendipity)
+    snprintf(lg_name, 32, "LG_Ser_%dD_P%d", dim, p);
+  else
+    snprintf(lg_name, 32, "LG_%dD_P%d", dim, p);
 
   for (int g = 0; g < Geometry::NumGeom; g++)
   {
@@ -450,7 +2600,8 @@ LG_FECollection::LG_FECollection(const int p, const int dim, const int btype)
   if (dim >= 1)
   {
     LG_dof[Geometry::SEGMENT] = pm1;
-    LG_Elements[Geometry::SEGMENT] = new LG_SegmentElement(p, btype);
+    LG_Elements[Geometry::SEGMENT] = 
+      LG_NewElement<LG_SegmentElementP, LG_SegmentElement>(p, el_btype);
 
     SegDofOrd[0] = new int[2*pm1];
     SegDofOrd[1] = SegDofOrd[0] + pm1;
@@ -464,9 +2615,20 @@ LG_FECollection::LG_FECollection(const int p, const int dim, const int btype)
   if (dim >= 2)
   {
     LG_dof[Geometry::TRIANGLE] = (pm1*pm2)/2;
-    LG_dof[Geometry::SQUARE] = pm1*pm1;
-    LG_Elements[Geometry::TRIANGLE] = new LG_TriangleElement(p, btype);
-    LG_Elements[Geometry::SQUARE] = new LG_QuadrilateralElement(p, btype);
+    LG_Elements[Geometry::TRIANGLE] = 
+      LG_NewElement<LG_TriangleElementP, LG_TriangleElement>(p, el_btype);
+    if (b_type == BasisType::Serendipity)
+    {
+      LG_dof[Geometry::SQUARE] = LG_SerendipityDof(p) - 4*p;
+      LG_Elements[Geometry::SQUARE] = new LG_SerendipityQuadElement(p);
+    }
+    else
+    {
+      LG_dof[Geometry::SQUARE] = pm1*pm1;
+      LG_Elements[Geometry::SQUARE] = 
+        LG_NewElement<LG_QuadrilateralElementP, LG_QuadrilateralElement>(
+          p, el_btype);
+    }
 
     const int &TriDof = LG_dof[Geometry::TRIANGLE];
     TriDofOrd[0] = new int[6*TriDof];
@@ -499,7 +2661,12 @@ LG_FECollection::LG_FECollection(const int p, const int dim, const int btype)
 
     if (b_type == BasisType::Serendipity)
     {
-      MFEM_VERIFY(0, "unimplemented quad type");
+      // the interior lattice is only symmetric about the diagonal, so it has
+      // no orientation tables; serendipity collections are 2D only, where
+      // the interior dofs of a quad are never shared
+      for (int k = 0; k < 8; k++)
+        for (int o = 0; o < QuadDof; o++)
+          QuadDofOrd[k][o] = o;
     }
     else // not serendipity
     {
@@ -520,6 +2687,53 @@ LG_FECollection::LG_FECollection(const int p, const int dim, const int btype)
       }
     }
   }
+
+  if (dim >= 3)
+  {
+    LG_dof[Geometry::TETRAHEDRON] = (pm1*pm2*pm3)/6;
+    LG_dof[Geometry::CUBE] = pm1*pm1*pm1;
+    LG_Elements[Geometry::TETRAHEDRON] = 
+      LG_NewElement<LG_TetrahedronElementP, LG_TetrahedronElement>(p,
+          el_btype);
+    LG_Elements[Geometry::CUBE] = 
+      LG_NewElement<LG_HexahedronElementP, LG_HexahedronElement>(p, el_btype);
+
+    const int &TetDof = LG_dof[Geometry::TETRAHEDRON];
+    TetDofOrd[0] = new int[24*TetDof];
+    for (int i = 1; i < 24; i++)
+    {
+      TetDofOrd[i] = TetDofOrd[i-1] + TetDof;
+    }
+    // vertex permutations in the order of Mesh::GetTetOrientation
+    static const int TetOrient[24][4] =
+    {
+      {0,1,2,3}, {0,1,3,2}, {0,2,3,1}, {0,2,1,3}, {0,3,1,2}, {0,3,2,1},
+      {1,2,0,3}, {1,2,3,0}, {1,3,2,0}, {1,3,0,2}, {1,0,3,2}, {1,0,2,3},
+      {2,3,0,1}, {2,3,1,0}, {2,0,1,3}, {2,0,3,1}, {2,1,3,0}, {2,1,0,3},
+      {3,0,2,1}, {3,0,1,2}, {3,1,0,2}, {3,1,2,0}, {3,2,1,0}, {3,2,0,1}
+    };
+    // interior dof (i,j,k) is the node with barycentric indices
+    // b = (pm4-i-j-k, i, j, k); under the permutation pi it becomes the
+    // node with indices b[pi[0]], ..., b[pi[3]] (as TriDofOrd above)
+    const int pm4 = pm3 - 1;
+    Array<int> tet_index(TetDof > 0 ? pm3*pm3*pm3 : 0);
+    for (int o = 0, k = 0; k < pm3; k++)
+      for (int j = 0; j + k < pm3; j++)
+        for (int i = 0; i + j + k < pm3; i++)
+          tet_index[i + (j + k*pm3)*pm3] = o++;
+    for (int o = 0, k = 0; k < pm3; k++)
+      for (int j = 0; j + k < pm3; j++)
+        for (int i = 0; i + j + k < pm3; i++, o++)
+        {
+          const int b[4] = { pm4 - i - j - k, i, j, k };
+          for (int r = 0; r < 24; r++)
+          {
+            const int *pi = TetOrient[r];
+            TetDofOrd[r][o] =
+              tet_index[b[pi[1]] + (b[pi[2]] + b[pi[3]]*pm3)*pm3];
+          }
+        }
+  }
 }
 
 const int *LG_FECollection::DofOrderForOrientation(
@@ -538,27 +2752,27 @@ const int *LG_FECollection::DofOrderForOrientation(
   {
     return QuadDofOrd[Or%8];
   }
+  else if (GeomType == Geometry::TETRAHEDRON)
+  {
+    return TetDofOrd[Or%24];
+  }
   return NULL;
 }
 
 FiniteElementCollection *LG_FECollection::GetTraceCollection() const
 {
-  return NULL;
-  /* int p = LG_dof[Geometry::SEGMENT] + 1; */
-  /* int dim = -1; */
-  /* if (!strncmp(lg_name, "LG_", 3)) */
-  /* { */
-  /*    dim = atoi(lg_name + 3); */
-  /* } */
-  /* /1* else if (!strncmp(h1_name, "H1Pos_", 6)) *1/ */
-  /* /1* { *1/ */
-  /* /1*    dim = atoi(h1_name + 6); *1/ */
-  /* /1* } *1/ */
-  /* /1* else if (!strncmp(h1_name, "H1@", 3)) *1/ */
-  /* /1* { *1/ */
-  /* /1*    dim = atoi(h1_name + 5); *1/ */
-  /* /1* } *1/ */
-  /* return (dim < 0) ? NULL : new LG_Trace_FECollection(p, dim, b_type); */
+  int p = LG_dof[Geometry::SEGMENT] + 1;
+  int dim = -1;
+  if (!strncmp(lg_name, "LG_Ser_", 7))
+  {
+    dim = atoi(lg_name + 7);
+  }
+  else if (!strncmp(lg_name, "LG_", 3))
+  {
+    // "LG_Trace_..." names give 0 here, traces have no trace collection
+    dim = atoi(lg_name + 3);
+  }
+  return (dim < 1) ? NULL : new LG_Trace_FECollection(p, dim, b_type);
 }
 
 const int *LG_FECollection::GetDofMap(Geometry::Type GeomType) const
@@ -570,6 +2784,13 @@ const int *LG_FECollection::GetDofMap(Geometry::Type GeomType) const
      case Geometry::SEGMENT:
      case Geometry::SQUARE:
      case Geometry::CUBE:
+        // the lexicographic to native map the tensor LG elements are built
+        // with, i.e. what ElementRestriction and the PA kernels expect
+        MFEM_VERIFY(fe, "no element for geometry " << Geometry::Name[GeomType]);
+        MFEM_VERIFY(dynamic_cast<const TensorBasisElement*>(fe),
+            "serendipity quads have no tensor dof map");
+        dof_map = dynamic_cast<const TensorBasisElement*>(fe)->GetDofMap().GetData();
+        break;
      default:
         MFEM_ABORT("Geometry type " << Geometry::Name[GeomType] << " is not "
                    "implemented");
@@ -579,8 +2800,74 @@ const int *LG_FECollection::GetDofMap(Geometry::Type GeomType) const
   return dof_map;
 }
 
+const LG_ShapeTable &LG_FECollection::GetShapeTable(
+    Geometry::Type GeomType,
+    const IntegrationRule &ir) const
+{
+  const FiniteElement *fe = LG_Elements[GeomType];
+  MFEM_VERIFY(fe, "no element for geometry " << Geometry::Name[GeomType]);
+
+  std::atomic<ShapeTableEntry*> &head = shape_tables[GeomType];
+  const LG_ShapeTable *table =
+    FindShapeTable(head.load(std::memory_order_acquire), ir);
+  if (table)
+  {
+    shape_table_hits.fetch_add(1, std::memory_order_relaxed);
+    return *table;
+  }
+
+  // miss: another thread may have published the table since the lookup
+  std::lock_guard<std::mutex> lock(shape_tables_mutex);
+  ShapeTableEntry *first = head.load(std::memory_order_relaxed);
+  table = FindShapeTable(first, ir);
+  if (table)
+  {
+    shape_table_hits.fetch_add(1, std::memory_order_relaxed);
+    return *table;
+  }
+  shape_table_misses.fetch_add(1, std::memory_order_relaxed);
+  ShapeTableEntry *entry = new ShapeTableEntry;
+  entry->ir = &ir;
+  entry->next = first;
+  LG_CalcShapeTable(*fe, ir, entry->table);
+  head.store(entry, std::memory_order_release);
+  return entry->table;
+}
+
+const LG_ShapeTable *LG_FECollection::FindShapeTable(
+    const ShapeTableEntry *entry,
+    const IntegrationRule &ir)
+{
+  for ( ; entry; entry = entry->next)
+  {
+    if (entry->ir == &ir)
+      return &entry->table;
+  }
+  return NULL;
+}
+
+long LG_FECollection::GetShapeTableHits() const
+{
+  return shape_table_hits.load(std::memory_order_relaxed);
+}
+
+long LG_FECollection::GetShapeTableMisses() const
+{
+  return shape_table_misses.load(std::memory_order_relaxed);
+}
+
 LG_FECollection::~LG_FECollection()
 {
+   for (int g = 0; g < Geometry::NumGeom; g++)
+   {
+      ShapeTableEntry *entry = shape_tables[g].load();
+      while (entry)
+      {
+         ShapeTableEntry *next = entry->next;
+         delete entry;
+         entry = next;
+      }
+   }
    delete [] SegDofOrd[0];
    delete [] TriDofOrd[0];
    delete [] QuadDofOrd[0];
@@ -591,4 +2878,14 @@ LG_FECollection::~LG_FECollection()
    }
 }
 
+// LG_Trace_FECollection implementation
+LG_Trace_FECollection::LG_Trace_FECollection(
+    const int p,
+    const int dim,
+    const int btype)
+   : LG_FECollection(p, dim-1, btype)
+{
+  snprintf(lg_name, 32, "LG_Trace_%dD_P%d", dim, p);
+}
+
 #endif
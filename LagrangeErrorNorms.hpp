@@ -0,0 +1,223 @@
+#ifndef LAGRANGE_ERROR_NORMS
+#define LAGRANGE_ERROR_NORMS
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeIntegrators.hpp"
+#include "LagrangeAssembly.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Sum of v[0], ..., v[n-1] by recursive halving, with an error growing as
+/// log(n) instead of n. The order of the additions only depends on n.
+double LG_PairwiseSum(const double *v, const int n);
+
+/// L2, H1 seminorm and max norm errors of a GridFunction against an exact
+/// solution, computed with element quadrature (order 2p + order_increase)
+/// through the shape tables of the space.
+///
+/// The elements are split among nthreads threads, each with its own
+/// transformation and shape tables. Every element writes its errors into
+/// its own entry of the element error vectors, and the totals are pairwise
+/// sums of these in element order: the results are the same bit for bit on
+/// any number of threads. The max norm is taken over the quadrature points.
+/// The exact coefficients are evaluated concurrently, so they must not keep
+/// state between Eval calls (function coefficients are fine). On curved
+/// meshes (mesh->GetNodes() set) the element transformations read the
+/// shared nodal GridFunction and are not thread safe, so the elements are
+/// processed on one thread there.
+class LG_ErrorNorms
+{
+protected:
+  const GridFunction &u;
+  int nthreads, order_increase;
+  Vector elem_l2, elem_h1, elem_max;
+  double l2, h1, max_err;
+
+  typedef std::function<void(ElementTransformation &, const IntegrationPoint &,
+                             Vector &)> ValueFunc;
+  typedef std::function<void(ElementTransformation &, const IntegrationPoint &,
+                             DenseMatrix &)> GradFunc;
+  // value(T, ip, E) with E of size vdim, grad(T, ip, G) with G vdim x sdim
+  void ComputeErrors(const ValueFunc &value, const GradFunc *grad);
+
+public:
+  LG_ErrorNorms(
+      const GridFunction &u,
+      const int nthreads = 1,
+      const int order_increase = 2);
+
+  /// Scalar u against exact and, when given, its gradient
+  void Compute(Coefficient &exact, VectorCoefficient *exact_grad = NULL);
+  /// Vector u against exact and, when given, its gradient (vdim x sdim)
+  void Compute(VectorCoefficient &exact, MatrixCoefficient *exact_grad = NULL);
+
+  double GetL2Error() const
+  { return l2; }
+  /// Zero when no gradient was given
+  double GetH1SemiError() const
+  { return h1; }
+  double GetMaxError() const
+  { return max_err; }
+
+  /// Errors per element, e.g. to be written as an L2 (order 0) field
+  const Vector &GetElementL2Errors() const
+  { return elem_l2; }
+  const Vector &GetElementH1SemiErrors() const
+  { return elem_h1; }
+  const Vector &GetElementMaxErrors() const
+  { return elem_max; }
+};
+
+
+double LG_PairwiseSum(const double *v, const int n)
+{
+  if (n <= 8)
+  {
+    double s = 0.0;
+    for (int i = 0; i < n; i++)
+      s += v[i];
+    return s;
+  }
+  const int h = n/2;
+  return LG_PairwiseSum(v, h) + LG_PairwiseSum(v + h, n - h);
+}
+
+
+// LG_ErrorNorms implementation
+LG_ErrorNorms::LG_ErrorNorms(
+    const GridFunction &u_,
+    const int nthreads_,
+    const int order_increase_)
+   : u(u_), nthreads(nthreads_), order_increase(order_increase_),
+     l2(0.0), h1(0.0), max_err(0.0)
+{
+  MFEM_VERIFY(nthreads >= 1, "at least one thread is needed");
+}
+
+void LG_ErrorNorms::Compute(Coefficient &exact, VectorCoefficient *exact_grad)
+{
+  MFEM_VERIFY(u.FESpace()->GetVDim() == 1, "scalar GridFunction expected");
+  ValueFunc value = [&exact](ElementTransformation &T,
+                             const IntegrationPoint &ip, Vector &E)
+  { E(0) = exact.Eval(T, ip); };
+  GradFunc grad = [exact_grad](ElementTransformation &T,
+                               const IntegrationPoint &ip, DenseMatrix &G)
+  {
+    Vector g(G.Data(), G.Width());
+    exact_grad->Eval(g, T, ip);
+  };
+  ComputeErrors(value, exact_grad ? &grad : NULL);
+}
+
+void LG_ErrorNorms::Compute(VectorCoefficient &exact,
+                            MatrixCoefficient *exact_grad)
+{
+  ValueFunc value = [&exact](ElementTransformation &T,
+                             const IntegrationPoint &ip, Vector &E)
+  { exact.Eval(E, T, ip); };
+  GradFunc grad = [exact_grad](ElementTransformation &T,
+                               const IntegrationPoint &ip, DenseMatrix &G)
+  { exact_grad->Eval(G, T, ip); };
+  ComputeErrors(value, exact_grad ? &grad : NULL);
+}
+
+void LG_ErrorNorms::ComputeErrors(
+    const ValueFunc &value,
+    const GradFunc *grad)
+{
+  const FiniteElementSpace *fes = u.FESpace();
+  const LG_FECollection *fec =
+    dynamic_cast<const LG_FECollection *>(fes->FEColl());
+  Mesh *mesh = fes->GetMesh();
+  const int ne = mesh->GetNE();
+  const int vdim = fes->GetVDim();
+  const int sdim = mesh->SpaceDimension();
+
+  // IntRules.Get fills its tables on first use, so the rules are fetched
+  // before the threads start
+  std::vector<const IntegrationRule *> irs(Geometry::NumGeom, NULL);
+  for (int e = 0; e < ne; e++)
+  {
+    const FiniteElement *fe = fes->GetFE(e);
+    const int geom = fe->GetGeomType();
+    if (!irs[geom])
+      irs[geom] = &IntRules.Get(geom, 2*fe->GetOrder() + order_increase);
+  }
+
+  elem_l2.SetSize(ne);
+  elem_h1.SetSize(ne);
+  elem_max.SetSize(ne);
+  const int nt = mesh->GetNodes() ? 1 : nthreads;
+  LG_ParallelFor(nt, ne, [&](int tid, int begin, int end)
+  {
+    IsoparametricTransformation T;
+    LG_ShapeTableMemo shape_memo;
+    Array<int> vdofs;
+    Vector loc, uh(vdim), E(vdim);
+    DenseMatrix grad_ref, grad_h(vdim, sdim), G(vdim, sdim);
+    for (int e = begin; e < end; e++)
+    {
+      const FiniteElement *fe = fes->GetFE(e);
+      const int nd = fe->GetDof();
+      const int dim = fe->GetDim();
+      const IntegrationRule &ir = *irs[fe->GetGeomType()];
+      const LG_ShapeTable &shapes = shape_memo.Get(fec, *fe, ir);
+      mesh->GetElementTransformation(e, &T);
+      fes->GetElementVDofs(e, vdofs);
+      u.GetSubVector(vdofs, loc);
+      // the vdofs of a component are contiguous
+      const DenseMatrix loc_mat(loc.GetData(), nd, vdim);
+      grad_ref.SetSize(vdim, dim);
+
+      double e_l2 = 0.0, e_h1 = 0.0, e_max = 0.0;
+      for (int q = 0; q < ir.GetNPoints(); q++)
+      {
+        const IntegrationPoint &ip = ir.IntPoint(q);
+        T.SetIntPoint(&ip);
+        const double w = ip.weight * T.Weight();
+
+        const Vector shape(shapes.GetShape(q), nd);
+        loc_mat.MultTranspose(shape, uh);
+        value(T, ip, E);
+        for (int c = 0; c < vdim; c++)
+        {
+          const double d = uh(c) - E(c);
+          e_l2 += w*d*d;
+          e_max = max(e_max, fabs(d));
+        }
+
+        if (grad)
+        {
+          // grad u_h = (loc^T dshape) J^{-1}
+          const DenseMatrix dshape(shapes.GetDShape(q), nd, dim);
+          MultAtB(loc_mat, dshape, grad_ref);
+          Mult(grad_ref, T.InverseJacobian(), grad_h);
+          (*grad)(T, ip, G);
+          grad_h -= G;
+          e_h1 += w*grad_h.FNorm2();
+        }
+      }
+      elem_l2(e) = e_l2;
+      elem_h1(e) = e_h1;
+      elem_max(e) = e_max;
+    }
+  });
+
+  // element order sums of the squares, then the element norms
+  l2 = sqrt(LG_PairwiseSum(elem_l2.GetData(), ne));
+  h1 = sqrt(LG_PairwiseSum(elem_h1.GetData(), ne));
+  max_err = (ne > 0) ? elem_max.Max() : 0.0;
+  for (int e = 0; e < ne; e++)
+  {
+    elem_l2(e) = sqrt(elem_l2(e));
+    elem_h1(e) = sqrt(elem_h1(e));
+  }
+}
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef LAGRANGE_INTEGRATORS
+#define LAGRANGE_INTEGRATORS
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Get the shape table of el at ir: from the cache of fec when el is one of
+/// its elements, otherwise computed into table
+const LG_ShapeTable &LG_GetShapeTable(
+    const LG_FECollection *fec,
+    const FiniteElement &el,
+    const IntegrationRule &ir,
+    LG_ShapeTable &table);
+
+/// The table LG_GetShapeTable returned for the last (element, rule) pair.
+/// Integrators keep one so that the (locked) cache of the collection is
+/// only searched when the element or the rule changes, i.e. once per
+/// geometry instead of once per element. Not to be shared between threads.
+class LG_ShapeTableMemo
+{
+protected:
+  const FiniteElement *el;
+  const IntegrationRule *ir;
+  const LG_ShapeTable *shapes;
+  LG_ShapeTable table;
+
+public:
+  LG_ShapeTableMemo()
+    : el(NULL), ir(NULL), shapes(NULL) { }
+
+  const LG_ShapeTable &Get(
+      const LG_FECollection *fec,
+      const FiniteElement &el,
+      const IntegrationRule &ir);
+};
+
+/// Diffusion integrator (Q grad u, grad v) that reads the reference shape
+/// gradients of all quadrature points from one batched LG_ShapeTable
+/// instead of calling CalcDShape point by point. When constructed with the
+/// LG_FECollection of the space, the tables come from its cache and are
+/// computed once per (geometry, rule) instead of once per element.
+class LG_DiffusionIntegrator : public BilinearFormIntegrator
+{
+protected:
+  Coefficient *Q;
+  const LG_FECollection *fec;
+#ifndef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+  DenseMatrix dshapedxt;
+#endif
+
+public:
+  LG_DiffusionIntegrator(const LG_FECollection *fec_ = NULL)
+    : Q(NULL), fec(fec_) { }
+  LG_DiffusionIntegrator(Coefficient &q, const LG_FECollection *fec_ = NULL)
+    : Q(&q), fec(fec_) { }
+
+  /// Quadrature rule used when no rule was set with SetIntRule
+  static const IntegrationRule &GetRule(
+      const FiniteElement &el,
+      ElementTransformation &Trans);
+
+  virtual void AssembleElementMatrix(
+      const FiniteElement &el,
+      ElementTransformation &Trans,
+      DenseMatrix &elmat);
+
+  /// Q grad u at the nodes of fluxelem, stored by components (flux(i +
+  /// j*nodes) is component j at node i) as DiffusionIntegrator does, so
+  /// that the ZienkiewiczZhuEstimator can average and compare the fluxes
+  virtual void ComputeElementFlux(
+      const FiniteElement &el,
+      ElementTransformation &Trans,
+      Vector &u,
+      const FiniteElement &fluxelem,
+      Vector &flux,
+      bool with_coef = true);
+
+  /// Energy of the flux stored by ComputeElementFlux over the element, and
+  /// optionally its components in reference directions
+  virtual double ComputeFluxEnergy(
+      const FiniteElement &fluxelem,
+      ElementTransformation &Trans,
+      Vector &flux,
+      Vector *d_energy = NULL);
+};
+
+/// Domain integrator (f, v) using a batched (and optionally cached)
+/// LG_ShapeTable
+class LG_DomainLFIntegrator : public LinearFormIntegrator
+{
+protected:
+  Coefficient &Q;
+  const LG_FECollection *fec;
+#ifndef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+#endif
+
+public:
+  LG_DomainLFIntegrator(Coefficient &q, const LG_FECollection *fec_ = NULL)
+    : Q(q), fec(fec_) { }
+
+  static const IntegrationRule &GetRule(
+      const FiniteElement &el,
+      ElementTransformation &Trans);
+
+  virtual void AssembleRHSElementVect(
+      const FiniteElement &el,
+      ElementTransformation &Trans,
+      Vector &elvect);
+};
+
+
+const LG_ShapeTable &LG_GetShapeTable(
+    const LG_FECollection *fec,
+    const FiniteElement &el,
+    const IntegrationRule &ir,
+    LG_ShapeTable &table)
+{
+  if (fec && fec->FiniteElementForGeometry(el.GetGeomType()) == &el)
+  {
+    return fec->GetShapeTable(el.GetGeomType(), ir);
+  }
+  LG_CalcShapeTable(el, ir, table);
+  return table;
+}
+
+const LG_ShapeTable &LG_ShapeTableMemo::Get(
+    const LG_FECollection *fec,
+    const FiniteElement &el_,
+    const IntegrationRule &ir_)
+{
+  if (&el_ != el || &ir_ != ir)
+  {
+    shapes = &LG_GetShapeTable(fec, el_, ir_, table);
+    el = &el_;
+    ir = &ir_;
+  }
+  return *shapes;
+}
+
+
+// LG_DiffusionIntegrator implementation
+const IntegrationRule &LG_DiffusionIntegrator::GetRule(
+    const FiniteElement &el,
+    ElementTransformation &Trans)
+{
+  // same order as DiffusionIntegrator for affine elements
+  const int p = el.GetOrder();
+  const int order = (el.Space() == FunctionSpace::Pk) ?
+                    2*p - 2 : 2*p + el.GetDim() - 1;
+  return IntRules.Get(el.GetGeomType(), order);
+}
+
+void LG_DiffusionIntegrator::AssembleElementMatrix(
+    const FiniteElement &el,
+    ElementTransformation &Trans,
+    DenseMatrix &elmat)
+{
+  const int nd = el.GetDof();
+  const int dim = el.GetDim();
+  const int sdim = Trans.GetSpaceDim();
+#ifdef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+  DenseMatrix dshapedxt;
+#endif
+  const IntegrationRule *ir = IntRule ? IntRule : &GetRule(el, Trans);
+
+  const LG_ShapeTable &shapes = shape_memo.Get(fec, el, *ir);
+
+  dshapedxt.SetSize(nd, sdim);
+  elmat.SetSize(nd);
+  elmat = 0.0;
+  for (int q = 0; q < ir->GetNPoints(); q++)
+  {
+    const IntegrationPoint &ip = ir->IntPoint(q);
+    Trans.SetIntPoint(&ip);
+    double w = ip.weight / Trans.Weight();
+    if (Q)
+    {
+      w *= Q->Eval(Trans, ip);
+    }
+
+    const DenseMatrix dshape(shapes.GetDShape(q), nd, dim);
+    Mult(dshape, Trans.AdjugateJacobian(), dshapedxt);
+    AddMult_a_AAt(w, dshapedxt, elmat);
+  }
+}
+
+void LG_DiffusionIntegrator::ComputeElementFlux(
+    const FiniteElement &el,
+    ElementTransformation &Trans,
+    Vector &u,
+    const FiniteElement &fluxelem,
+    Vector &flux,
+    bool with_coef)
+{
+  const int nd = el.GetDof();
+  const int dim = el.GetDim();
+  const int sdim = Trans.GetSpaceDim();
+#ifdef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+#endif
+  const IntegrationRule &ir = fluxelem.GetNodes();
+  const int fnd = ir.GetNPoints();
+
+  const LG_ShapeTable &shapes = shape_memo.Get(fec, el, ir);
+
+  Vector vec(dim), pointflux(sdim);
+  flux.SetSize(fnd * sdim);
+  for (int i = 0; i < fnd; i++)
+  {
+    const IntegrationPoint &ip = ir.IntPoint(i);
+    Trans.SetIntPoint(&ip);
+
+    // reference gradient, then grad u = J^{-T} vec
+    const DenseMatrix dshape(shapes.GetDShape(i), nd, dim);
+    dshape.MultTranspose(u, vec);
+    Trans.InverseJacobian().MultTranspose(vec, pointflux);
+    if (Q && with_coef)
+    {
+      pointflux *= Q->Eval(Trans, ip);
+    }
+    for (int j = 0; j < sdim; j++)
+    {
+      flux(i + j*fnd) = pointflux(j);
+    }
+  }
+}
+
+double LG_DiffusionIntegrator::ComputeFluxEnergy(
+    const FiniteElement &fluxelem,
+    ElementTransformation &Trans,
+    Vector &flux,
+    Vector *d_energy)
+{
+  const int nd = fluxelem.GetDof();
+  const int dim = fluxelem.GetDim();
+  const int sdim = Trans.GetSpaceDim();
+#ifdef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+#endif
+  const IntegrationRule &ir =
+      IntRules.Get(fluxelem.GetGeomType(), 2*fluxelem.GetOrder());
+
+  const LG_ShapeTable &shapes = shape_memo.Get(fec, fluxelem, ir);
+
+  const DenseMatrix flux_mat(flux.GetData(), nd, sdim);
+  Vector pointflux(sdim), vec(dim);
+  double energy = 0.0;
+  if (d_energy)
+  {
+    d_energy->SetSize(dim);
+    *d_energy = 0.0;
+  }
+  for (int q = 0; q < ir.GetNPoints(); q++)
+  {
+    const IntegrationPoint &ip = ir.IntPoint(q);
+    Trans.SetIntPoint(&ip);
+    const double w = ip.weight * Trans.Weight();
+
+    const Vector shape(shapes.GetShape(q), nd);
+    flux_mat.MultTranspose(shape, pointflux);
+    double e = pointflux * pointflux;
+    if (Q)
+    {
+      e *= Q->Eval(Trans, ip);
+    }
+    energy += w * e;
+
+    if (d_energy)
+    {
+      // the flux in reference directions
+      Trans.Jacobian().MultTranspose(pointflux, vec);
+      for (int k = 0; k < dim; k++)
+      {
+        (*d_energy)(k) += w * vec(k) * vec(k);
+      }
+    }
+  }
+  return energy;
+}
+
+
+// LG_DomainLFIntegrator implementation
+const IntegrationRule &LG_DomainLFIntegrator::GetRule(
+    const FiniteElement &el,
+    ElementTransformation &Trans)
+{
+  return IntRules.Get(el.GetGeomType(), 2*el.GetOrder());
+}
+
+void LG_DomainLFIntegrator::AssembleRHSElementVect(
+    const FiniteElement &el,
+    ElementTransformation &Trans,
+    Vector &elvect)
+{
+  const int nd = el.GetDof();
+#ifdef MFEM_THREAD_SAFE
+  LG_ShapeTableMemo shape_memo;
+#endif
+  const IntegrationRule *ir = IntRule ? IntRule : &GetRule(el, Trans);
+
+  const LG_ShapeTable &shapes = shape_memo.Get(fec, el, *ir);
+
+  elvect.SetSize(nd);
+  elvect = 0.0;
+  for (int q = 0; q < ir->GetNPoints(); q++)
+  {
+    const IntegrationPoint &ip = ir->IntPoint(q);
+    Trans.SetIntPoint(&ip);
+    const double val = ip.weight * Trans.Weight() * Q.Eval(Trans, ip);
+
+    const double *shape = shapes.GetShape(q);
+    for (int i = 0; i < nd; i++)
+    {
+      elvect(i) += val * shape[i];
+    }
+  }
+}
+
+#endif
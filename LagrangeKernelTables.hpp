@@ -0,0 +1,439 @@
+#ifndef LAGRANGE_KERNEL_TABLES
+#define LAGRANGE_KERNEL_TABLES
+
+/// Monomial coefficients of the nodal LG triangle and tetrahedron bases of
+/// orders 3 and 4, on the Gauss-Lobatto nodes laid out as in the
+/// LG_TriangleElement and LG_TetrahedronElement constructors. Row m of the
+/// D x D table C holds shape m = sum_o C[m*D + o] mono_o, where the
+/// monomials are x^i y^j in the loop order (j, i) of LG_TriKernel and
+/// x^i y^j z^k in the loop order (k, j, i) of LG_TetKernel. The entries
+/// come from inverting the monomial Vandermonde matrix of the nodes in 50
+/// digit arithmetic, rounded to double.
+template <int P> struct LG_TriTable;
+template <int P> struct LG_TetTable;
+
+template <> struct LG_TriTable<3>
+{
+  static constexpr double C[100] = {
+    // shape 0
+    1., -6., 10., -5., -6., 21., -16., 10., -16., -5.,
+    // shape 1
+    0., 1., -5., 5., 0., 1., -1., 0., -1., 0.,
+    // shape 2
+    0., 0., 0., 0., 1., 1., -1., -5., -1., 5.,
+    // shape 3
+    0., 8.0901699437494745, -19.270509831248422, 11.180339887498949, 0.,
+    -21.180339887498949, 24.270509831248422, 0., 13.090169943749475, 0.,
+    // shape 4
+    0., -3.0901699437494741, 14.270509831248424, -11.180339887498949, 0.,
+    1.1803398874989486, -9.2705098312484235, 0., 1.9098300562505257, 0.,
+    // shape 5
+    0., 0., 0., 0., 0., -5., 13.090169943749475, 0., 1.9098300562505257, 0.,
+    // shape 6
+    0., 0., 0., 0., 0., -5., 1.9098300562505257, 0., 13.090169943749475, 0.,
+    // shape 7
+    0., 0., 0., 0., -3.0901699437494741, 1.1803398874989486,
+    1.9098300562505257, 14.270509831248424, -9.2705098312484235,
+    -11.180339887498949,
+    // shape 8
+    0., 0., 0., 0., 8.0901699437494745, -21.180339887498949,
+    13.090169943749475, -19.270509831248422, 24.270509831248422,
+    11.180339887498949,
+    // shape 9
+    0., 0., 0., 0., 0., 27., -27., 0., -27., 0.
+  };
+};
+
+template <> struct LG_TriTable<4>
+{
+  static constexpr double C[225] = {
+    // shape 0
+    1., -10., 30., -35., 14., -10., 66.942028661817531, -121.51371416612076,
+    65.571685504303247, 30., -121.51371416612076, 103.14337100860648, -35.,
+    65.571685504303247, 14.,
+    // shape 1
+    0., -1., 9., -21., 14., 0., -2.629656842485713, 12.201342346788953,
+    -9.5716855043032396, 0., 2.629656842485713, -9.5716855043032396, 0., 0.,
+    0.,
+    // shape 2
+    0., 0., 0., 0., 0., -1., -2.629656842485713, 2.629656842485713, 0., 9.,
+    12.201342346788953, -9.5716855043032396, -21., -9.5716855043032396, 14.,
+    // shape 3
+    0., 13.51300497744848, -56.872348265678774, 76.026009954896963,
+    -32.666666666666664, 0., -70.523101859239361, 185.38364416755144,
+    -117.68087066419693, 0., 106.83162425775753, -134.83573137349691, 0.,
+    -49.821527375966639, 0.,
+    // shape 4
+    0., -5.333333333333333, 42.666666666666664, -74.666666666666671,
+    37.333333333333336, 0., 8.1194040389867599, -77.452737372320087,
+    74.666666666666671, 0., 3.2960363030778193, 31.251226324602086, 0.,
+    -6.0821070087312457, 0.,
+    // shape 5
+    0., 2.8203283558848535, -24.794318400987894, 54.640656711769708,
+    -32.666666666666664, 0., 3.2097887147514919, -3.7369976897302384,
+    -12.985796002469733, 0., -8.5561270255333053, 22.206880619093894, 0.,
+    2.5260099548969599, 0.,
+    // shape 6
+    0., 0., 0., 0., 0., 0., 6.3244354716242386, -42.632957870142398,
+    49.821527375966639, 0., -0.97809716084242515, 14.628850754403013, 0.,
+    -2.5260099548969599, 0.,
+    // shape 7
+    0., 0., 0., 0., 0., 0., 3.534844381051339, -14.950284723115917,
+    6.0821070087312457, 0., -14.950284723115917, 49.497547350795827, 0.,
+    6.0821070087312457, 0.,
+    // shape 8
+    0., 0., 0., 0., 0., 0., 6.3244354716242386, -0.97809716084242515,
+    -2.5260099548969599, 0., -42.632957870142398, 14.628850754403013, 0.,
+    49.821527375966639, 0.,
+    // shape 9
+    0., 0., 0., 0., 0., 2.8203283558848535, 3.2097887147514919,
+    -8.5561270255333053, 2.5260099548969599, -24.794318400987894,
+    -3.7369976897302384, 22.206880619093894, 54.640656711769708,
+    -12.985796002469733, -32.666666666666664,
+    // shape 10
+    0., 0., 0., 0., 0., -5.333333333333333, 8.1194040389867599,
+    3.2960363030778193, -6.0821070087312457, 42.666666666666664,
+    -77.452737372320087, 31.251226324602086, -74.666666666666671,
+    74.666666666666671, 37.333333333333336,
+    // shape 11
+    0., 0., 0., 0., 0., 13.51300497744848, -70.523101859239361,
+    106.83162425775753, -49.821527375966639, -56.872348265678774,
+    185.38364416755144, -134.83573137349691, 76.026009954896963,
+    -117.68087066419693, -32.666666666666664,
+    // shape 12
+    0., 0., 0., 0., 0., 0., 83.273496997866971, -187.92304853973928,
+    104.64955154187231, 0., -187.92304853973928, 209.29910308374463, 0.,
+    104.64955154187231, 0.,
+    // shape 13
+    0., 0., 0., 0., 0., 0., -21.376054544005338, 126.02560608587766,
+    -104.64955154187231, 0., 21.376054544005338, -104.64955154187231, 0., 0.,
+    0.,
+    // shape 14
+    0., 0., 0., 0., 0., 0., -21.376054544005338, 21.376054544005338, 0., 0.,
+    126.02560608587766, -104.64955154187231, 0., -104.64955154187231, 0.
+  };
+};
+
+template <> struct LG_TetTable<3>
+{
+  static constexpr double C[400] = {
+    // shape 0
+    1., -6., 10., -5., -6., 21., -16., 10., -16., -5., -6., 21., -16., 21.,
+    -33., -16., 10., -16., -16., -5.,
+    // shape 1
+    0., 1., -5., 5., 0., 1., -1., 0., -1., 0., 0., 1., -1., 0., -1., 0., 0.,
+    -1., 0., 0.,
+    // shape 2
+    0., 0., 0., 0., 1., 1., -1., -5., -1., 5., 0., 0., 0., 1., -1., -1., 0.,
+    0., -1., 0.,
+    // shape 3
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 1., 1., -1., 1., -1., -1., -5.,
+    -1., -1., 5.,
+    // shape 4
+    0., 8.0901699437494745, -19.270509831248422, 11.180339887498949, 0.,
+    -21.180339887498949, 24.270509831248422, 0., 13.090169943749475, 0., 0.,
+    -21.180339887498949, 24.270509831248422, 0., 26.180339887498949, 0., 0.,
+    13.090169943749475, 0., 0.,
+    // shape 5
+    0., -3.0901699437494741, 14.270509831248424, -11.180339887498949, 0.,
+    1.1803398874989486, -9.2705098312484235, 0., 1.9098300562505257, 0., 0.,
+    1.1803398874989486, -9.2705098312484235, 0., 3.8196601125010514, 0., 0.,
+    1.9098300562505257, 0., 0.,
+    // shape 6
+    0., 0., 0., 0., 8.0901699437494745, -21.180339887498949,
+    13.090169943749475, -19.270509831248422, 24.270509831248422,
+    11.180339887498949, 0., 0., 0., -21.180339887498949, 26.180339887498949,
+    24.270509831248422, 0., 0., 13.090169943749475, 0.,
+    // shape 7
+    0., 0., 0., 0., -3.0901699437494741, 1.1803398874989486,
+    1.9098300562505257, 14.270509831248424, -9.2705098312484235,
+    -11.180339887498949, 0., 0., 0., 1.1803398874989486, 3.8196601125010514,
+    -9.2705098312484235, 0., 0., 1.9098300562505257, 0.,
+    // shape 8
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 8.0901699437494745,
+    -21.180339887498949, 13.090169943749475, -21.180339887498949,
+    26.180339887498949, 13.090169943749475, -19.270509831248422,
+    24.270509831248422, 24.270509831248422, 11.180339887498949,
+    // shape 9
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -3.0901699437494741,
+    1.1803398874989486, 1.9098300562505257, 1.1803398874989486,
+    3.8196601125010514, 1.9098300562505257, 14.270509831248424,
+    -9.2705098312484235, -9.2705098312484235, -11.180339887498949,
+    // shape 10
+    0., 0., 0., 0., 0., -5., 13.090169943749475, 0., 1.9098300562505257, 0.,
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    // shape 11
+    0., 0., 0., 0., 0., -5., 1.9098300562505257, 0., 13.090169943749475, 0.,
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    // shape 12
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -5., 13.090169943749475, 0.,
+    0., 0., 0., 1.9098300562505257, 0., 0.,
+    // shape 13
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -5., 1.9098300562505257, 0.,
+    0., 0., 0., 13.090169943749475, 0., 0.,
+    // shape 14
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -5., 0.,
+    13.090169943749475, 0., 0., 1.9098300562505257, 0.,
+    // shape 15
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -5., 0.,
+    1.9098300562505257, 0., 0., 13.090169943749475, 0.,
+    // shape 16
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 27., 0., 0., 0.,
+    0., 0.,
+    // shape 17
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 27., -27., -27., 0.,
+    0., -27., 0.,
+    // shape 18
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 27., -27., 0., -27., 0., 0.,
+    -27., 0., 0.,
+    // shape 19
+    0., 0., 0., 0., 0., 27., -27., 0., -27., 0., 0., 0., 0., 0., -27., 0., 0.,
+    0., 0., 0.
+  };
+};
+
+template <> struct LG_TetTable<4>
+{
+  static constexpr double C[1225] = {
+    // shape 0
+    1., -10., 30., -35., 14., -10., 66.942028661817531, -121.51371416612076,
+    65.571685504303247, 30., -121.51371416612076, 103.14337100860648, -35.,
+    65.571685504303247, 14., -10., 66.942028661817531, -121.51371416612076,
+    65.571685504303247, 66.942028661817531, -266.70031690144344,
+    223.01760192459736, -121.51371416612076, 223.01760192459736,
+    65.571685504303247, 30., -121.51371416612076, 103.14337100860648,
+    -121.51371416612076, 223.01760192459736, 103.14337100860648, -35.,
+    65.571685504303247, 65.571685504303247, 14.,
+    // shape 1
+    0., -1., 9., -21., 14., 0., -2.629656842485713, 12.201342346788953,
+    -9.5716855043032396, 0., 2.629656842485713, -9.5716855043032396, 0., 0.,
+    0., 0., -2.629656842485713, 12.201342346788953, -9.5716855043032396, 0.,
+    -4.5295175605954521, -2.4125111012220755, 0., 7.159174403081165, 0., 0.,
+    2.629656842485713, -9.5716855043032396, 0., 7.159174403081165, 0., 0., 0.,
+    0., 0.,
+    // shape 2
+    0., 0., 0., 0., 0., -1., -2.629656842485713, 2.629656842485713, 0., 9.,
+    12.201342346788953, -9.5716855043032396, -21., -9.5716855043032396, 14.,
+    0., 0., 0., 0., -2.629656842485713, -4.5295175605954521,
+    7.159174403081165, 12.201342346788953, -2.4125111012220755,
+    -9.5716855043032396, 0., 0., 0., 2.629656842485713, 7.159174403081165,
+    -9.5716855043032396, 0., 0., 0., 0.,
+    // shape 3
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., -1.,
+    -2.629656842485713, 2.629656842485713, 0., -2.629656842485713,
+    -4.5295175605954521, 7.159174403081165, 2.629656842485713,
+    7.159174403081165, 0., 9., 12.201342346788953, -9.5716855043032396,
+    12.201342346788953, -2.4125111012220755, -9.5716855043032396, -21.,
+    -9.5716855043032396, -9.5716855043032396, 14.,
+    // shape 4
+    0., 13.51300497744848, -56.872348265678774, 76.026009954896963,
+    -32.666666666666664, 0., -70.523101859239361, 185.38364416755144,
+    -117.68087066419693, 0., 106.83162425775753, -134.83573137349691, 0.,
+    -49.821527375966639, 0., 0., -70.523101859239361, 185.38364416755144,
+    -117.68087066419693, 0., 224.99213291799384, -281.00034714947259, 0.,
+    -160.79346653037871, 0., 0., 106.83162425775753, -134.83573137349691, 0.,
+    -160.79346653037871, 0., 0., -49.821527375966639, 0., 0.,
+    // shape 5
+    0., -5.333333333333333, 42.666666666666664, -74.666666666666671,
+    37.333333333333336, 0., 8.1194040389867599, -77.452737372320087,
+    74.666666666666671, 0., 3.2960363030778193, 31.251226324602086, 0.,
+    -6.0821070087312457, 0., 0., 8.1194040389867599, -77.452737372320087,
+    74.666666666666671, 0., 7.9750789260032429, 61.11944632935657, 0.,
+    -19.629327346041343, 0., 0., 3.2960363030778193, 31.251226324602086, 0.,
+    -19.629327346041343, 0., 0., -6.0821070087312457, 0., 0.,
+    // shape 6
+    0., 2.8203283558848535, -24.794318400987894, 54.640656711769708,
+    -32.666666666666664, 0., 3.2097887147514919, -3.7369976897302384,
+    -12.985796002469733, 0., -8.5561270255333053, 22.206880619093894, 0.,
+    2.5260099548969599, 0., 0., 3.2097887147514919, -3.7369976897302384,
+    -12.985796002469733, 0., -5.7833696485878248, 33.084876835709004, 0.,
+    -3.7508545377879057, 0., 0., -8.5561270255333053, 22.206880619093894, 0.,
+    -3.7508545377879057, 0., 0., 2.5260099548969599, 0., 0.,
+    // shape 7
+    0., 0., 0., 0., 0., 13.51300497744848, -70.523101859239361,
+    106.83162425775753, -49.821527375966639, -56.872348265678774,
+    185.38364416755144, -134.83573137349691, 76.026009954896963,
+    -117.68087066419693, -32.666666666666664, 0., 0., 0., 0.,
+    -70.523101859239361, 224.99213291799384, -160.79346653037871,
+    185.38364416755144, -281.00034714947259, -117.68087066419693, 0., 0., 0.,
+    106.83162425775753, -160.79346653037871, -134.83573137349691, 0., 0.,
+    -49.821527375966639, 0.,
+    // shape 8
+    0., 0., 0., 0., 0., -5.333333333333333, 8.1194040389867599,
+    3.2960363030778193, -6.0821070087312457, 42.666666666666664,
+    -77.452737372320087, 31.251226324602086, -74.666666666666671,
+    74.666666666666671, 37.333333333333336, 0., 0., 0., 0.,
+    8.1194040389867599, 7.9750789260032429, -19.629327346041343,
+    -77.452737372320087, 61.11944632935657, 74.666666666666671, 0., 0., 0.,
+    3.2960363030778193, -19.629327346041343, 31.251226324602086, 0., 0.,
+    -6.0821070087312457, 0.,
+    // shape 9
+    0., 0., 0., 0., 0., 2.8203283558848535, 3.2097887147514919,
+    -8.5561270255333053, 2.5260099548969599, -24.794318400987894,
+    -3.7369976897302384, 22.206880619093894, 54.640656711769708,
+    -12.985796002469733, -32.666666666666664, 0., 0., 0., 0.,
+    3.2097887147514919, -5.7833696485878248, -3.7508545377879057,
+    -3.7369976897302384, 33.084876835709004, -12.985796002469733, 0., 0., 0.,
+    -8.5561270255333053, -3.7508545377879057, 22.206880619093894, 0., 0.,
+    2.5260099548969599, 0.,
+    // shape 10
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    13.51300497744848, -70.523101859239361, 106.83162425775753,
+    -49.821527375966639, -70.523101859239361, 224.99213291799384,
+    -160.79346653037871, 106.83162425775753, -160.79346653037871,
+    -49.821527375966639, -56.872348265678774, 185.38364416755144,
+    -134.83573137349691, 185.38364416755144, -281.00034714947259,
+    -134.83573137349691, 76.026009954896963, -117.68087066419693,
+    -117.68087066419693, -32.666666666666664,
+    // shape 11
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    -5.333333333333333, 8.1194040389867599, 3.2960363030778193,
+    -6.0821070087312457, 8.1194040389867599, 7.9750789260032429,
+    -19.629327346041343, 3.2960363030778193, -19.629327346041343,
+    -6.0821070087312457, 42.666666666666664, -77.452737372320087,
+    31.251226324602086, -77.452737372320087, 61.11944632935657,
+    31.251226324602086, -74.666666666666671, 74.666666666666671,
+    74.666666666666671, 37.333333333333336,
+    // shape 12
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    2.8203283558848535, 3.2097887147514919, -8.5561270255333053,
+    2.5260099548969599, 3.2097887147514919, -5.7833696485878248,
+    -3.7508545377879057, -8.5561270255333053, -3.7508545377879057,
+    2.5260099548969599, -24.794318400987894, -3.7369976897302384,
+    22.206880619093894, -3.7369976897302384, 33.084876835709004,
+    22.206880619093894, 54.640656711769708, -12.985796002469733,
+    -12.985796002469733, -32.666666666666664,
+    // shape 13
+    0., 0., 0., 0., 0., 0., 6.3244354716242386, -42.632957870142398,
+    49.821527375966639, 0., -0.97809716084242515, 14.628850754403013, 0.,
+    -2.5260099548969599, 0., 0., 0., 0., 0., 0., 11.328884402478787,
+    -11.328884402478787, 0., -11.328884402478787, 0., 0., 0., 0., 0.,
+    -11.328884402478787, 0., 0., 0., 0., 0.,
+    // shape 14
+    0., 0., 0., 0., 0., 0., 3.534844381051339, -14.950284723115917,
+    6.0821070087312457, 0., -14.950284723115917, 49.497547350795827, 0.,
+    6.0821070087312457, 0., 0., 0., 0., 0., 0., 1.3830063198476048,
+    -1.3830063198476048, 0., -1.3830063198476048, 0., 0., 0., 0., 0.,
+    -1.3830063198476048, 0., 0., 0., 0., 0.,
+    // shape 15
+    0., 0., 0., 0., 0., 0., 6.3244354716242386, -0.97809716084242515,
+    -2.5260099548969599, 0., -42.632957870142398, 14.628850754403013, 0.,
+    49.821527375966639, 0., 0., 0., 0., 0., 0., 11.328884402478787,
+    -11.328884402478787, 0., -11.328884402478787, 0., 0., 0., 0., 0.,
+    -11.328884402478787, 0., 0., 0., 0., 0.,
+    // shape 16
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    6.3244354716242386, -42.632957870142398, 49.821527375966639, 0.,
+    11.328884402478787, -11.328884402478787, 0., -11.328884402478787, 0., 0.,
+    -0.97809716084242515, 14.628850754403013, 0., -11.328884402478787, 0., 0.,
+    -2.5260099548969599, 0., 0.,
+    // shape 17
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    3.534844381051339, -14.950284723115917, 6.0821070087312457, 0.,
+    1.3830063198476048, -1.3830063198476048, 0., -1.3830063198476048, 0., 0.,
+    -14.950284723115917, 49.497547350795827, 0., -1.3830063198476048, 0., 0.,
+    6.0821070087312457, 0., 0.,
+    // shape 18
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    6.3244354716242386, -0.97809716084242515, -2.5260099548969599, 0.,
+    11.328884402478787, -11.328884402478787, 0., -11.328884402478787, 0., 0.,
+    -42.632957870142398, 14.628850754403013, 0., -11.328884402478787, 0., 0.,
+    49.821527375966639, 0., 0.,
+    // shape 19
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 6.3244354716242386, 11.328884402478787, -11.328884402478787,
+    -42.632957870142398, -11.328884402478787, 49.821527375966639, 0., 0., 0.,
+    -0.97809716084242515, -11.328884402478787, 14.628850754403013, 0., 0.,
+    -2.5260099548969599, 0.,
+    // shape 20
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 3.534844381051339, 1.3830063198476048, -1.3830063198476048,
+    -14.950284723115917, -1.3830063198476048, 6.0821070087312457, 0., 0., 0.,
+    -14.950284723115917, -1.3830063198476048, 49.497547350795827, 0., 0.,
+    6.0821070087312457, 0.,
+    // shape 21
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 6.3244354716242386, 11.328884402478787, -11.328884402478787,
+    -0.97809716084242515, -11.328884402478787, -2.5260099548969599, 0., 0.,
+    0., -42.632957870142398, -11.328884402478787, 14.628850754403013, 0., 0.,
+    49.821527375966639, 0.,
+    // shape 22
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 0., -40.521387909856301, 123.79488490772329, 0., 19.145333365850966,
+    0., 0., 0., 0., 0., 19.145333365850966, 0., 0., 0., 0., 0.,
+    // shape 23
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 0., -40.521387909856301, 19.145333365850966, 0., 123.79488490772329,
+    0., 0., 0., 0., 0., 19.145333365850966, 0., 0., 0., 0., 0.,
+    // shape 24
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 0., -40.521387909856301, 19.145333365850966, 0., 19.145333365850966,
+    0., 0., 0., 0., 0., 123.79488490772329, 0., 0., 0., 0., 0.,
+    // shape 25
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 83.273496997866971, -207.06838190559026, 123.79488490772329,
+    -187.92304853973928, 228.4444364495956, 104.64955154187231, 0., 0., 0.,
+    -187.92304853973928, 228.4444364495956, 209.29910308374463, 0., 0.,
+    104.64955154187231, 0.,
+    // shape 26
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., -21.376054544005338, 2.2307211781543717, 19.145333365850966,
+    21.376054544005338, 19.145333365850966, 0., 0., 0., 0.,
+    126.02560608587766, -85.504218176021354, -104.64955154187231, 0., 0.,
+    -104.64955154187231, 0.,
+    // shape 27
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., -21.376054544005338, 2.2307211781543717, 19.145333365850966,
+    126.02560608587766, -85.504218176021354, -104.64955154187231, 0., 0., 0.,
+    21.376054544005338, 19.145333365850966, -104.64955154187231, 0., 0., 0.,
+    0.,
+    // shape 28
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    83.273496997866971, -187.92304853973928, 104.64955154187231, 0.,
+    -207.06838190559026, 228.4444364495956, 0., 123.79488490772329, 0., 0.,
+    -187.92304853973928, 209.29910308374463, 0., 228.4444364495956, 0., 0.,
+    104.64955154187231, 0., 0.,
+    // shape 29
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    -21.376054544005338, 126.02560608587766, -104.64955154187231, 0.,
+    2.2307211781543717, -85.504218176021354, 0., 19.145333365850966, 0., 0.,
+    21.376054544005338, -104.64955154187231, 0., 19.145333365850966, 0., 0.,
+    0., 0., 0.,
+    // shape 30
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    -21.376054544005338, 21.376054544005338, 0., 0., 2.2307211781543717,
+    19.145333365850966, 0., 19.145333365850966, 0., 0., 126.02560608587766,
+    -104.64955154187231, 0., -85.504218176021354, 0., 0., -104.64955154187231,
+    0., 0.,
+    // shape 31
+    0., 0., 0., 0., 0., 0., 83.273496997866971, -187.92304853973928,
+    104.64955154187231, 0., -187.92304853973928, 209.29910308374463, 0.,
+    104.64955154187231, 0., 0., 0., 0., 0., 0., -207.06838190559026,
+    228.4444364495956, 0., 228.4444364495956, 0., 0., 0., 0., 0.,
+    123.79488490772329, 0., 0., 0., 0., 0.,
+    // shape 32
+    0., 0., 0., 0., 0., 0., -21.376054544005338, 21.376054544005338, 0., 0.,
+    126.02560608587766, -104.64955154187231, 0., -104.64955154187231, 0., 0.,
+    0., 0., 0., 0., 2.2307211781543717, 19.145333365850966, 0.,
+    -85.504218176021354, 0., 0., 0., 0., 0., 19.145333365850966, 0., 0., 0.,
+    0., 0.,
+    // shape 33
+    0., 0., 0., 0., 0., 0., -21.376054544005338, 126.02560608587766,
+    -104.64955154187231, 0., 21.376054544005338, -104.64955154187231, 0., 0.,
+    0., 0., 0., 0., 0., 0., 2.2307211781543717, -85.504218176021354, 0.,
+    19.145333365850966, 0., 0., 0., 0., 0., 19.145333365850966, 0., 0., 0.,
+    0., 0.,
+    // shape 34
+    0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.,
+    0., 0., 256., -256., 0., -256., 0., 0., 0., 0., 0., -256., 0., 0., 0., 0.,
+    0.
+  };
+};
+
+// C++11 needs namespace scope definitions of the odr-used tables
+constexpr double LG_TriTable<3>::C[100];
+constexpr double LG_TriTable<4>::C[225];
+constexpr double LG_TetTable<3>::C[400];
+constexpr double LG_TetTable<4>::C[1225];
+
+#endif
@@ -0,0 +1,423 @@
+#ifndef LAGRANGE_KERNELS
+#define LAGRANGE_KERNELS
+
+#include <mfem.hpp>
+
+#include "LagrangeKernelTables.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Highest order with compile-time specialized LG kernels. Elements of a
+/// higher order (or of a basis type other than GaussLobatto) use the
+/// runtime tables of LagrangeElements.hpp.
+const int LG_MAX_KERNEL_ORDER = 4;
+
+/// prod_{j != i, j < n} (x[i] - x[j]), evaluated at compile time
+constexpr double LG_BaryProd(
+    const double *x,
+    const int n,
+    const int i,
+    const int j = 0)
+{
+  return (j == n) ? 1. :
+         ((j == i) ? 1. : (x[i] - x[j])) * LG_BaryProd(x, n, i, j + 1);
+}
+
+/// Gauss-Lobatto nodes of order P on [0,1] (increasing) and their barycentric
+/// weights w[i] = 1/prod_{j != i}(x[i] - x[j])
+template <int P> struct LG_GLTable;
+
+template <> struct LG_GLTable<1>
+{
+  static constexpr double x[2] = { 0., 1. };
+  static constexpr double w[2] = {
+    1./LG_BaryProd(x, 2, 0), 1./LG_BaryProd(x, 2, 1) };
+};
+
+template <> struct LG_GLTable<2>
+{
+  static constexpr double x[3] = { 0., 0.5, 1. };
+  static constexpr double w[3] = {
+    1./LG_BaryProd(x, 3, 0), 1./LG_BaryProd(x, 3, 1),
+    1./LG_BaryProd(x, 3, 2) };
+};
+
+template <> struct LG_GLTable<3>
+{
+  // (1 -+ 1/sqrt(5))/2
+  static constexpr double x[4] = {
+    0., 0.27639320225002103036, 0.72360679774997896964, 1. };
+  static constexpr double w[4] = {
+    1./LG_BaryProd(x, 4, 0), 1./LG_BaryProd(x, 4, 1),
+    1./LG_BaryProd(x, 4, 2), 1./LG_BaryProd(x, 4, 3) };
+};
+
+template <> struct LG_GLTable<4>
+{
+  // (1 -+ sqrt(3/7))/2
+  static constexpr double x[5] = {
+    0., 0.17267316464601142810, 0.5, 0.82732683535398857190, 1. };
+  static constexpr double w[5] = {
+    1./LG_BaryProd(x, 5, 0), 1./LG_BaryProd(x, 5, 1),
+    1./LG_BaryProd(x, 5, 2), 1./LG_BaryProd(x, 5, 3),
+    1./LG_BaryProd(x, 5, 4) };
+};
+
+// C++11 needs namespace scope definitions of the odr-used tables
+constexpr double LG_GLTable<1>::x[2];
+constexpr double LG_GLTable<1>::w[2];
+constexpr double LG_GLTable<2>::x[3];
+constexpr double LG_GLTable<2>::w[3];
+constexpr double LG_GLTable<3>::x[4];
+constexpr double LG_GLTable<3>::w[4];
+constexpr double LG_GLTable<4>::x[5];
+constexpr double LG_GLTable<4>::w[5];
+
+/// Return P if the LG elements of order p and basis type btype have a
+/// specialized kernel, 0 if they must use the runtime tables
+inline int LG_KernelOrder(const int p, const int btype)
+{
+  return (btype == BasisType::GaussLobatto && p <= LG_MAX_KERNEL_ORDER) ?
+         p : 0;
+}
+
+/// Sizes of the sum-factorized quad/hex kernels with compile-time trip
+/// counts: D = P + 1 dofs per direction for P <= LG_MAX_KERNEL_ORDER and
+/// Q = D or D + 1 points per direction (the Gauss rules of the diffusion
+/// and mass forms). Returns 2*(D - 2) + (Q - D) + 1 for these, 0 for the
+/// loops sized at run time. They only depend on the sizes, not the nodes.
+inline int LG_TensorKernel(const int D, const int Q)
+{
+  return (D >= 2 && D <= LG_MAX_KERNEL_ORDER + 1 && (Q == D || Q == D + 1)) ?
+         2*(D - 2) + (Q - D) + 1 : 0;
+}
+
+/// 1D Lagrange polynomials of order P on the Gauss-Lobatto nodes. All trip
+/// counts are compile-time constants, so the loops unroll completely.
+template <int P>
+struct LG_Kernel1D
+{
+  static inline void Eval(const double t, double *u)
+  {
+    const double *x = LG_GLTable<P>::x, *w = LG_GLTable<P>::w;
+    double l = 1.;
+    for (int i = 0; i <= P; i++)
+    {
+      u[i] = w[i]*l;
+      l *= t - x[i];
+    }
+    double r = 1.;
+    for (int i = P; i >= 0; i--)
+    {
+      u[i] *= r;
+      r *= t - x[i];
+    }
+  }
+
+  static inline void Eval(const double t, double *u, double *d)
+  {
+    const double *x = LG_GLTable<P>::x, *w = LG_GLTable<P>::w;
+    double l = 1., dl = 0.;
+    for (int i = 0; i <= P; i++)
+    {
+      u[i] = l;
+      d[i] = dl;
+      dl = dl*(t - x[i]) + l;
+      l *= t - x[i];
+    }
+    double r = 1., dr = 0.;
+    for (int i = P; i >= 0; i--)
+    {
+      d[i] = w[i]*(d[i]*r + u[i]*dr);
+      u[i] = w[i]*u[i]*r;
+      dr = dr*(t - x[i]) + r;
+      r *= t - x[i];
+    }
+  }
+};
+
+/// Triangle shapes of order P in the LG node ordering (vertices, edges,
+/// interior). The general version contracts the monomials x^i y^j with the
+/// compile-time coefficients of LG_TriTable<P>; P = 1 and P = 2 are closed
+/// forms in the barycentric coordinates.
+template <int P>
+struct LG_TriKernel
+{
+  static const int D = ((P + 1)*(P + 2))/2;
+
+  static inline void Eval(
+      const double x,
+      const double y,
+      double *shape)
+  {
+    const double *C = LG_TriTable<P>::C;
+    double px[P+1], py[P+1], u[D];
+    px[0] = py[0] = 1.;
+    for (int i = 1; i <= P; i++)
+    {
+      px[i] = px[i-1]*x;
+      py[i] = py[i-1]*y;
+    }
+    for (int o = 0, j = 0; j <= P; j++)
+      for (int i = 0; i + j <= P; i++)
+        u[o++] = px[i]*py[j];
+    for (int m = 0; m < D; m++)
+    {
+      double s = 0.;
+      for (int o = 0; o < D; o++)
+        s += C[m*D + o]*u[o];
+      shape[m] = s;
+    }
+  }
+
+  static inline void Eval(
+      const double x,
+      const double y,
+      double *dshape_x,
+      double *dshape_y)
+  {
+    const double *C = LG_TriTable<P>::C;
+    double px[P+1], py[P+1], du_x[D], du_y[D];
+    px[0] = py[0] = 1.;
+    for (int i = 1; i <= P; i++)
+    {
+      px[i] = px[i-1]*x;
+      py[i] = py[i-1]*y;
+    }
+    for (int o = 0, j = 0; j <= P; j++)
+      for (int i = 0; i + j <= P; i++)
+      {
+        du_x[o] = i ? i*px[i-1]*py[j] : 0.;
+        du_y[o] = j ? j*px[i]*py[j-1] : 0.;
+        o++;
+      }
+    for (int m = 0; m < D; m++)
+    {
+      double sdx = 0., sdy = 0.;
+      for (int o = 0; o < D; o++)
+      {
+        sdx += C[m*D + o]*du_x[o];
+        sdy += C[m*D + o]*du_y[o];
+      }
+      dshape_x[m] = sdx;
+      dshape_y[m] = sdy;
+    }
+  }
+};
+
+template <>
+struct LG_TriKernel<1>
+{
+  static inline void Eval(const double x, const double y, double *shape)
+  {
+    shape[0] = 1. - x - y;
+    shape[1] = x;
+    shape[2] = y;
+  }
+
+  static inline void Eval(const double, const double, double *dshape_x,
+                          double *dshape_y)
+  {
+    dshape_x[0] = -1.; dshape_x[1] = 1.; dshape_x[2] = 0.;
+    dshape_y[0] = -1.; dshape_y[1] = 0.; dshape_y[2] = 1.;
+  }
+};
+
+template <>
+struct LG_TriKernel<2>
+{
+  // nodes 0,1,2 are the vertices, 3,4,5 the midpoints of edges 01, 12, 20
+  static inline void Eval(const double x, const double y, double *shape)
+  {
+    const double l0 = 1. - x - y, l1 = x, l2 = y;
+    shape[0] = l0*(2.*l0 - 1.);
+    shape[1] = l1*(2.*l1 - 1.);
+    shape[2] = l2*(2.*l2 - 1.);
+    shape[3] = 4.*l0*l1;
+    shape[4] = 4.*l1*l2;
+    shape[5] = 4.*l2*l0;
+  }
+
+  static inline void Eval(const double x, const double y, double *dshape_x,
+                          double *dshape_y)
+  {
+    const double l0 = 1. - x - y, l1 = x, l2 = y;
+    dshape_x[0] = 1. - 4.*l0;
+    dshape_x[1] = 4.*l1 - 1.;
+    dshape_x[2] = 0.;
+    dshape_x[3] = 4.*(l0 - l1);
+    dshape_x[4] = 4.*l2;
+    dshape_x[5] = -4.*l2;
+
+    dshape_y[0] = 1. - 4.*l0;
+    dshape_y[1] = 0.;
+    dshape_y[2] = 4.*l2 - 1.;
+    dshape_y[3] = -4.*l1;
+    dshape_y[4] = 4.*l1;
+    dshape_y[5] = 4.*(l0 - l2);
+  }
+};
+
+/// Tetrahedron shapes of order P in the LG node ordering (vertices, edges,
+/// faces, interior), from the monomials x^i y^j z^k and the compile-time
+/// coefficients of LG_TetTable<P> like LG_TriKernel; P = 1 and P = 2 are the
+/// closed forms.
+template <int P>
+struct LG_TetKernel
+{
+  static const int D = ((P + 1)*(P + 2)*(P + 3))/6;
+
+  static inline void Eval(
+      const double x,
+      const double y,
+      const double z,
+      double *shape)
+  {
+    const double *C = LG_TetTable<P>::C;
+    double px[P+1], py[P+1], pz[P+1], u[D];
+    px[0] = py[0] = pz[0] = 1.;
+    for (int i = 1; i <= P; i++)
+    {
+      px[i] = px[i-1]*x;
+      py[i] = py[i-1]*y;
+      pz[i] = pz[i-1]*z;
+    }
+    for (int o = 0, k = 0; k <= P; k++)
+      for (int j = 0; j + k <= P; j++)
+        for (int i = 0; i + j + k <= P; i++)
+          u[o++] = px[i]*py[j]*pz[k];
+    for (int m = 0; m < D; m++)
+    {
+      double s = 0.;
+      for (int o = 0; o < D; o++)
+        s += C[m*D + o]*u[o];
+      shape[m] = s;
+    }
+  }
+
+  static inline void Eval(
+      const double x,
+      const double y,
+      const double z,
+      double *dshape_x,
+      double *dshape_y,
+      double *dshape_z)
+  {
+    const double *C = LG_TetTable<P>::C;
+    double px[P+1], py[P+1], pz[P+1], du_x[D], du_y[D], du_z[D];
+    px[0] = py[0] = pz[0] = 1.;
+    for (int i = 1; i <= P; i++)
+    {
+      px[i] = px[i-1]*x;
+      py[i] = py[i-1]*y;
+      pz[i] = pz[i-1]*z;
+    }
+    for (int o = 0, k = 0; k <= P; k++)
+      for (int j = 0; j + k <= P; j++)
+        for (int i = 0; i + j + k <= P; i++)
+        {
+          du_x[o] = i ? i*px[i-1]*py[j]*pz[k] : 0.;
+          du_y[o] = j ? j*px[i]*py[j-1]*pz[k] : 0.;
+          du_z[o] = k ? k*px[i]*py[j]*pz[k-1] : 0.;
+          o++;
+        }
+    for (int m = 0; m < D; m++)
+    {
+      double sdx = 0., sdy = 0., sdz = 0.;
+      for (int o = 0; o < D; o++)
+      {
+        sdx += C[m*D + o]*du_x[o];
+        sdy += C[m*D + o]*du_y[o];
+        sdz += C[m*D + o]*du_z[o];
+      }
+      dshape_x[m] = sdx;
+      dshape_y[m] = sdy;
+      dshape_z[m] = sdz;
+    }
+  }
+};
+
+template <>
+struct LG_TetKernel<1>
+{
+  static inline void Eval(const double x, const double y, const double z,
+                          double *shape)
+  {
+    shape[0] = 1. - x - y - z;
+    shape[1] = x;
+    shape[2] = y;
+    shape[3] = z;
+  }
+
+  static inline void Eval(const double, const double, const double,
+                          double *dshape_x, double *dshape_y, double *dshape_z)
+  {
+    dshape_x[0] = -1.; dshape_x[1] = 1.; dshape_x[2] = 0.; dshape_x[3] = 0.;
+    dshape_y[0] = -1.; dshape_y[1] = 0.; dshape_y[2] = 1.; dshape_y[3] = 0.;
+    dshape_z[0] = -1.; dshape_z[1] = 0.; dshape_z[2] = 0.; dshape_z[3] = 1.;
+  }
+};
+
+template <>
+struct LG_TetKernel<2>
+{
+  // nodes 0-3 are the vertices, 4-9 the midpoints of edges 01, 02, 03, 12,
+  // 13, 23
+  static inline void Eval(const double x, const double y, const double z,
+                          double *shape)
+  {
+    const double l0 = 1. - x - y - z, l1 = x, l2 = y, l3 = z;
+    shape[0] = l0*(2.*l0 - 1.);
+    shape[1] = l1*(2.*l1 - 1.);
+    shape[2] = l2*(2.*l2 - 1.);
+    shape[3] = l3*(2.*l3 - 1.);
+    shape[4] = 4.*l0*l1;
+    shape[5] = 4.*l0*l2;
+    shape[6] = 4.*l0*l3;
+    shape[7] = 4.*l1*l2;
+    shape[8] = 4.*l1*l3;
+    shape[9] = 4.*l2*l3;
+  }
+
+  static inline void Eval(const double x, const double y, const double z,
+                          double *dshape_x, double *dshape_y, double *dshape_z)
+  {
+    const double l0 = 1. - x - y - z, l1 = x, l2 = y, l3 = z;
+    const double d0 = 1. - 4.*l0;
+    dshape_x[0] = d0;
+    dshape_x[1] = 4.*l1 - 1.;
+    dshape_x[2] = 0.;
+    dshape_x[3] = 0.;
+    dshape_x[4] = 4.*(l0 - l1);
+    dshape_x[5] = -4.*l2;
+    dshape_x[6] = -4.*l3;
+    dshape_x[7] = 4.*l2;
+    dshape_x[8] = 4.*l3;
+    dshape_x[9] = 0.;
+
+    dshape_y[0] = d0;
+    dshape_y[1] = 0.;
+    dshape_y[2] = 4.*l2 - 1.;
+    dshape_y[3] = 0.;
+    dshape_y[4] = -4.*l1;
+    dshape_y[5] = 4.*(l0 - l2);
+    dshape_y[6] = -4.*l3;
+    dshape_y[7] = 4.*l1;
+    dshape_y[8] = 0.;
+    dshape_y[9] = 4.*l3;
+
+    dshape_z[0] = d0;
+    dshape_z[1] = 0.;
+    dshape_z[2] = 0.;
+    dshape_z[3] = 4.*l3 - 1.;
+    dshape_z[4] = -4.*l1;
+    dshape_z[5] = -4.*l2;
+    dshape_z[6] = 4.*(l0 - l3);
+    dshape_z[7] = 0.;
+    dshape_z[8] = 4.*l1;
+    dshape_z[9] = 4.*l2;
+  }
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef LAGRANGE_MIXED_PRECISION
+#define LAGRANGE_MIXED_PRECISION
+
+#include <vector>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeSmoothers.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Single precision copy of the values of a SparseMatrix. The row offsets
+/// and column indices are those of the double matrix, which has to outlive
+/// it. Products load the float values and accumulate in double.
+class LG_FloatSparseMatrix : public Operator
+{
+protected:
+  const SparseMatrix &A;
+  std::vector<float> a;
+
+public:
+  LG_FloatSparseMatrix(const SparseMatrix &A);
+
+  const SparseMatrix &GetDoubleMatrix() const
+  { return A; }
+  const float *GetData() const
+  { return a.data(); }
+
+  /// Bytes a product reads from the matrix: float values and the indices
+  long GetSpMVBytes() const;
+
+  virtual void Mult(const Vector &x, Vector &y) const;
+};
+
+/// Symmetric Gauss-Seidel (one forward and one backward sweep from zero, as
+/// GSSmoother) on the float values, with single precision work vectors
+class LG_FloatGSSmoother : public Solver
+{
+protected:
+  const LG_FloatSparseMatrix &A;
+  std::vector<float> dinv;
+  mutable std::vector<float> b, x, s;
+
+public:
+  LG_FloatGSSmoother(const LG_FloatSparseMatrix &A);
+
+  virtual void SetOperator(const Operator &op) { }
+  virtual void Mult(const Vector &x, Vector &y) const;
+};
+
+/// Mixed precision iterative refinement for A x = b. The correction equation
+/// A d = r is solved by PCG on LG_FloatSparseMatrix and LG_FloatGSSmoother
+/// down to the inner tolerance, with the Krylov vectors in double, and the
+/// residual r = b - A x is recomputed with the double matrix after every
+/// correction until |r| <= rel_tol |b|. Starts from x when iterative_mode is
+/// set.
+class LG_MixedPrecisionSolver : public Solver
+{
+protected:
+  const SparseMatrix *A;
+  LG_FloatSparseMatrix *A_f;
+  LG_FloatGSSmoother *M_f;
+  double rel_tol, inner_tol;
+  int max_refinements;
+  mutable int refinements, inner_iterations;
+  mutable double final_norm;
+
+public:
+  LG_MixedPrecisionSolver();
+  ~LG_MixedPrecisionSolver();
+
+  void SetRelTol(double rtol)
+  { rel_tol = rtol; }
+  void SetInnerRelTol(double rtol)
+  { inner_tol = rtol; }
+  void SetMaxRefinements(int max_ref)
+  { max_refinements = max_ref; }
+
+  int GetNumRefinements() const
+  { return refinements; }
+  /// PCG iterations of all the corrections of the last Mult
+  int GetNumInnerIterations() const
+  { return inner_iterations; }
+  /// |b - A x| after the last Mult
+  double GetFinalNorm() const
+  { return final_norm; }
+
+  /// Bytes held by the solver and the operator: the double values kept for
+  /// the residuals, the float values, the indices shared by both and the
+  /// single precision smoother data
+  long MemoryUsage() const;
+  /// Bytes an inner (single precision) product reads from the matrix
+  long GetInnerSpMVBytes() const;
+
+  /// op has to be a SparseMatrix, which is referenced, not copied
+  virtual void SetOperator(const Operator &op);
+  virtual void Mult(const Vector &b, Vector &x) const;
+};
+
+
+// LG_FloatSparseMatrix implementation
+LG_FloatSparseMatrix::LG_FloatSparseMatrix(const SparseMatrix &A_)
+   : Operator(A_.Height(), A_.Width()), A(A_), a(A_.NumNonZeroElems())
+{
+  const double *d = A.GetData();
+  for (size_t m = 0; m < a.size(); m++)
+    a[m] = (float) d[m];
+}
+
+long LG_FloatSparseMatrix::GetSpMVBytes() const
+{
+  return (long) a.size()*(sizeof(float) + sizeof(int)) +
+         (long) (height + 1)*sizeof(int);
+}
+
+void LG_FloatSparseMatrix::Mult(const Vector &x, Vector &y) const
+{
+  const int *I = A.GetI();
+  const int *J = A.GetJ();
+  for (int i = 0; i < height; i++)
+  {
+    double s = 0.0;
+    for (int m = I[i]; m < I[i+1]; m++)
+      s += a[m]*x(J[m]);
+    y(i) = s;
+  }
+}
+
+
+// LG_FloatGSSmoother implementation
+LG_FloatGSSmoother::LG_FloatGSSmoother(const LG_FloatSparseMatrix &A_)
+   : Solver(A_.Height()), A(A_), dinv(A_.Height()), b(A_.Height()),
+     x(A_.Height()), s(1)
+{
+  const int *I = A.GetDoubleMatrix().GetI();
+  const int *J = A.GetDoubleMatrix().GetJ();
+  const float *a = A.GetData();
+  for (int i = 0; i < height; i++)
+  {
+    dinv[i] = 0.0f;
+    for (int m = I[i]; m < I[i+1]; m++)
+      if (J[m] == i)
+        dinv[i] = 1.0f/a[m];
+    MFEM_VERIFY(dinv[i] != 0.0f, "zero on the diagonal at row " << i);
+  }
+}
+
+void LG_FloatGSSmoother::Mult(const Vector &r, Vector &y) const
+{
+  const int n = height;
+  for (int i = 0; i < n; i++)
+    b[i] = (float) r(i);
+  LG_SymmetricGSSweep<float, 1>(n, A.GetDoubleMatrix().GetI(),
+                                A.GetDoubleMatrix().GetJ(), A.GetData(),
+                                dinv.data(), b.data(), x.data(), s.data());
+
+  y.SetSize(n);
+  for (int i = 0; i < n; i++)
+    y(i) = x[i];
+}
+
+
+// LG_MixedPrecisionSolver implementation
+LG_MixedPrecisionSolver::LG_MixedPrecisionSolver()
+   : A(NULL), A_f(NULL), M_f(NULL), rel_tol(1e-12), inner_tol(1e-4),
+     max_refinements(50), refinements(0), inner_iterations(0),
+     final_norm(0.0)
+{
+}
+
+LG_MixedPrecisionSolver::~LG_MixedPrecisionSolver()
+{
+  delete M_f;
+  delete A_f;
+}
+
+long LG_MixedPrecisionSolver::MemoryUsage() const
+{
+  MFEM_VERIFY(A_f, "set the operator first");
+  const long nnz = A->NumNonZeroElems();
+  return nnz*sizeof(double) + A_f->GetSpMVBytes() +
+         3L*height*sizeof(float);
+}
+
+long LG_MixedPrecisionSolver::GetInnerSpMVBytes() const
+{
+  MFEM_VERIFY(A_f, "set the operator first");
+  return A_f->GetSpMVBytes();
+}
+
+void LG_MixedPrecisionSolver::SetOperator(const Operator &op)
+{
+  A = dynamic_cast<const SparseMatrix *>(&op);
+  MFEM_VERIFY(A, "LG_MixedPrecisionSolver needs a SparseMatrix");
+  height = A->Height();
+  width = A->Width();
+  delete M_f;
+  delete A_f;
+  A_f = new LG_FloatSparseMatrix(*A);
+  M_f = new LG_FloatGSSmoother(*A_f);
+}
+
+void LG_MixedPrecisionSolver::Mult(const Vector &b, Vector &x) const
+{
+  MFEM_VERIFY(A, "set the operator first");
+  if (!iterative_mode)
+    x = 0.0;
+
+  CGSolver cg;
+  cg.SetRelTol(inner_tol);
+  cg.SetAbsTol(0.0);
+  cg.SetMaxIter(5000);
+  cg.SetPrintLevel(-1);
+  cg.SetPreconditioner(*M_f);
+  cg.SetOperator(*A_f);
+
+  const double tol = rel_tol*b.Norml2();
+  Vector r(height), d(height);
+  inner_iterations = 0;
+  for (refinements = 0; ; refinements++)
+  {
+    // residual in double
+    A->Mult(x, r);
+    r.Neg();
+    r += b;
+    final_norm = r.Norml2();
+    if (final_norm <= tol || refinements == max_refinements)
+      break;
+
+    d = 0.0;
+    cg.Mult(r, d);
+    inner_iterations += cg.GetNumIterations();
+    x += d;
+  }
+}
+
+#endif
@@ -0,0 +1,449 @@
+#ifndef LAGRANGE_MULTIGRID
+#define LAGRANGE_MULTIGRID
+
+#include <vector>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeIntegrators.hpp"
+#include "LagrangeOperators.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Interpolation from the space coarse to the space fine, both on the same
+/// mesh (e.g. two LG orders): row i holds the coarse shapes at the node of
+/// fine dof i. The coarse space must be contained in the fine one.
+SparseMatrix *LG_OrderProlongation(
+    const FiniteElementSpace *coarse,
+    const FiniteElementSpace *fine);
+
+/// Interpolation from the space coarse to the space fine on the uniform
+/// refinement of its mesh, given the refinement transformations of the fine
+/// mesh: row i holds the coarse shapes of the parent element at the node of
+/// fine dof i.
+SparseMatrix *LG_RefinementProlongation(
+    const FiniteElementSpace *coarse,
+    const FiniteElementSpace *fine,
+    const CoarseFineTransformations &cft);
+
+/// Multigrid V-cycle over a hierarchy of assembled matrices with essential
+/// rows eliminated (level 0 is the finest).
+///
+/// Every level but the coarsest is smoothed before and after the coarse
+/// correction (one symmetric Gauss-Seidel sweep unless the level brings its
+/// own smoother) and the restriction is the transpose of the prolongation,
+/// so the cycle is a symmetric preconditioner for PCG. The restricted
+/// residual is zeroed on the essential dofs of the coarse level, so the
+/// correction never touches the Dirichlet values. The coarsest level is
+/// solved directly by UMFPack when MFEM has SuiteSparse, otherwise by PCG to
+/// a tight tolerance.
+///
+/// Derived classes build the hierarchy with AddLevel and call
+/// SetupCoarseSolve once the coarsest level is added.
+class LG_Multigrid : public Solver
+{
+protected:
+  Array<const SparseMatrix*> A;    // level matrices, not owned
+  Array<SparseMatrix*> P;          // P[l]: level l+1 to level l
+  Array<Array<int>*> ess;          // essential dofs of each level
+  Array<Solver*> smoothers;
+#ifdef MFEM_USE_SUITESPARSE
+  UMFPackSolver coarse_solver;
+#else
+  CGSolver coarse_solver;
+  GSSmoother coarse_prec;
+#endif
+  mutable std::vector<Vector> res, rhs, cor;
+
+  /// Add a level coarser than all the current ones; P interpolates from the
+  /// new level to the previous one (NULL for the finest level). Takes the
+  /// ownership of P and S; S must start from its output in iterative_mode
+  /// and defaults to a symmetric Gauss-Seidel sweep.
+  void AddLevel(
+      const SparseMatrix *A_l,
+      const Array<int> &ess_tdof_list,
+      SparseMatrix *P_l,
+      Solver *S = NULL);
+  void SetupCoarseSolve();
+
+  void Cycle(int l, const Vector &b, Vector &x) const;
+
+public:
+  LG_Multigrid();
+  virtual ~LG_Multigrid();
+
+  int GetNumLevels() const
+  { return A.Size(); }
+  const SparseMatrix &GetLevelMatrix(int l) const
+  { return *A[l]; }
+
+  virtual void SetOperator(const Operator &op) { }
+  virtual void Mult(const Vector &b, Vector &x) const;
+};
+
+/// p-multigrid on the LG space of order p of the matrix A_fine: the levels
+/// are the LG_FECollection spaces of orders p, p-1, ..., 1 on the same mesh,
+/// each with its own LG_DiffusionIntegrator matrix, and the coarse solve is
+/// on the linear space.
+class LG_PMultigrid : public LG_Multigrid
+{
+protected:
+  Array<LG_FECollection*> fecs;    // levels 1, 2, ... (owned)
+  Array<FiniteElementSpace*> spaces;
+  Array<BilinearForm*> forms;
+
+public:
+  LG_PMultigrid(
+      FiniteElementSpace *fes,
+      const SparseMatrix &A_fine,
+      const Array<int> &ess_bdr,
+      Coefficient &Q);
+  virtual ~LG_PMultigrid();
+};
+
+/// Geometric multigrid on the space fes of the matrix A_fine, whose mesh is
+/// coarse_mesh uniformly refined nref times: the levels are the same
+/// LG_FECollection on the meshes refined nref, nref-1, ..., 0 times, each
+/// with its own LG_DiffusionIntegrator matrix and a Chebyshev smoother, and
+/// the coarse solve is on coarse_mesh.
+class LG_GMultigrid : public LG_Multigrid
+{
+protected:
+  Array<Mesh*> meshes;             // refined 0, 1, ..., nref-1 times (owned)
+  Array<FiniteElementSpace*> spaces;
+  Array<BilinearForm*> forms;
+
+public:
+  LG_GMultigrid(
+      FiniteElementSpace *fes,
+      const SparseMatrix &A_fine,
+      const Array<int> &ess_bdr,
+      Coefficient &Q,
+      const Mesh &coarse_mesh,
+      const int nref,
+      const int cheb_order = 3);
+  virtual ~LG_GMultigrid();
+};
+
+
+SparseMatrix *LG_OrderProlongation(
+    const FiniteElementSpace *coarse,
+    const FiniteElementSpace *fine)
+{
+  MFEM_VERIFY(coarse->GetMesh() == fine->GetMesh(),
+      "the spaces must share the mesh");
+  SparseMatrix *P = new SparseMatrix(fine->GetVSize(), coarse->GetVSize());
+
+  Array<int> cdofs, fdofs;
+  Vector shape;
+  for (int e = 0; e < fine->GetNE(); e++)
+  {
+    const FiniteElement *cfe = coarse->GetFE(e);
+    const IntegrationRule &nodes = fine->GetFE(e)->GetNodes();
+    coarse->GetElementDofs(e, cdofs);
+    fine->GetElementDofs(e, fdofs);
+    shape.SetSize(cfe->GetDof());
+    for (int k = 0; k < nodes.GetNPoints(); k++)
+    {
+      cfe->CalcShape(nodes.IntPoint(k), shape);
+      // the spaces are continuous, so shared dofs get the same row from
+      // every element
+      for (int j = 0; j < cdofs.Size(); j++)
+        if (fabs(shape(j)) > 1e-12)
+          P->Set(fdofs[k], cdofs[j], shape(j));
+    }
+  }
+  P->Finalize();
+  return P;
+}
+
+SparseMatrix *LG_RefinementProlongation(
+    const FiniteElementSpace *coarse,
+    const FiniteElementSpace *fine,
+    const CoarseFineTransformations &cft)
+{
+  MFEM_VERIFY(cft.embeddings.Size() == fine->GetNE(),
+      "the transformations do not match the fine mesh");
+  SparseMatrix *P = new SparseMatrix(fine->GetVSize(), coarse->GetVSize());
+
+  IsoparametricTransformation T;
+  Array<int> cdofs, fdofs;
+  Vector shape, xc;
+  IntegrationPoint ipc;
+  for (int e = 0; e < fine->GetNE(); e++)
+  {
+    // maps the reference element of e into the one of its parent
+    const int parent = cft.embeddings[e].parent;
+    const Geometry::Type geom = fine->GetMesh()->GetElementBaseGeometry(e);
+    T.SetIdentityTransformation(geom);
+    T.GetPointMat() = cft.point_matrices[geom](cft.embeddings[e].matrix);
+
+    const FiniteElement *cfe = coarse->GetFE(parent);
+    const IntegrationRule &nodes = fine->GetFE(e)->GetNodes();
+    coarse->GetElementDofs(parent, cdofs);
+    fine->GetElementDofs(e, fdofs);
+    shape.SetSize(cfe->GetDof());
+    for (int k = 0; k < nodes.GetNPoints(); k++)
+    {
+      T.Transform(nodes.IntPoint(k), xc);
+      ipc.Set(xc.GetData(), xc.Size());
+      cfe->CalcShape(ipc, shape);
+      for (int j = 0; j < cdofs.Size(); j++)
+        if (fabs(shape(j)) > 1e-12)
+          P->Set(fdofs[k], cdofs[j], shape(j));
+    }
+  }
+  P->Finalize();
+  return P;
+}
+
+
+// LG_Multigrid implementation
+LG_Multigrid::LG_Multigrid()
+   : Solver(0, false)
+{
+}
+
+LG_Multigrid::~LG_Multigrid()
+{
+  for (int l = 0; l < GetNumLevels(); l++)
+  {
+    delete P[l];
+    delete ess[l];
+    delete smoothers[l];
+  }
+}
+
+void LG_Multigrid::AddLevel(
+    const SparseMatrix *A_l,
+    const Array<int> &ess_tdof_list,
+    SparseMatrix *P_l,
+    Solver *S)
+{
+  MFEM_VERIFY((GetNumLevels() == 0) == (P_l == NULL),
+      "all levels but the finest need a prolongation");
+  if (P_l)
+  {
+    MFEM_VERIFY(P_l->Height() == A.Last()->Height() &&
+        P_l->Width() == A_l->Height(), "prolongation size mismatch");
+    P.Last() = P_l;
+  }
+  if (GetNumLevels() == 0)
+  {
+    height = width = A_l->Height();
+  }
+
+  if (!S)
+  {
+    S = new GSSmoother(*A_l, 0, 1);
+    S->iterative_mode = true;
+  }
+
+  A.Append(A_l);
+  P.Append(NULL);
+  ess.Append(new Array<int>(ess_tdof_list));
+  smoothers.Append(S);
+  res.resize(GetNumLevels());
+  rhs.resize(GetNumLevels());
+  cor.resize(GetNumLevels());
+  res.back().SetSize(A_l->Height());
+  rhs.back().SetSize(A_l->Height());
+  cor.back().SetSize(A_l->Height());
+}
+
+void LG_Multigrid::SetupCoarseSolve()
+{
+  const SparseMatrix &A_c = *A.Last();
+#ifdef MFEM_USE_SUITESPARSE
+  coarse_solver.SetOperator(A_c);
+#else
+  coarse_prec.SetOperator(A_c);
+  coarse_solver.SetRelTol(1e-10);
+  coarse_solver.SetAbsTol(0.0);
+  coarse_solver.SetMaxIter(1000);
+  coarse_solver.SetPrintLevel(-1);
+  coarse_solver.SetPreconditioner(coarse_prec);
+  coarse_solver.SetOperator(A_c);
+  // start from zero, not from the correction of the previous cycle, so the
+  // V-cycle stays a fixed linear operator (as a PCG preconditioner must)
+  coarse_solver.iterative_mode = false;
+#endif
+}
+
+void LG_Multigrid::Cycle(int l, const Vector &b, Vector &x) const
+{
+  if (l == GetNumLevels() - 1)
+  {
+    coarse_solver.Mult(b, x);
+    return;
+  }
+
+  // pre-smoothing
+  x = 0.0;
+  smoothers[l]->Mult(b, x);
+
+  // coarse correction
+  res[l] = b;
+  A[l]->AddMult(x, res[l], -1.0);
+  P[l]->MultTranspose(res[l], rhs[l+1]);
+  const Array<int> &ess_c = *ess[l+1];
+  for (int i = 0; i < ess_c.Size(); i++)
+    rhs[l+1](ess_c[i]) = 0.0;
+  Cycle(l + 1, rhs[l+1], cor[l+1]);
+  P[l]->AddMult(cor[l+1], x);
+
+  // post-smoothing
+  smoothers[l]->Mult(b, x);
+}
+
+void LG_Multigrid::Mult(const Vector &b, Vector &x) const
+{
+  MFEM_VERIFY(GetNumLevels() > 0, "empty hierarchy");
+  if (GetNumLevels() == 1)
+  {
+    coarse_solver.Mult(b, x);
+    return;
+  }
+  Cycle(0, b, x);
+}
+
+
+// LG_PMultigrid implementation
+LG_PMultigrid::LG_PMultigrid(
+    FiniteElementSpace *fes,
+    const SparseMatrix &A_fine,
+    const Array<int> &ess_bdr,
+    Coefficient &Q)
+{
+  const LG_FECollection *fec =
+    dynamic_cast<const LG_FECollection*>(fes->FEColl());
+  MFEM_VERIFY(fec, "LG_PMultigrid requires an LG_FECollection space");
+  Mesh *mesh = fes->GetMesh();
+  const int p = fes->GetFE(0)->GetOrder();
+
+  Array<int> ess_tdof_list;
+  fes->GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+  AddLevel(&A_fine, ess_tdof_list, NULL);
+
+  FiniteElementSpace *fine = fes;
+  for (int q = p - 1; q >= 1; q--)
+  {
+    LG_FECollection *fec_q =
+      new LG_FECollection(q, mesh->Dimension(), fec->GetBasisType());
+    FiniteElementSpace *fes_q = new FiniteElementSpace(mesh, fec_q);
+    fes_q->GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+
+    BilinearForm *a_q = new BilinearForm(fes_q);
+    a_q->AddDomainIntegrator(new LG_DiffusionIntegrator(Q, fec_q));
+    a_q->Assemble();
+    OperatorPtr A_q;
+    a_q->FormSystemMatrix(ess_tdof_list, A_q);
+
+    fecs.Append(fec_q);
+    spaces.Append(fes_q);
+    forms.Append(a_q);
+    AddLevel(&a_q->SpMat(), ess_tdof_list, LG_OrderProlongation(fes_q, fine));
+    fine = fes_q;
+  }
+  SetupCoarseSolve();
+}
+
+LG_PMultigrid::~LG_PMultigrid()
+{
+  // the levels reference the matrices of the forms
+  for (int l = 0; l < forms.Size(); l++)
+  {
+    delete forms[l];
+    delete spaces[l];
+    delete fecs[l];
+  }
+}
+
+
+// LG_GMultigrid implementation
+LG_GMultigrid::LG_GMultigrid(
+    FiniteElementSpace *fes,
+    const SparseMatrix &A_fine,
+    const Array<int> &ess_bdr,
+    Coefficient &Q,
+    const Mesh &coarse_mesh,
+    const int nref,
+    const int cheb_order)
+{
+  const LG_FECollection *fec =
+    dynamic_cast<const LG_FECollection*>(fes->FEColl());
+  MFEM_VERIFY(fec, "LG_GMultigrid requires an LG_FECollection space");
+  MFEM_VERIFY(nref >= 0, "negative number of refinements");
+
+  // the level spaces, coarse to fine; the refinement transformations are
+  // only known right after a refinement, so every prolongation is built on a
+  // refined copy of the level mesh, which then becomes the next level mesh.
+  // The last copy matches the mesh of fes (same element and dof numbering)
+  // and only lives for its transformations.
+  Array<Array<int>*> ess_l(nref);
+  Array<SparseMatrix*> P_l(nref);
+  Array<int> ess_tdof_list;
+  meshes.Append(new Mesh(coarse_mesh));
+  for (int l = 0; l < nref; l++)
+  {
+    FiniteElementSpace *fes_l = new FiniteElementSpace(meshes[l], fec);
+    fes_l->GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+    BilinearForm *a_l = new BilinearForm(fes_l);
+    a_l->AddDomainIntegrator(new LG_DiffusionIntegrator(Q, fec));
+    a_l->Assemble();
+    OperatorPtr A_l;
+    a_l->FormSystemMatrix(ess_tdof_list, A_l);
+    spaces.Append(fes_l);
+    forms.Append(a_l);
+    ess_l[l] = new Array<int>(ess_tdof_list);
+
+    Mesh *refined = new Mesh(*meshes[l]);
+    refined->UniformRefinement();
+    FiniteElementSpace fes_r(refined, fec);
+    P_l[l] = LG_RefinementProlongation(fes_l, &fes_r,
+        refined->GetRefinementTransforms());
+    if (l < nref - 1)
+    {
+      meshes.Append(refined);
+      continue;
+    }
+    MFEM_VERIFY(refined->GetNE() == fes->GetNE() &&
+        fes_r.GetVSize() == fes->GetVSize(),
+        "the mesh of fes is not coarse_mesh refined nref times");
+    delete refined;
+  }
+
+  // finest level first
+  Vector diag;
+  fes->GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+  A_fine.GetDiag(diag);
+  Solver *S = new LG_ChebyshevSmoother(A_fine, diag, ess_tdof_list, cheb_order);
+  S->iterative_mode = true;
+  AddLevel(&A_fine, ess_tdof_list, NULL, S);
+  for (int l = nref - 1; l >= 0; l--)
+  {
+    const SparseMatrix &A_c = forms[l]->SpMat();
+    A_c.GetDiag(diag);
+    S = new LG_ChebyshevSmoother(A_c, diag, *ess_l[l], cheb_order);
+    S->iterative_mode = true;
+    AddLevel(&A_c, *ess_l[l], P_l[l], S);
+    delete ess_l[l];
+  }
+  SetupCoarseSolve();
+}
+
+LG_GMultigrid::~LG_GMultigrid()
+{
+  // the levels reference the matrices of the forms
+  for (int l = 0; l < forms.Size(); l++)
+  {
+    delete forms[l];
+    delete spaces[l];
+  }
+  for (int l = 0; l < meshes.Size(); l++)
+  {
+    delete meshes[l];
+  }
+}
+
+#endif
@@ -0,0 +1,428 @@
+#ifndef LAGRANGE_OPERATORS
+#define LAGRANGE_OPERATORS
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Matrix-free (partially assembled) diffusion operator (Q grad u, grad v)
+/// on a FiniteElementSpace built on an LG_FECollection.
+///
+/// Only the geometric factors Q w_q adj(J) adj(J)^T / det(J) are stored, one
+/// symmetric dim x dim matrix per quadrature point. Mult applies the operator
+/// element by element: quads and hexes use the sum-factorized kernels of
+/// LG_QuadrilateralElement and LG_HexahedronElement, other geometries the
+/// cached LG shape gradients.
+class LG_PADiffusionOperator : public Operator
+{
+protected:
+  const FiniteElementSpace *fes;
+  const LG_FECollection *fec;
+  int ne, dim, nsym;
+  Array<int> elem_offsets, elem_dofs;  // element to dof table
+  Array<int> geo_offsets;              // first geometric factor of element
+  Vector geo;                          // nsym factors per quadrature point
+  LG_TensorMaps maps;                  // 1D maps for the quad/hex kernels
+  // gradient tables of the geometries in the mesh, fetched once so that
+  // Mult and AssembleDiagonal do not go through the locked cache
+  const LG_ShapeTable *tables[Geometry::NumGeom];
+
+  /// Quadrature rule used for the elements of geometry GeomType
+  const IntegrationRule &GetRule(Geometry::Type GeomType) const;
+
+public:
+  LG_PADiffusionOperator(
+      const FiniteElementSpace *fes,
+      const LG_FECollection *fec,
+      Coefficient &Q);
+
+  virtual void Mult(const Vector &x, Vector &y) const;
+  virtual void MultTranspose(const Vector &x, Vector &y) const
+  { Mult(x, y); }
+
+  /// Diagonal of the operator, e.g. for Jacobi or Chebyshev smoothing
+  void AssembleDiagonal(Vector &diag) const;
+
+  /// Bytes used by the geometric factors and the element to dof table
+  long GetMemoryFootprint() const;
+};
+
+/// Jacobi preconditioner from an operator diagonal; the essential dofs get a
+/// unit diagonal, matching ConstrainedOperator
+class LG_JacobiSmoother : public Solver
+{
+protected:
+  Vector dinv;
+  double damping;
+
+public:
+  LG_JacobiSmoother(
+      const Vector &diag,
+      const Array<int> &ess_tdof_list,
+      const double damping = 1.0);
+
+  virtual void SetOperator(const Operator &op) { }
+  virtual void Mult(const Vector &x, Vector &y) const;
+};
+
+/// Chebyshev smoother of the given order for the Jacobi-scaled operator
+/// D^{-1} A, targeting the eigenvalues in [0.3, 1.2] times the largest one,
+/// which is estimated by power iteration. The essential dofs get a unit
+/// diagonal, as in LG_JacobiSmoother. The iteration starts from y when
+/// iterative_mode is set, which is how multigrid uses it.
+class LG_ChebyshevSmoother : public Solver
+{
+protected:
+  const Operator &A;
+  Vector dinv;
+  int order;
+  double theta, delta;  // center and half width of the target interval
+  mutable Vector r, d, z;
+
+public:
+  LG_ChebyshevSmoother(
+      const Operator &A,
+      const Vector &diag,
+      const Array<int> &ess_tdof_list,
+      const int order = 3,
+      const int power_iterations = 20);
+
+  /// Largest eigenvalue estimate of D^{-1} A
+  double GetMaxEigenvalue() const
+  { return (theta + delta)/1.2; }
+
+  virtual void SetOperator(const Operator &op) { }
+  virtual void Mult(const Vector &x, Vector &y) const;
+};
+
+
+// LG_PADiffusionOperator implementation
+LG_PADiffusionOperator::LG_PADiffusionOperator(
+    const FiniteElementSpace *fes_,
+    const LG_FECollection *fec_,
+    Coefficient &Q)
+   : Operator(fes_->GetVSize()), fes(fes_), fec(fec_)
+{
+  Mesh *mesh = fes->GetMesh();
+  MFEM_VERIFY(fes->GetVDim() == 1, "scalar spaces only");
+  MFEM_VERIFY(fes->GetConformingProlongation() == NULL,
+      "LG_PADiffusionOperator requires a conforming space");
+
+  ne = mesh->GetNE();
+  dim = mesh->Dimension();
+  nsym = (dim*(dim+1))/2;
+  MFEM_VERIFY(mesh->SpaceDimension() == dim, "surface meshes are not supported");
+
+  // element to dof table
+  Array<int> dofs;
+  elem_offsets.SetSize(ne + 1);
+  elem_offsets[0] = 0;
+  for (int e = 0; e < ne; e++)
+  {
+    elem_offsets[e+1] = elem_offsets[e] + fes->GetFE(e)->GetDof();
+  }
+  elem_dofs.SetSize(elem_offsets[ne]);
+  for (int e = 0; e < ne; e++)
+  {
+    fes->GetElementDofs(e, dofs);
+    for (int i = 0; i < dofs.Size(); i++)
+      elem_dofs[elem_offsets[e] + i] = dofs[i];
+  }
+
+  // geometric factors and shape tables
+  for (int g = 0; g < Geometry::NumGeom; g++)
+    tables[g] = NULL;
+  geo_offsets.SetSize(ne + 1);
+  geo_offsets[0] = 0;
+  for (int e = 0; e < ne; e++)
+  {
+    const Geometry::Type geom = mesh->GetElementBaseGeometry(e);
+    const IntegrationRule &ir = GetRule(geom);
+    geo_offsets[e+1] = geo_offsets[e] + nsym*ir.GetNPoints();
+    if (!tables[geom])
+      tables[geom] = &fec->GetShapeTable(geom, ir);
+  }
+  geo.SetSize(geo_offsets[ne]);
+
+  DenseMatrix D(dim);
+  for (int e = 0; e < ne; e++)
+  {
+    const IntegrationRule &ir = GetRule(mesh->GetElementBaseGeometry(e));
+    ElementTransformation *T = mesh->GetElementTransformation(e);
+    double *g = geo.GetData() + geo_offsets[e];
+    for (int q = 0; q < ir.GetNPoints(); q++)
+    {
+      const IntegrationPoint &ip = ir.IntPoint(q);
+      T->SetIntPoint(&ip);
+      const double w = ip.weight * Q.Eval(*T, ip) / T->Weight();
+      MultAAt(T->AdjugateJacobian(), D);
+      for (int i = 0; i < dim; i++)
+        for (int j = i; j < dim; j++)
+          *(g++) = w * D(i,j);
+    }
+  }
+
+  // 1D maps of the sum-factorized quad/hex kernels
+  const LG_QuadrilateralElement *quad = dynamic_cast<const LG_QuadrilateralElement*>(
+      fec->FiniteElementForGeometry(Geometry::SQUARE));
+  const LG_HexahedronElement *hex = dynamic_cast<const LG_HexahedronElement*>(
+      fec->FiniteElementForGeometry(Geometry::CUBE));
+  if (dim == 2 && quad)
+  {
+    const int order = 2*quad->GetOrder() + dim - 1;
+    quad->GetTensorMaps(IntRules.Get(Geometry::SEGMENT, order), maps);
+    MFEM_VERIFY(maps.nqpt1d*maps.nqpt1d ==
+        GetRule(Geometry::SQUARE).GetNPoints(), "square rule is not tensor");
+  }
+  else if (dim == 3 && hex)
+  {
+    const int order = 2*hex->GetOrder() + dim - 1;
+    hex->GetTensorMaps(IntRules.Get(Geometry::SEGMENT, order), maps);
+    MFEM_VERIFY(maps.nqpt1d*maps.nqpt1d*maps.nqpt1d ==
+        GetRule(Geometry::CUBE).GetNPoints(), "cube rule is not tensor");
+  }
+}
+
+const IntegrationRule &LG_PADiffusionOperator::GetRule(
+    Geometry::Type GeomType) const
+{
+  // same orders as LG_DiffusionIntegrator for affine elements; rules from
+  // IntRules outlive everything, as the shape table cache requires
+  const FiniteElement *fe = fec->FiniteElementForGeometry(GeomType);
+  const int p = fe->GetOrder();
+  const int order = (fe->Space() == FunctionSpace::Pk) ?
+                    2*p - 2 : 2*p + fe->GetDim() - 1;
+  return IntRules.Get(GeomType, order);
+}
+
+void LG_PADiffusionOperator::Mult(const Vector &x, Vector &y) const
+{
+  const Mesh *mesh = fes->GetMesh();
+  double xe[LG_MAX_DOF], ye[LG_MAX_DOF];
+  // reference gradients at the tensor points (too big for the stack in 3D)
+  int ntensor = 1;
+  for (int d = 0; d < dim; d++)
+    ntensor *= maps.nqpt1d;
+  Vector duq_(dim*ntensor);
+  double *duq = duq_.GetData();
+
+  y.SetSize(height);
+  y = 0.0;
+  for (int e = 0; e < ne; e++)
+  {
+    const Geometry::Type geom = mesh->GetElementBaseGeometry(e);
+    const int *dofs = elem_dofs.GetData() + elem_offsets[e];
+    const int nd = elem_offsets[e+1] - elem_offsets[e];
+    const double *g = geo.GetData() + geo_offsets[e];
+
+    for (int i = 0; i < nd; i++)
+    {
+      xe[i] = x(dofs[i]);
+      ye[i] = 0.0;
+    }
+
+    if (geom == Geometry::SQUARE && maps.nqpt1d > 0)
+    {
+      // sum-factorized: O(p^3) per element
+      const LG_QuadrilateralElement *fe =
+        static_cast<const LG_QuadrilateralElement*>(
+            fec->FiniteElementForGeometry(geom));
+      const int nq = maps.nqpt1d*maps.nqpt1d;
+      fe->InterpolateGrad(maps, xe, duq);
+      for (int q = 0; q < nq; q++, g += 3)
+      {
+        const double gx = duq[q], gy = duq[q + nq];
+        duq[q] = g[0]*gx + g[1]*gy;
+        duq[q + nq] = g[1]*gx + g[2]*gy;
+      }
+      fe->AddInterpolateGradTranspose(maps, duq, ye);
+    }
+    else if (geom == Geometry::CUBE && maps.nqpt1d > 0)
+    {
+      // sum-factorized: O(p^4) per element
+      const LG_HexahedronElement *fe =
+        static_cast<const LG_HexahedronElement*>(
+            fec->FiniteElementForGeometry(geom));
+      const int nq = ntensor;
+      fe->InterpolateGrad(maps, xe, duq);
+      for (int q = 0; q < nq; q++, g += 6)
+      {
+        const double gx = duq[q], gy = duq[q + nq], gz = duq[q + 2*nq];
+        duq[q] = g[0]*gx + g[1]*gy + g[2]*gz;
+        duq[q + nq] = g[1]*gx + g[3]*gy + g[4]*gz;
+        duq[q + 2*nq] = g[2]*gx + g[4]*gy + g[5]*gz;
+      }
+      fe->AddInterpolateGradTranspose(maps, duq, ye);
+    }
+    else
+    {
+      // cached (points x dofs x dim) gradient table
+      const LG_ShapeTable &table = *tables[geom];
+      double grad[3], flux[3];
+      for (int q = 0; q < table.GetNPoints(); q++, g += nsym)
+      {
+        const double *G = table.GetDShape(q);
+        for (int d = 0; d < dim; d++)
+        {
+          grad[d] = 0.0;
+          for (int i = 0; i < nd; i++)
+            grad[d] += G[i + d*nd]*xe[i];
+        }
+        for (int d = 0; d < dim; d++)
+        {
+          flux[d] = 0.0;
+          for (int c = 0; c < dim; c++)
+          {
+            // packed upper triangle of the symmetric factor
+            const int r = min(c, d), s = max(c, d);
+            flux[d] += g[r*dim - (r*(r-1))/2 + (s - r)]*grad[c];
+          }
+        }
+        for (int d = 0; d < dim; d++)
+          for (int i = 0; i < nd; i++)
+            ye[i] += G[i + d*nd]*flux[d];
+      }
+    }
+
+    for (int i = 0; i < nd; i++)
+    {
+      y(dofs[i]) += ye[i];
+    }
+  }
+}
+
+void LG_PADiffusionOperator::AssembleDiagonal(Vector &diag) const
+{
+  const Mesh *mesh = fes->GetMesh();
+
+  diag.SetSize(height);
+  diag = 0.0;
+  for (int e = 0; e < ne; e++)
+  {
+    const Geometry::Type geom = mesh->GetElementBaseGeometry(e);
+    const int *dofs = elem_dofs.GetData() + elem_offsets[e];
+    const int nd = elem_offsets[e+1] - elem_offsets[e];
+    const double *g = geo.GetData() + geo_offsets[e];
+    const LG_ShapeTable &table = *tables[geom];
+
+    for (int q = 0; q < table.GetNPoints(); q++, g += nsym)
+    {
+      const double *G = table.GetDShape(q);
+      for (int i = 0; i < nd; i++)
+      {
+        // G_i^T D G_i with D stored as a packed upper triangle
+        double s = 0.0;
+        for (int d = 0, k = 0; d < dim; d++)
+          for (int c = d; c < dim; c++, k++)
+            s += ((c == d) ? 1.0 : 2.0)*g[k]*G[i + d*nd]*G[i + c*nd];
+        diag(dofs[i]) += s;
+      }
+    }
+  }
+}
+
+long LG_PADiffusionOperator::GetMemoryFootprint() const
+{
+  return sizeof(double)*long(geo.Size()) +
+         sizeof(int)*long(elem_dofs.Size() + elem_offsets.Size() +
+                          geo_offsets.Size());
+}
+
+
+// LG_JacobiSmoother implementation
+LG_JacobiSmoother::LG_JacobiSmoother(
+    const Vector &diag,
+    const Array<int> &ess_tdof_list,
+    const double damping_)
+   : Solver(diag.Size()), dinv(diag.Size()), damping(damping_)
+{
+  for (int i = 0; i < diag.Size(); i++)
+  {
+    MFEM_VERIFY(diag(i) != 0.0, "zero on the diagonal at row " << i);
+    dinv(i) = 1.0/diag(i);
+  }
+  for (int i = 0; i < ess_tdof_list.Size(); i++)
+  {
+    dinv(ess_tdof_list[i]) = 1.0;
+  }
+}
+
+void LG_JacobiSmoother::Mult(const Vector &x, Vector &y) const
+{
+  y.SetSize(x.Size());
+  for (int i = 0; i < x.Size(); i++)
+  {
+    y(i) = damping*dinv(i)*x(i);
+  }
+}
+
+
+// LG_ChebyshevSmoother implementation
+LG_ChebyshevSmoother::LG_ChebyshevSmoother(
+    const Operator &A_,
+    const Vector &diag,
+    const Array<int> &ess_tdof_list,
+    const int order_,
+    const int power_iterations)
+   : Solver(A_.Height()), A(A_), dinv(diag.Size()), order(order_),
+     r(diag.Size()), d(diag.Size()), z(diag.Size())
+{
+  MFEM_VERIFY(order >= 1, "the Chebyshev order must be at least 1");
+  for (int i = 0; i < diag.Size(); i++)
+  {
+    MFEM_VERIFY(diag(i) != 0.0, "zero on the diagonal at row " << i);
+    dinv(i) = 1.0/diag(i);
+  }
+  for (int i = 0; i < ess_tdof_list.Size(); i++)
+  {
+    dinv(ess_tdof_list[i]) = 1.0;
+  }
+
+  // power iteration for the largest eigenvalue of D^{-1} A
+  double lambda = 1.0;
+  d.Randomize(1);
+  d *= 1.0/d.Norml2();
+  for (int k = 0; k < power_iterations; k++)
+  {
+    A.Mult(d, z);
+    for (int i = 0; i < z.Size(); i++)
+      z(i) *= dinv(i);
+    lambda = z.Norml2();
+    MFEM_VERIFY(lambda > 0.0, "the operator vanishes on the start vector");
+    d.Set(1.0/lambda, z);
+  }
+
+  theta = 0.5*(1.2 + 0.3)*lambda;
+  delta = 0.5*(1.2 - 0.3)*lambda;
+}
+
+void LG_ChebyshevSmoother::Mult(const Vector &x, Vector &y) const
+{
+  y.SetSize(x.Size());
+  if (!iterative_mode)
+    y = 0.0;
+
+  // Chebyshev iteration on the residual equation D^{-1} A e = D^{-1} r
+  const double sigma = theta/delta;
+  double rho = 1.0/sigma;
+  A.Mult(y, r);
+  r.Neg();
+  r += x;
+  for (int i = 0; i < r.Size(); i++)
+    d(i) = dinv(i)*r(i)/theta;
+  for (int k = 0; k < order; k++)
+  {
+    y += d;
+    if (k == order - 1)
+      break;
+    A.Mult(d, z);
+    r -= z;
+    const double rho_new = 1.0/(2.0*sigma - rho);
+    for (int i = 0; i < r.Size(); i++)
+      d(i) = rho_new*rho*d(i) + 2.0*rho_new/delta*dinv(i)*r(i);
+    rho = rho_new;
+  }
+}
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef LAGRANGE_PERSISTENT_SOLVER
+#define LAGRANGE_PERSISTENT_SOLVER
+
+#include <vector>
+#include <algorithm>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeIntegrators.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Solver for -div(kappa Q grad u) = f on a conforming scalar space, with
+/// kappa constant on every element (1 initially), that is set up once and
+/// reused across solves on three levels:
+///  - Solve takes a new right-hand side and new Dirichlet values and keeps
+///    the matrix and the preconditioner;
+///  - SetElementCoefficients changes kappa on some elements and adds the
+///    change of their element matrices to the matrix in place;
+///  - Reassemble recomputes all the values into the kept sparsity pattern.
+/// The matrix position of every element matrix entry is found once in the
+/// constructor, so updates neither search nor allocate. The essential dofs
+/// are eliminated as in FormLinearSystem (unit diagonal) and their original
+/// rows are kept to lift the Dirichlet values into the right-hand side. The
+/// GSSmoother reads the matrix values at every application and needs no
+/// refresh after an update.
+class LG_PersistentSolver
+{
+protected:
+  FiniteElementSpace *fes;
+  LG_DiffusionIntegrator integ;
+  Vector kappa;
+  SparseMatrix *A;
+  Array<int> ess_tdof_list;
+  // index of a dof in ess_tdof_list or -1, and the original matrix rows of
+  // the essential dofs in the CSR order of A
+  std::vector<int> ess_index, ess_start;
+  std::vector<double> ess_vals;
+  // where entry k of the element matrix of e goes: a position in A (>= 0),
+  // -2 - (a position in ess_vals), or nowhere (-1, essential columns)
+  std::vector<int> pos_offsets, pos;
+  GSSmoother *M;
+  CGSolver cg;
+  mutable DenseMatrix elmat;
+
+  // add s times the element matrix of element e (with kappa = 1)
+  void AddElementMatrix(const int e, const double s);
+  // unit diagonal on the essential rows
+  void SetEssentialDiagonal();
+
+public:
+  LG_PersistentSolver(
+      FiniteElementSpace *fes,
+      const LG_FECollection *fec,
+      Coefficient &Q,
+      const Array<int> &ess_tdof_list);
+  ~LG_PersistentSolver();
+
+  void SetRelTol(double rtol)
+  { cg.SetRelTol(rtol); }
+  void SetMaxIter(int max_it)
+  { cg.SetMaxIter(max_it); }
+
+  const SparseMatrix &GetMatrix() const
+  { return *A; }
+  const Vector &GetElementCoefficients() const
+  { return kappa; }
+  int GetNumIterations() const
+  { return cg.GetNumIterations(); }
+
+  /// kappa(elems[i]) = values(i), updating the matrix in place
+  void SetElementCoefficients(const Array<int> &elems, const Vector &values);
+
+  /// Recompute all the matrix values for the current kappa (and Q)
+  void Reassemble();
+
+  /// Solve with the assembled linear form b. On input x holds the
+  /// Dirichlet values on the essential dofs and the initial guess elsewhere.
+  void Solve(const Vector &b, Vector &x);
+};
+
+
+// LG_PersistentSolver implementation
+LG_PersistentSolver::LG_PersistentSolver(
+    FiniteElementSpace *fes_,
+    const LG_FECollection *fec,
+    Coefficient &Q,
+    const Array<int> &ess_tdof_list_)
+   : fes(fes_), integ(Q, fec), kappa(fes_->GetNE()), A(NULL), M(NULL)
+{
+  MFEM_VERIFY(fes->GetVDim() == 1, "scalar spaces only");
+  MFEM_VERIFY(fes->GetConformingProlongation() == NULL,
+      "LG_PersistentSolver requires a conforming space");
+  const int ndofs = fes->GetVSize();
+  ess_tdof_list_.Copy(ess_tdof_list);
+  kappa = 1.0;
+
+  // the sparsity pattern and the kappa = 1 values
+  BilinearForm a(fes);
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(Q, fec));
+  a.Assemble();
+  a.Finalize();
+  A = a.LoseMat();
+  A->SortColumnIndices();
+  const int *I = A->GetI();
+  const int *J = A->GetJ();
+  double *vals = A->GetData();
+
+  // keep the essential rows and eliminate their rows and columns
+  ess_index.assign(ndofs, -1);
+  for (int k = 0; k < ess_tdof_list.Size(); k++)
+    ess_index[ess_tdof_list[k]] = k;
+  ess_start.resize(ess_tdof_list.Size() + 1);
+  ess_start[0] = 0;
+  for (int k = 0; k < ess_tdof_list.Size(); k++)
+  {
+    const int i = ess_tdof_list[k];
+    ess_start[k+1] = ess_start[k] + I[i+1] - I[i];
+    ess_vals.insert(ess_vals.end(), vals + I[i], vals + I[i+1]);
+  }
+  for (int i = 0; i < ndofs; i++)
+    for (int m = I[i]; m < I[i+1]; m++)
+      if (ess_index[i] >= 0 || ess_index[J[m]] >= 0)
+        vals[m] = 0.0;
+  SetEssentialDiagonal();
+
+  // positions of the element matrix entries
+  Array<int> vdofs;
+  pos_offsets.resize(fes->GetNE() + 1);
+  pos_offsets[0] = 0;
+  for (int e = 0; e < fes->GetNE(); e++)
+  {
+    fes->GetElementVDofs(e, vdofs);
+    const int nd = vdofs.Size();
+    pos_offsets[e+1] = pos_offsets[e] + nd*nd;
+    for (int b = 0; b < nd; b++)
+      for (int a = 0; a < nd; a++)
+      {
+        const int i = vdofs[a], j = vdofs[b];
+        const int m = std::lower_bound(J + I[i], J + I[i+1], j) - J;
+        MFEM_VERIFY(m < I[i+1] && J[m] == j, "entry not in the pattern");
+        if (ess_index[i] >= 0)
+          pos.push_back(-2 - (ess_start[ess_index[i]] + m - I[i]));
+        else if (ess_index[j] >= 0)
+          pos.push_back(-1);
+        else
+          pos.push_back(m);
+      }
+  }
+
+  M = new GSSmoother(*A);
+  cg.SetRelTol(1e-12);
+  cg.SetAbsTol(0.0);
+  cg.SetMaxIter(5000);
+  cg.SetPrintLevel(-1);
+  cg.SetPreconditioner(*M);
+  cg.SetOperator(*A);
+  cg.iterative_mode = true;
+}
+
+LG_PersistentSolver::~LG_PersistentSolver()
+{
+  delete M;
+  delete A;
+}
+
+void LG_PersistentSolver::AddElementMatrix(const int e, const double s)
+{
+  const FiniteElement *fe = fes->GetFE(e);
+  ElementTransformation *T = fes->GetElementTransformation(e);
+  integ.AssembleElementMatrix(*fe, *T, elmat);
+
+  const double *el = elmat.Data();
+  const int *p = pos.data() + pos_offsets[e];
+  const int n = pos_offsets[e+1] - pos_offsets[e];
+  double *vals = A->GetData();
+  for (int k = 0; k < n; k++)
+  {
+    if (p[k] >= 0)
+      vals[p[k]] += s*el[k];
+    else if (p[k] <= -2)
+      ess_vals[-2 - p[k]] += s*el[k];
+  }
+}
+
+void LG_PersistentSolver::SetEssentialDiagonal()
+{
+  const int *I = A->GetI();
+  const int *J = A->GetJ();
+  double *vals = A->GetData();
+  for (int k = 0; k < ess_tdof_list.Size(); k++)
+  {
+    const int i = ess_tdof_list[k];
+    const int m = std::lower_bound(J + I[i], J + I[i+1], i) - J;
+    vals[m] = 1.0;
+  }
+}
+
+void LG_PersistentSolver::SetElementCoefficients(
+    const Array<int> &elems,
+    const Vector &values)
+{
+  MFEM_VERIFY(elems.Size() == values.Size(), "size mismatch");
+  for (int i = 0; i < elems.Size(); i++)
+  {
+    const int e = elems[i];
+    AddElementMatrix(e, values(i) - kappa(e));
+    kappa(e) = values(i);
+  }
+}
+
+void LG_PersistentSolver::Reassemble()
+{
+  *A = 0.0;
+  std::fill(ess_vals.begin(), ess_vals.end(), 0.0);
+  for (int e = 0; e < fes->GetNE(); e++)
+    AddElementMatrix(e, kappa(e));
+  SetEssentialDiagonal();
+}
+
+void LG_PersistentSolver::Solve(const Vector &b, Vector &x)
+{
+  const int *I = A->GetI();
+  const int *J = A->GetJ();
+
+  // B = b - K(:, ess) x_ess on the free dofs (K(j, e) = K(e, j)) and the
+  // Dirichlet values on the essential ones
+  Vector B(b);
+  for (int k = 0; k < ess_tdof_list.Size(); k++)
+  {
+    const int e = ess_tdof_list[k];
+    const double xe = x(e);
+    if (xe == 0.0)
+      continue;
+    for (int m = I[e]; m < I[e+1]; m++)
+      if (ess_index[J[m]] < 0)
+        B(J[m]) -= ess_vals[ess_start[k] + m - I[e]]*xe;
+  }
+  for (int k = 0; k < ess_tdof_list.Size(); k++)
+    B(ess_tdof_list[k]) = x(ess_tdof_list[k]);
+
+  cg.Mult(B, x);
+}
+
+#endif
@@ -0,0 +1,586 @@
+#ifndef LAGRANGE_POINT_LOCATOR
+#define LAGRANGE_POINT_LOCATOR
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include <cstring>
+
+#include "LagrangeElements.hpp"
+#include "LagrangeAssembly.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Locates batches of physical points in a mesh and evaluates GridFunctions
+/// at them through the shapes of their space.
+///
+/// The bounding boxes of the elements are binned in a uniform grid over the
+/// mesh bounding box with about one element per bin, so a point is only
+/// tested against the elements whose boxes overlap its bin. Straight
+/// simplices (no mesh nodes, sdim == dim) store x0 and J^{-1} of their
+/// affine map and are inverted by one small matrix-vector product; all the
+/// other elements go through a Newton InverseElementTransformation. The
+/// points of a batch are split among nthreads threads, each with its own
+/// element transformation. On curved meshes (mesh->GetNodes() set) the
+/// element transformations read the shared nodal GridFunction and are not
+/// thread safe, so Locate and LocateLinear run on one thread there;
+/// Evaluate uses nthreads on any mesh.
+class LG_PointLocator
+{
+protected:
+  Mesh *mesh;
+  int dim, sdim, ne, nthreads;
+  double bb_min[3], bin_inv[3];
+  int nbins[3];
+  Array<int> bin_offsets, bin_elems;   // elements of every bin (CSR)
+  std::vector<double> boxes;           // min and max corner per element
+  std::vector<double> affine;          // x0 and J^{-1} per element
+
+  // bin of x, -1 outside the mesh bounding box
+  int GetBin(const double *x) const;
+  // threads of the Locate calls: one on curved meshes, see above
+  int GetLocateThreads() const
+  { return mesh->GetNodes() ? 1 : nthreads; }
+  // reference coordinates of x in element e, true when inside
+  bool InElement(
+      const int e,
+      const double *x,
+      IsoparametricTransformation &T,
+      IntegrationPoint &ip) const;
+
+public:
+  LG_PointLocator(Mesh *mesh, const int nthreads = 1);
+
+  void SetNumThreads(const int n)
+  { nthreads = n; }
+  int GetNumBins() const
+  { return bin_offsets.Size() - 1; }
+
+  /// Find the element and the reference point of every column of pts
+  /// (sdim x npts); elems[i] = -1 for the points outside the mesh. Returns
+  /// the number of points found.
+  int Locate(
+      const DenseMatrix &pts,
+      Array<int> &elems,
+      Array<IntegrationPoint> &ips) const;
+
+  /// Locate by trying all the elements in turn, for comparison
+  int LocateLinear(
+      const DenseMatrix &pts,
+      Array<int> &elems,
+      Array<IntegrationPoint> &ips) const;
+
+  /// vals(c, i) = component c of u at point i (zero outside the mesh)
+  void Evaluate(
+      const GridFunction &u,
+      const Array<int> &elems,
+      const Array<IntegrationPoint> &ips,
+      DenseMatrix &vals) const;
+};
+
+/// Sparse interpolation matrix P of the located points: (P u)(c + i*vdim)
+/// is component c of u at point i, as LG_PointLocator::Evaluate returns it
+/// in vals.Data(). The rows of the points outside the mesh are empty.
+SparseMatrix *LG_InterpolationMatrix(
+    const FiniteElementSpace &fes,
+    const Array<int> &elems,
+    const Array<IntegrationPoint> &ips);
+
+/// Key of an interpolation matrix of fes at the points pts (sdim x npts):
+/// the sizes, the order and basis type, sums of the coordinates (plain,
+/// squared and weighted by the point index) and a hash of the element to
+/// vdof table, so that renumbering the elements, the dofs or the points
+/// changes it.
+void LG_InterpolationKey(
+    const FiniteElementSpace &fes,
+    const DenseMatrix &pts,
+    Vector &key);
+
+/// Write P (binary CSR) to file after key, the values identifying what it
+/// was built for (e.g. LG_InterpolationKey)
+void LG_SaveInterpolation(
+    const SparseMatrix &P,
+    const Vector &key,
+    const char *file);
+
+/// Read a matrix written by LG_SaveInterpolation with width columns.
+/// Returns NULL when the file can not be read, has another version or byte
+/// order, was written for another key or does not hold a valid CSR matrix
+/// of that width.
+SparseMatrix *LG_LoadInterpolation(
+    const Vector &key,
+    const int width,
+    const char *file);
+
+
+// LG_PointLocator implementation
+LG_PointLocator::LG_PointLocator(Mesh *mesh_, const int nthreads_)
+   : mesh(mesh_), nthreads(nthreads_)
+{
+  MFEM_VERIFY(nthreads >= 1, "at least one thread is needed");
+  dim = mesh->Dimension();
+  sdim = mesh->SpaceDimension();
+  ne = mesh->GetNE();
+  const bool curved = mesh->GetNodes() != NULL;
+
+  // element boxes from the control points, grown for curved elements whose
+  // control points need not bound them
+  IsoparametricTransformation T;
+  boxes.resize(2*sdim*ne);
+  affine.clear();
+  const bool straight_simplices = !curved && sdim == dim;
+  if (straight_simplices)
+    affine.resize((sdim + dim*sdim)*ne);
+  double lo[3], hi[3];
+  for (int d = 0; d < sdim; d++)
+  {
+    lo[d] = numeric_limits<double>::max();
+    hi[d] = -numeric_limits<double>::max();
+  }
+  for (int e = 0; e < ne; e++)
+  {
+    mesh->GetElementTransformation(e, &T);
+    const DenseMatrix &pm = T.GetPointMat();
+    double *box = &boxes[2*sdim*e];
+    for (int d = 0; d < sdim; d++)
+    {
+      box[d] = numeric_limits<double>::max();
+      box[sdim + d] = -numeric_limits<double>::max();
+      for (int j = 0; j < pm.Width(); j++)
+      {
+        box[d] = min(box[d], pm(d, j));
+        box[sdim + d] = max(box[sdim + d], pm(d, j));
+      }
+    }
+    const double grow = curved ? 0.05 : 1e-10;
+    for (int d = 0; d < sdim; d++)
+    {
+      const double h = grow*(box[sdim + d] - box[d]) + 1e-14;
+      box[d] -= h;
+      box[sdim + d] += h;
+      lo[d] = min(lo[d], box[d]);
+      hi[d] = max(hi[d], box[sdim + d]);
+    }
+
+    if (straight_simplices)
+    {
+      const Geometry::Type geom = mesh->GetElementBaseGeometry(e);
+      if (geom == Geometry::SEGMENT || geom == Geometry::TRIANGLE ||
+          geom == Geometry::TETRAHEDRON)
+      {
+        // vertex 0 is the image of the reference origin
+        T.SetIntPoint(&Geometries.GetCenter(geom));
+        const DenseMatrix &Jinv = T.InverseJacobian();
+        double *a = &affine[(sdim + dim*sdim)*e];
+        for (int d = 0; d < sdim; d++)
+          a[d] = pm(d, 0);
+        for (int k = 0; k < dim*sdim; k++)
+          a[sdim + k] = Jinv.Data()[k];
+      }
+      else
+        affine[(sdim + dim*sdim)*e] = numeric_limits<double>::quiet_NaN();
+    }
+  }
+
+  // about one element per bin
+  double vol = 1.0;
+  int nd = 0;
+  for (int d = 0; d < sdim; d++)
+    if (hi[d] > lo[d])
+    {
+      vol *= hi[d] - lo[d];
+      nd++;
+    }
+  const double h = pow(vol / max(ne, 1), 1.0 / max(nd, 1));
+  int nb = 1;
+  for (int d = 0; d < 3; d++)
+  {
+    bb_min[d] = (d < sdim) ? lo[d] : 0.0;
+    const double len = (d < sdim) ? hi[d] - lo[d] : 0.0;
+    nbins[d] = (len > 0.0) ? max(1, (int) ceil(len / h)) : 1;
+    bin_inv[d] = (len > 0.0) ? nbins[d] / len : 0.0;
+    nb *= nbins[d];
+  }
+
+  // two passes over the bins overlapped by every element box
+  bin_offsets.SetSize(nb + 1);
+  bin_offsets = 0;
+  for (int pass = 0; pass < 2; pass++)
+  {
+    for (int e = 0; e < ne; e++)
+    {
+      const double *box = &boxes[2*sdim*e];
+      int b0[3] = {0, 0, 0}, b1[3] = {0, 0, 0};
+      for (int d = 0; d < sdim; d++)
+      {
+        b0[d] = min(nbins[d] - 1, (int) ((box[d] - bb_min[d])*bin_inv[d]));
+        b1[d] = min(nbins[d] - 1,
+                    (int) ((box[sdim + d] - bb_min[d])*bin_inv[d]));
+      }
+      for (int k = b0[2]; k <= b1[2]; k++)
+        for (int j = b0[1]; j <= b1[1]; j++)
+          for (int i = b0[0]; i <= b1[0]; i++)
+          {
+            const int b = i + nbins[0]*(j + nbins[1]*k);
+            if (pass == 0)
+              bin_offsets[b + 1]++;
+            else
+              bin_elems[bin_offsets[b]++] = e;
+          }
+    }
+    if (pass == 0)
+    {
+      bin_offsets.PartialSum();
+      bin_elems.SetSize(bin_offsets[nb]);
+    }
+    else
+    {
+      // the fill advanced every offset to the start of the next bin
+      for (int b = nb; b > 0; b--)
+        bin_offsets[b] = bin_offsets[b - 1];
+      bin_offsets[0] = 0;
+    }
+  }
+}
+
+int LG_PointLocator::GetBin(const double *x) const
+{
+  int b = 0, stride = 1;
+  for (int d = 0; d < sdim; d++)
+  {
+    const double t = (x[d] - bb_min[d])*bin_inv[d];
+    if (t < 0.0 || t > nbins[d])
+      return -1;
+    b += stride*min(nbins[d] - 1, (int) t);
+    stride *= nbins[d];
+  }
+  return b;
+}
+
+bool LG_PointLocator::InElement(
+    const int e,
+    const double *x,
+    IsoparametricTransformation &T,
+    IntegrationPoint &ip) const
+{
+  const double *box = &boxes[2*sdim*e];
+  for (int d = 0; d < sdim; d++)
+    if (x[d] < box[d] || x[d] > box[sdim + d])
+      return false;
+
+  const double tol = 1e-12;
+  if (!affine.empty() && !std::isnan(affine[(sdim + dim*sdim)*e]))
+  {
+    // xi = J^{-1} (x - x0), inside when the barycentric coordinates are
+    const double *a = &affine[(sdim + dim*sdim)*e];
+    const double *Jinv = a + sdim;  // dim x sdim, column major
+    double xi[3] = {0.0, 0.0, 0.0}, sum = 0.0;
+    for (int r = 0; r < dim; r++)
+    {
+      for (int d = 0; d < sdim; d++)
+        xi[r] += Jinv[r + dim*d]*(x[d] - a[d]);
+      if (xi[r] < -tol)
+        return false;
+      sum += xi[r];
+    }
+    if (sum > 1.0 + tol)
+      return false;
+    ip.Set3(xi[0], xi[1], xi[2]);
+    return true;
+  }
+
+  mesh->GetElementTransformation(e, &T);
+  InverseElementTransformation inv(&T);
+  inv.SetPrintLevel(-1);
+  Vector xv(const_cast<double *>(x), sdim);
+  return inv.Transform(xv, ip) == InverseElementTransformation::Inside;
+}
+
+int LG_PointLocator::Locate(
+    const DenseMatrix &pts,
+    Array<int> &elems,
+    Array<IntegrationPoint> &ips) const
+{
+  MFEM_VERIFY(pts.Height() == sdim, "points need sdim coordinates");
+  const int npts = pts.Width();
+  elems.SetSize(npts);
+  ips.SetSize(npts);
+  const int nt = GetLocateThreads();
+  std::vector<int> found(nt, 0);
+  LG_ParallelFor(nt, npts, [&](int tid, int begin, int end)
+  {
+    IsoparametricTransformation T;
+    for (int i = begin; i < end; i++)
+    {
+      const double *x = pts.GetColumn(i);
+      elems[i] = -1;
+      const int b = GetBin(x);
+      if (b < 0)
+        continue;
+      for (int k = bin_offsets[b]; k < bin_offsets[b+1]; k++)
+        if (InElement(bin_elems[k], x, T, ips[i]))
+        {
+          elems[i] = bin_elems[k];
+          found[tid]++;
+          break;
+        }
+    }
+  });
+  int nfound = 0;
+  for (int t = 0; t < nt; t++)
+    nfound += found[t];
+  return nfound;
+}
+
+int LG_PointLocator::LocateLinear(
+    const DenseMatrix &pts,
+    Array<int> &elems,
+    Array<IntegrationPoint> &ips) const
+{
+  MFEM_VERIFY(pts.Height() == sdim, "points need sdim coordinates");
+  const int npts = pts.Width();
+  elems.SetSize(npts);
+  ips.SetSize(npts);
+  const int nt = GetLocateThreads();
+  std::vector<int> found(nt, 0);
+  LG_ParallelFor(nt, npts, [&](int tid, int begin, int end)
+  {
+    IsoparametricTransformation T;
+    for (int i = begin; i < end; i++)
+    {
+      const double *x = pts.GetColumn(i);
+      elems[i] = -1;
+      for (int e = 0; e < ne; e++)
+      {
+        // no box test: the inverse map decides
+        mesh->GetElementTransformation(e, &T);
+        InverseElementTransformation inv(&T);
+        inv.SetPrintLevel(-1);
+        Vector xv(const_cast<double *>(x), sdim);
+        if (inv.Transform(xv, ips[i]) == InverseElementTransformation::Inside)
+        {
+          elems[i] = e;
+          found[tid]++;
+          break;
+        }
+      }
+    }
+  });
+  int nfound = 0;
+  for (int t = 0; t < nt; t++)
+    nfound += found[t];
+  return nfound;
+}
+
+void LG_PointLocator::Evaluate(
+    const GridFunction &u,
+    const Array<int> &elems,
+    const Array<IntegrationPoint> &ips,
+    DenseMatrix &vals) const
+{
+  const FiniteElementSpace *fes = u.FESpace();
+  const int vdim = fes->GetVDim();
+  const int npts = elems.Size();
+  vals.SetSize(vdim, npts);
+  LG_ParallelFor(nthreads, npts, [&](int tid, int begin, int end)
+  {
+    Array<int> vdofs;
+    Vector loc, shape;
+    for (int i = begin; i < end; i++)
+    {
+      const int e = elems[i];
+      if (e < 0)
+      {
+        for (int c = 0; c < vdim; c++)
+          vals(c, i) = 0.0;
+        continue;
+      }
+      const FiniteElement *fe = fes->GetFE(e);
+      const int nd = fe->GetDof();
+      fes->GetElementVDofs(e, vdofs);
+      u.GetSubVector(vdofs, loc);
+      shape.SetSize(nd);
+      fe->CalcShape(ips[i], shape);
+      // the vdofs of a component are contiguous
+      for (int c = 0; c < vdim; c++)
+      {
+        double s = 0.0;
+        for (int k = 0; k < nd; k++)
+          s += shape(k)*loc(k + c*nd);
+        vals(c, i) = s;
+      }
+    }
+  });
+}
+
+
+SparseMatrix *LG_InterpolationMatrix(
+    const FiniteElementSpace &fes,
+    const Array<int> &elems,
+    const Array<IntegrationPoint> &ips)
+{
+  const int vdim = fes.GetVDim();
+  const int npts = elems.Size();
+  MFEM_VERIFY(ips.Size() == npts, "size mismatch");
+
+  int *I = new int[npts*vdim + 1];
+  I[0] = 0;
+  for (int i = 0; i < npts; i++)
+  {
+    const int nd = (elems[i] < 0) ? 0 : fes.GetFE(elems[i])->GetDof();
+    for (int c = 0; c < vdim; c++)
+      I[i*vdim + c + 1] = I[i*vdim + c] + nd;
+  }
+  int *J = new int[I[npts*vdim]];
+  double *a = new double[I[npts*vdim]];
+
+  Array<int> vdofs;
+  Vector shape;
+  for (int i = 0; i < npts; i++)
+  {
+    if (elems[i] < 0)
+      continue;
+    const FiniteElement *fe = fes.GetFE(elems[i]);
+    const int nd = fe->GetDof();
+    fes.GetElementVDofs(elems[i], vdofs);
+    shape.SetSize(nd);
+    fe->CalcShape(ips[i], shape);
+    for (int c = 0; c < vdim; c++)
+    {
+      const int r = I[i*vdim + c];
+      for (int k = 0; k < nd; k++)
+      {
+        J[r + k] = vdofs[k + c*nd];
+        a[r + k] = shape(k);
+      }
+    }
+  }
+  SparseMatrix *P = new SparseMatrix(I, J, a, npts*vdim, fes.GetVSize());
+  P->SortColumnIndices();
+  return P;
+}
+
+void LG_InterpolationKey(
+    const FiniteElementSpace &fes,
+    const DenseMatrix &pts,
+    Vector &key)
+{
+  const LG_FECollection *fec =
+    dynamic_cast<const LG_FECollection *>(fes.FEColl());
+  const int ne = fes.GetNE();
+  key.SetSize(11);
+  key(0) = ne;
+  key(1) = fes.GetVSize();
+  key(2) = (ne > 0) ? fes.GetFE(0)->GetOrder() : 0;
+  key(3) = fec ? fec->GetBasisType() : -1;
+  key(4) = pts.Width();
+  key(5) = key(6) = key(7) = 0.;
+  for (int i = 0; i < pts.Width(); i++)
+    for (int d = 0; d < pts.Height(); d++)
+    {
+      const double x = pts(d, i);
+      key(5) += x;
+      key(6) += x*x;
+      key(7) += (i + 1)*(d + 1)*x;
+    }
+
+  // FNV-1a of the element vdofs, stored as exact 32 bit halves
+  uint64_t h = 14695981039346656037ULL;
+  Array<int> vdofs;
+  for (int e = 0; e < ne; e++)
+  {
+    fes.GetElementVDofs(e, vdofs);
+    for (int k = 0; k < vdofs.Size(); k++)
+    {
+      h ^= (uint32_t) vdofs[k];
+      h *= 1099511628211ULL;
+    }
+    h ^= 0xffffffffULL;
+    h *= 1099511628211ULL;
+  }
+  key(8) = (double) (h >> 32);
+  key(9) = (double) (h & 0xffffffffULL);
+  key(10) = fes.GetOrdering();
+}
+
+// file layout: "LGIP", version, byte order mark, key size, key, height,
+// width, nonzeros, I, J, values
+static const int LG_INTERPOLATION_VERSION = 2;
+static const uint32_t LG_INTERPOLATION_BOM = 0x01020304;
+
+void LG_SaveInterpolation(
+    const SparseMatrix &P,
+    const Vector &key,
+    const char *file)
+{
+  ofstream ofs(file, ios::binary);
+  MFEM_VERIFY(ofs, "can not open " << file);
+  const int header[4] = {key.Size(), P.Height(), P.Width(),
+                         P.NumNonZeroElems()};
+  ofs.write("LGIP", 4);
+  ofs.write((const char*) &LG_INTERPOLATION_VERSION, sizeof(int));
+  ofs.write((const char*) &LG_INTERPOLATION_BOM, sizeof(uint32_t));
+  ofs.write((const char*) &header[0], sizeof(int));
+  ofs.write((const char*) key.GetData(), key.Size()*sizeof(double));
+  ofs.write((const char*) &header[1], 3*sizeof(int));
+  ofs.write((const char*) P.GetI(), (P.Height() + 1)*sizeof(int));
+  ofs.write((const char*) P.GetJ(), header[3]*sizeof(int));
+  ofs.write((const char*) P.GetData(), header[3]*sizeof(double));
+  MFEM_VERIFY(ofs, "error writing " << file);
+}
+
+SparseMatrix *LG_LoadInterpolation(
+    const Vector &key,
+    const int width,
+    const char *file)
+{
+  ifstream ifs(file, ios::binary);
+  char magic[4];
+  int version = -1, nkey = -1;
+  uint32_t bom = 0;
+  if (!ifs.read(magic, 4) || strncmp(magic, "LGIP", 4) != 0 ||
+      !ifs.read((char*) &version, sizeof(int)) ||
+      version != LG_INTERPOLATION_VERSION ||
+      !ifs.read((char*) &bom, sizeof(uint32_t)) ||
+      bom != LG_INTERPOLATION_BOM ||
+      !ifs.read((char*) &nkey, sizeof(int)) || nkey != key.Size())
+    return NULL;
+  Vector file_key(nkey);
+  ifs.read((char*) file_key.GetData(), nkey*sizeof(double));
+  for (int k = 0; k < nkey; k++)
+    if (!ifs || file_key(k) != key(k))
+      return NULL;
+
+  int sizes[3];
+  if (!ifs.read((char*) sizes, 3*sizeof(int)))
+    return NULL;
+  const int height = sizes[0], nnz = sizes[2];
+  if (height < 0 || sizes[1] != width || nnz < 0)
+    return NULL;
+  int *I = new int[height + 1];
+  int *J = new int[nnz];
+  double *a = new double[nnz];
+  ifs.read((char*) I, (height + 1)*sizeof(int));
+  ifs.read((char*) J, nnz*sizeof(int));
+  ifs.read((char*) a, nnz*sizeof(double));
+
+  // a valid CSR matrix of the expected width
+  bool valid = ifs && I[0] == 0 && I[height] == nnz;
+  for (int i = 0; valid && i < height; i++)
+    valid = I[i] <= I[i+1];
+  for (int m = 0; valid && m < nnz; m++)
+    valid = J[m] >= 0 && J[m] < width;
+  if (!valid)
+  {
+    delete [] I;
+    delete [] J;
+    delete [] a;
+    return NULL;
+  }
+  return new SparseMatrix(I, J, a, height, width);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef LAGRANGE_PROJECTION
+#define LAGRANGE_PROJECTION
+
+#include <vector>
+#include <functional>
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Vector coefficient evaluated on a whole batch of points in one call.
+/// Points and values are structures of arrays: x[d*npts + i] is coordinate
+/// d of point i and vals[c*npts + i] component c of the value at point i,
+/// so the function can run one vectorizable loop per component.
+class LG_BatchVectorCoefficient
+{
+public:
+  typedef std::function<void(const int npts, const double *x,
+                             double *vals)> BatchFunction;
+
+protected:
+  int vdim;
+  BatchFunction F;
+  mutable long calls, points;
+
+public:
+  LG_BatchVectorCoefficient(const int vdim_, const BatchFunction &F_)
+    : vdim(vdim_), F(F_), calls(0), points(0) { }
+
+  int GetVDim() const
+  { return vdim; }
+
+  void Eval(const int npts, const double *x, double *vals) const
+  {
+    calls++;
+    points += npts;
+    F(npts, x, vals);
+  }
+
+  /// Calls and points evaluated since the construction or the last reset
+  long GetNumCalls() const
+  { return calls; }
+  long GetNumPoints() const
+  { return points; }
+  void ResetCounters()
+  { calls = points = 0; }
+};
+
+/// Nodal projection of f onto the space of gf (nodal elements, vdim equal
+/// to the one of f) with a single evaluation of f at every dof: the nodes
+/// are collected in the order their dofs are first met, element by element,
+/// and f is evaluated on all of them in one call. Shared vertex, edge and
+/// face nodes are mapped once, by the first element holding them.
+void LG_ProjectCoefficient(
+    const LG_BatchVectorCoefficient &f,
+    GridFunction &gf);
+
+
+void LG_ProjectCoefficient(
+    const LG_BatchVectorCoefficient &f,
+    GridFunction &gf)
+{
+  const FiniteElementSpace *fes = gf.FESpace();
+  Mesh *mesh = fes->GetMesh();
+  const int vdim = fes->GetVDim();
+  const int sdim = mesh->SpaceDimension();
+  const int ndofs = fes->GetNDofs();
+  MFEM_VERIFY(f.GetVDim() == vdim, "the coefficient and the space have "
+      "different vector dimensions");
+
+  // physical coordinates of every scalar dof
+  std::vector<double> x(sdim*ndofs), vals(vdim*ndofs);
+  std::vector<bool> mapped(ndofs, false);
+  Array<int> dofs;
+  Vector xq(sdim);
+  for (int e = 0; e < mesh->GetNE(); e++)
+  {
+    const FiniteElement *fe = fes->GetFE(e);
+    const IntegrationRule &nodes = fe->GetNodes();
+    fes->GetElementDofs(e, dofs);
+    ElementTransformation *T = NULL;
+    for (int k = 0; k < dofs.Size(); k++)
+    {
+      const int d = (dofs[k] >= 0) ? dofs[k] : -1 - dofs[k];
+      if (mapped[d])
+        continue;
+      if (!T)
+        T = mesh->GetElementTransformation(e);
+      const IntegrationPoint &ip = nodes.IntPoint(k);
+      T->SetIntPoint(&ip);
+      T->Transform(ip, xq);
+      for (int c = 0; c < sdim; c++)
+        x[c*ndofs + d] = xq(c);
+      mapped[d] = true;
+    }
+  }
+
+  f.Eval(ndofs, x.data(), vals.data());
+
+  for (int d = 0; d < ndofs; d++)
+    for (int c = 0; c < vdim; c++)
+      gf(fes->DofToVDof(d, c)) = vals[c*ndofs + d];
+}
+
+#endif
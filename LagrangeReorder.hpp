@@ -0,0 +1,177 @@
+#ifndef LAGRANGE_REORDER
+#define LAGRANGE_REORDER
+
+#include <vector>
+#include <algorithm>
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Renumber the elements of mesh along a Hilbert space-filling curve through
+/// their centers. Call before building spaces on the mesh; a space then
+/// numbers its dofs in the new element order with ReorderElementToDofTable.
+void LG_ReorderElements(Mesh *mesh);
+
+/// Reverse Cuthill-McKee ordering of the (symmetric) graph of A: order[i] is
+/// the old index of the new row i. Every connected component starts from a
+/// pseudo-peripheral row.
+void LG_RCMOrdering(const SparseMatrix &A, Array<int> &order);
+
+/// P A P^T for the ordering order (new row i is the old row order[i]), with
+/// sorted rows
+SparseMatrix *LG_PermuteMatrix(const SparseMatrix &A, const Array<int> &order);
+
+/// y(i) = x(order[i])
+void LG_PermuteVector(const Vector &x, const Array<int> &order, Vector &y);
+/// y(order[i]) = x(i), the inverse of LG_PermuteVector
+void LG_UnpermuteVector(const Vector &x, const Array<int> &order, Vector &y);
+
+/// Max |i - j| over the nonzeros of A
+int LG_Bandwidth(const SparseMatrix &A);
+
+
+void LG_ReorderElements(Mesh *mesh)
+{
+  Array<int> ordering;
+  mesh->GetHilbertElementOrdering(ordering);
+  mesh->ReorderElements(ordering);
+}
+
+// breadth first search from root over the rows not yet in order, neighbors
+// by increasing degree; returns the index in order of the first row of the
+// last level
+int LG_RCMLevels(
+    const SparseMatrix &A,
+    const int root,
+    std::vector<int> &level,
+    Array<int> &order)
+{
+  const int *I = A.GetI();
+  const int *J = A.GetJ();
+  const int first = order.Size();
+  std::vector<int> nbrs;
+  level[root] = 0;
+  order.Append(root);
+  int last_level = first;
+  for (int q = first; q < order.Size(); q++)
+  {
+    const int i = order[q];
+    if (level[i] > level[order[last_level]])
+      last_level = q;
+    nbrs.clear();
+    for (int m = I[i]; m < I[i+1]; m++)
+      if (level[J[m]] < 0)
+      {
+        level[J[m]] = level[i] + 1;
+        nbrs.push_back(J[m]);
+      }
+    std::sort(nbrs.begin(), nbrs.end(), [&](int a, int b)
+    { return I[a+1] - I[a] < I[b+1] - I[b]; });
+    for (size_t k = 0; k < nbrs.size(); k++)
+      order.Append(nbrs[k]);
+  }
+  return last_level;
+}
+
+void LG_RCMOrdering(const SparseMatrix &A, Array<int> &order)
+{
+  const int n = A.Height();
+  const int *I = A.GetI();
+  std::vector<int> level(n, -1), trial(n, -1);
+  Array<int> component;
+  order.SetSize(0);
+
+  for (int start = 0; start < n; start++)
+  {
+    if (level[start] >= 0)
+      continue;
+
+    // pseudo-peripheral root (George-Liu): restart from the min degree row
+    // of the last level while the depth grows
+    int root = start, depth = -1;
+    while (true)
+    {
+      component.SetSize(0);
+      const int last = LG_RCMLevels(A, root, trial, component);
+      const int new_depth = trial[component.Last()];
+      int next = component[last];
+      for (int q = last; q < component.Size(); q++)
+        if (I[component[q]+1] - I[component[q]] < I[next+1] - I[next])
+          next = component[q];
+      for (int q = 0; q < component.Size(); q++)
+        trial[component[q]] = -1;
+      if (new_depth <= depth)
+        break;
+      depth = new_depth;
+      root = next;
+    }
+    LG_RCMLevels(A, root, level, order);
+  }
+
+  // reverse
+  for (int i = 0; i < n/2; i++)
+    std::swap(order[i], order[n-1-i]);
+}
+
+SparseMatrix *LG_PermuteMatrix(const SparseMatrix &A, const Array<int> &order)
+{
+  const int n = A.Height();
+  const int *I = A.GetI();
+  const int *J = A.GetJ();
+  const double *a = A.GetData();
+  MFEM_VERIFY(order.Size() == n, "ordering size mismatch");
+
+  Array<int> inv(n);
+  for (int i = 0; i < n; i++)
+    inv[order[i]] = i;
+
+  int *I_p = new int[n + 1];
+  int *J_p = new int[I[n]];
+  double *a_p = new double[I[n]];
+  std::vector<std::pair<int, double> > row;
+  I_p[0] = 0;
+  for (int i = 0; i < n; i++)
+  {
+    const int r = order[i];
+    row.clear();
+    for (int m = I[r]; m < I[r+1]; m++)
+      row.push_back(std::make_pair(inv[J[m]], a[m]));
+    std::sort(row.begin(), row.end());
+    I_p[i+1] = I_p[i] + row.size();
+    for (size_t k = 0; k < row.size(); k++)
+    {
+      J_p[I_p[i] + k] = row[k].first;
+      a_p[I_p[i] + k] = row[k].second;
+    }
+  }
+  return new SparseMatrix(I_p, J_p, a_p, n, n);
+}
+
+void LG_PermuteVector(const Vector &x, const Array<int> &order, Vector &y)
+{
+  y.SetSize(order.Size());
+  for (int i = 0; i < order.Size(); i++)
+    y(i) = x(order[i]);
+}
+
+void LG_UnpermuteVector(const Vector &x, const Array<int> &order, Vector &y)
+{
+  y.SetSize(order.Size());
+  for (int i = 0; i < order.Size(); i++)
+    y(order[i]) = x(i);
+}
+
+int LG_Bandwidth(const SparseMatrix &A)
+{
+  const int *I = A.GetI();
+  const int *J = A.GetJ();
+  int bw = 0;
+  for (int i = 0; i < A.Height(); i++)
+    for (int m = I[i]; m < I[i+1]; m++)
+      bw = max(bw, abs(i - J[m]));
+  return bw;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef LAGRANGE_SMOOTHERS
+#define LAGRANGE_SMOOTHERS
+
+#include <algorithm>
+
+/// Symmetric Gauss-Seidel from zero (as GSSmoother) on the CSR matrix
+/// (I, J, a) of order n with inverse diagonal dinv: one forward and one
+/// backward sweep of x_i = (b_i - sum_{c != i} a_ic x_c) dinv_i on k
+/// interleaved columns, x[i*k + j]. The column count is K when K > 0 and
+/// k otherwise; all the arithmetic is in the type T of the data. s is
+/// scratch for the k running sums, owned by the caller.
+template <typename T, int K>
+void LG_SymmetricGSSweep(
+    const int n,
+    const int *I,
+    const int *J,
+    const T *a,
+    const T *dinv,
+    const T *b,
+    T *x,
+    T *s,
+    const int k_ = K)
+{
+  const int k = (K > 0) ? K : k_;
+  std::fill(x, x + (long) n*k, T(0));
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    for (int t = 0; t < n; t++)
+    {
+      const int i = (pass == 0) ? t : n - 1 - t;
+      for (int j = 0; j < k; j++)
+        s[j] = b[(long) i*k + j];
+      for (int m = I[i]; m < I[i+1]; m++)
+      {
+        const int c = J[m];
+        if (c == i)
+          continue;
+        const T aim = a[m];
+        const T *xc = x + (long) c*k;
+        for (int j = 0; j < k; j++)
+          s[j] -= aim*xc[j];
+      }
+      for (int j = 0; j < k; j++)
+        x[(long) i*k + j] = dinv[i]*s[j];
+    }
+  }
+}
+
+#endif
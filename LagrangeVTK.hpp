@@ -0,0 +1,308 @@
+#ifndef LAGRANGE_VTK
+#define LAGRANGE_VTK
+
+#include <vector>
+#include <cmath>
+
+#include "LagrangeElements.hpp"
+
+using namespace std;
+using namespace mfem;
+
+/// Legacy VTK output with one VTK Lagrange cell (VTK_LAGRANGE_CURVE,
+/// TRIANGLE or QUADRILATERAL) per element of an LG space of order p, the
+/// curved geometry and the fields being interpolated by ParaView.
+///
+/// VTK Lagrange cells have equispaced nodes, while the LG nodes are Gauss-
+/// Lobatto points. Every scalar dof of the space gives one VTK point: the
+/// node with the same place in the layout of an equispaced (ClosedUniform)
+/// LG element of order p, mapped through the element transformation. Since
+/// both node families are symmetric, a dof shared by several elements gives
+/// the same point in all of them, so the points are shared as the dofs are.
+/// Fields are evaluated at these points, which represents them exactly.
+/// Serendipity spaces (incomplete quads) and 3D meshes are not supported.
+class LG_VTKWriter
+{
+protected:
+  const FiniteElementSpace *fes;
+  int order;
+  // equispaced twin of the LG element and VTK node -> local LG node, per
+  // geometry
+  FiniteElement *twin[Geometry::NumGeom];
+  Array<int> vtk_to_lg[Geometry::NumGeom];
+  // element and local node every point is evaluated through
+  Array<int> point_elem, point_node;
+
+  // equispaced lattice coordinates (i, j) of the nodes of geom in VTK order
+  static void GetVTKLattice(
+      const int geom,
+      const int p,
+      std::vector<int> &ij);
+
+public:
+  LG_VTKWriter(const FiniteElementSpace *fes);
+  ~LG_VTKWriter();
+
+  int GetNPoints() const
+  { return point_elem.Size(); }
+
+  /// Points, Lagrange cells and element attributes, ending with the header
+  /// of the point data (as Mesh::PrintVTK)
+  void PrintMesh(std::ostream &os) const;
+
+  /// Point field of gf, whose space has the dofs of the writer's one (the
+  /// vector dimension may differ). Vector fields with vdim equal to the
+  /// space dimension are written as VECTORS.
+  void SaveField(
+      std::ostream &os,
+      const GridFunction &gf,
+      const char *name) const;
+};
+
+
+// LG_VTKWriter implementation
+LG_VTKWriter::LG_VTKWriter(const FiniteElementSpace *fes_)
+   : fes(fes_), order(0)
+{
+  const LG_FECollection *fec =
+    dynamic_cast<const LG_FECollection *>(fes->FEColl());
+  MFEM_VERIFY(fec, "LG_VTKWriter needs an LG space");
+  MFEM_VERIFY(fec->GetBasisType() != BasisType::Serendipity,
+      "serendipity elements have no VTK Lagrange cell");
+  Mesh *mesh = fes->GetMesh();
+  MFEM_VERIFY(mesh->Dimension() < 3, "VTK Lagrange output is 1D and 2D only");
+  order = (mesh->GetNE() > 0) ? fes->GetFE(0)->GetOrder() : 0;
+  for (int g = 0; g < Geometry::NumGeom; g++)
+    twin[g] = NULL;
+
+  const int p = order;
+  Array<int> dofs;
+  std::vector<int> ij;
+  point_elem.SetSize(fes->GetNDofs());
+  point_elem = -1;
+  point_node.SetSize(fes->GetNDofs());
+  for (int e = 0; e < mesh->GetNE(); e++)
+  {
+    const int geom = mesh->GetElementBaseGeometry(e);
+    if (!twin[geom])
+    {
+      switch (geom)
+      {
+      case Geometry::SEGMENT:
+        twin[geom] = new LG_SegmentElement(p, BasisType::ClosedUniform);
+        break;
+      case Geometry::TRIANGLE:
+        twin[geom] = new LG_TriangleElement(p, BasisType::ClosedUniform);
+        break;
+      case Geometry::SQUARE:
+        twin[geom] = new LG_QuadrilateralElement(p, BasisType::ClosedUniform);
+        break;
+      default:
+        MFEM_ABORT("no VTK Lagrange cell for " << Geometry::Name[geom]);
+      }
+
+      // the twin nodes are multiples of 1/p: match them to the lattice
+      const IntegrationRule &nodes = twin[geom]->GetNodes();
+      const int nd = nodes.GetNPoints();
+      std::vector<int> lattice_node((p + 1)*(p + 1), -1);
+      for (int k = 0; k < nd; k++)
+      {
+        const IntegrationPoint &ip = nodes.IntPoint(k);
+        const int i = (int) std::lround(ip.x*p);
+        const int j = (geom == Geometry::SEGMENT) ? 0 :
+                      (int) std::lround(ip.y*p);
+        lattice_node[i + j*(p + 1)] = k;
+      }
+      GetVTKLattice(geom, p, ij);
+      MFEM_VERIFY((int) ij.size() == 2*nd, "node count mismatch");
+      vtk_to_lg[geom].SetSize(nd);
+      for (int m = 0; m < nd; m++)
+      {
+        vtk_to_lg[geom][m] = lattice_node[ij[2*m] + ij[2*m+1]*(p + 1)];
+        MFEM_VERIFY(vtk_to_lg[geom][m] >= 0, "VTK node " << m
+            << " has no LG node");
+      }
+    }
+
+    fes->GetElementDofs(e, dofs);
+    MFEM_VERIFY(dofs.Size() == twin[geom]->GetDof(), "element " << e
+        << " is not of order " << p);
+    for (int k = 0; k < dofs.Size(); k++)
+    {
+      const int d = (dofs[k] >= 0) ? dofs[k] : -1 - dofs[k];
+      if (point_elem[d] < 0)
+      {
+        point_elem[d] = e;
+        point_node[d] = k;
+      }
+    }
+  }
+}
+
+LG_VTKWriter::~LG_VTKWriter()
+{
+  for (int g = 0; g < Geometry::NumGeom; g++)
+    delete twin[g];
+}
+
+void LG_VTKWriter::GetVTKLattice(
+    const int geom,
+    const int p,
+    std::vector<int> &ij)
+{
+  ij.clear();
+  switch (geom)
+  {
+  case Geometry::SEGMENT:
+    // end points, then the interior
+    ij.push_back(0); ij.push_back(0);
+    ij.push_back(p); ij.push_back(0);
+    for (int i = 1; i < p; i++)
+    { ij.push_back(i); ij.push_back(0); }
+    break;
+
+  case Geometry::TRIANGLE:
+    // vertices, edges 0-1, 1-2 and 2-0 in their direction, then the
+    // interior as a triangle of order q - 3 shifted by (1,1), recursively
+    for (int q = p, o = 0; q >= 0; q -= 3, o++)
+    {
+      ij.push_back(o); ij.push_back(o);
+      if (q == 0)
+        break;
+      ij.push_back(o + q); ij.push_back(o);
+      ij.push_back(o); ij.push_back(o + q);
+      for (int i = 1; i < q; i++)
+      { ij.push_back(o + i); ij.push_back(o); }
+      for (int i = 1; i < q; i++)
+      { ij.push_back(o + q - i); ij.push_back(o + i); }
+      for (int i = 1; i < q; i++)
+      { ij.push_back(o); ij.push_back(o + q - i); }
+    }
+    break;
+
+  case Geometry::SQUARE:
+    // vertices counterclockwise, edges (0,0)-(p,0), (p,0)-(p,p),
+    // (0,p)-(p,p) and (0,0)-(0,p), then the interior with i fastest
+    ij.push_back(0); ij.push_back(0);
+    ij.push_back(p); ij.push_back(0);
+    ij.push_back(p); ij.push_back(p);
+    ij.push_back(0); ij.push_back(p);
+    for (int i = 1; i < p; i++)
+    { ij.push_back(i); ij.push_back(0); }
+    for (int j = 1; j < p; j++)
+    { ij.push_back(p); ij.push_back(j); }
+    for (int i = 1; i < p; i++)
+    { ij.push_back(i); ij.push_back(p); }
+    for (int j = 1; j < p; j++)
+    { ij.push_back(0); ij.push_back(j); }
+    for (int j = 1; j < p; j++)
+      for (int i = 1; i < p; i++)
+      { ij.push_back(i); ij.push_back(j); }
+    break;
+
+  default:
+    MFEM_ABORT("no VTK Lagrange cell for " << Geometry::Name[geom]);
+  }
+}
+
+void LG_VTKWriter::PrintMesh(std::ostream &os) const
+{
+  Mesh *mesh = fes->GetMesh();
+  const int ne = mesh->GetNE();
+  const int sdim = mesh->SpaceDimension();
+  const int npts = GetNPoints();
+
+  os << "# vtk DataFile Version 3.0\n"
+     << "LG Lagrange cells of order " << order << "\n"
+     << "ASCII\n"
+     << "DATASET UNSTRUCTURED_GRID\n";
+
+  os << "POINTS " << npts << " double\n";
+  Vector x(sdim);
+  for (int d = 0; d < npts; d++)
+  {
+    const int e = point_elem[d];
+    const FiniteElement *t = twin[mesh->GetElementBaseGeometry(e)];
+    const IntegrationPoint &ip = t->GetNodes().IntPoint(point_node[d]);
+    ElementTransformation *T = mesh->GetElementTransformation(e);
+    T->SetIntPoint(&ip);
+    T->Transform(ip, x);
+    for (int c = 0; c < 3; c++)
+      os << ((c < sdim) ? x(c) : 0.0) << ((c < 2) ? ' ' : '\n');
+  }
+
+  Array<int> dofs;
+  int size = 0;
+  for (int e = 0; e < ne; e++)
+    size += 1 + vtk_to_lg[mesh->GetElementBaseGeometry(e)].Size();
+  os << "CELLS " << ne << ' ' << size << '\n';
+  for (int e = 0; e < ne; e++)
+  {
+    const Array<int> &map = vtk_to_lg[mesh->GetElementBaseGeometry(e)];
+    fes->GetElementDofs(e, dofs);
+    os << map.Size();
+    for (int m = 0; m < map.Size(); m++)
+    {
+      const int d = dofs[map[m]];
+      os << ' ' << ((d >= 0) ? d : -1 - d);
+    }
+    os << '\n';
+  }
+
+  os << "CELL_TYPES " << ne << '\n';
+  for (int e = 0; e < ne; e++)
+  {
+    switch (mesh->GetElementBaseGeometry(e))
+    {
+    case Geometry::SEGMENT:  os << "68\n"; break;
+    case Geometry::TRIANGLE: os << "69\n"; break;
+    default:                 os << "70\n"; break;
+    }
+  }
+
+  os << "CELL_DATA " << ne << '\n'
+     << "SCALARS material int\n"
+     << "LOOKUP_TABLE default\n";
+  for (int e = 0; e < ne; e++)
+    os << mesh->GetAttribute(e) << '\n';
+
+  os << "POINT_DATA " << npts << '\n';
+}
+
+void LG_VTKWriter::SaveField(
+    std::ostream &os,
+    const GridFunction &gf,
+    const char *name) const
+{
+  Mesh *mesh = fes->GetMesh();
+  const int vdim = gf.FESpace()->GetVDim();
+  const int sdim = mesh->SpaceDimension();
+  const int npts = GetNPoints();
+  MFEM_VERIFY(gf.FESpace()->GetMesh() == mesh &&
+              gf.FESpace()->GetNDofs() == npts,
+              "the field is not on the dofs of the writer's space");
+
+  const bool vectors = (vdim > 1 && vdim == sdim);
+  if (vectors)
+    os << "VECTORS " << name << " double\n";
+  else
+    os << "SCALARS " << name << " double " << vdim << '\n'
+       << "LOOKUP_TABLE default\n";
+
+  Vector val(vdim);
+  for (int d = 0; d < npts; d++)
+  {
+    const int e = point_elem[d];
+    const FiniteElement *t = twin[mesh->GetElementBaseGeometry(e)];
+    const IntegrationPoint &ip = t->GetNodes().IntPoint(point_node[d]);
+    if (vdim == 1)
+      val(0) = gf.GetValue(e, ip);
+    else
+      gf.GetVectorValue(e, ip, val);
+    const int ncomp = vectors ? 3 : vdim;
+    for (int c = 0; c < ncomp; c++)
+      os << ((c < vdim) ? val(c) : 0.0) << ((c + 1 < ncomp) ? ' ' : '\n');
+  }
+}
+
+#endif
@@ -23,6 +23,7 @@ int main(int argc, char *argv[])
   int vrefine = 1;
   int mrefine = 0;
   int order  = 1;
+  bool parallel = false;
 
   OptionsParser args(argc, argv);
   args.AddOption(&mfem_mesh_file, "-m", "--mesh",
@@ -32,7 +33,9 @@ int main(int argc, char *argv[])
   args.AddOption(&mrefine, "-mr", "--mrefine",
       "Refinement level used to refine the mesh after loading it");
   args.AddOption(&order, "-o", "--order",
-      "Order for Lagrange Elements 1 or 2");
+      "Order for Lagrange Elements (1 to 10)");
+  args.AddOption(&parallel, "-par", "--parallel", "-no-par", "--no-parallel",
+      "Partition the mesh (ParMesh) and loop over the local elements");
   args.Parse();
   if (!args.Good())
   {
@@ -54,6 +57,15 @@ int main(int argc, char *argv[])
   for (int i = 0; i < mrefine; i++)
     mfem_mesh->UniformRefinement();
 
+  // every rank keeps its part of the mesh only; the spaces below are then
+  // built on the local elements
+  long global_ne = mfem_mesh->GetNE();
+  if (parallel)
+  {
+    Mesh* serial_mesh = mfem_mesh;
+    mfem_mesh = new ParMesh(MPI_COMM_WORLD, *serial_mesh);
+    delete serial_mesh;
+  }
 
   int dim  = mfem_mesh->Dimension();
   int sdim = mfem_mesh->SpaceDimension();
@@ -88,14 +100,19 @@ int main(int argc, char *argv[])
   for (int i = 0; i < mfem_mesh->GetNE(); i++) {
     // to be filled
   }
-  printf("total interpolation error is %e \n", sqrt(total_error) / mfem_mesh->GetNE());
+  // sum the squared errors of the local elements over the ranks
+  if (parallel)
+    MPI_Allreduce(MPI_IN_PLACE, &total_error, 1, MPI_DOUBLE, MPI_SUM,
+        MPI_COMM_WORLD);
+  if (myid == 0)
+    printf("total interpolation error is %e \n", sqrt(total_error) / global_ne);
 
   /* clean ups */
-  delete mfem_mesh;
   delete fes;
   delete fec;
   delete fes_linear;
   delete fec_linear;
+  delete mfem_mesh;
   MPI_Finalize();
 
   return 0;
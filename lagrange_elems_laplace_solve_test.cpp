@@ -1,14 +1,141 @@
 #include <mfem.hpp>
 #include <fstream>
 #include <iostream>
+#include <iomanip>
 #include <queue>
 
 #include "LagrangeElements.hpp"
+#include "LagrangeIntegrators.hpp"
+#include "LagrangeOperators.hpp"
+#include "LagrangeAssembly.hpp"
+#include "LagrangeMultigrid.hpp"
+#include "LagrangeBlockSolve.hpp"
+#include "LagrangeReorder.hpp"
+#include "LagrangeMixedPrecision.hpp"
+#include "LagrangePersistentSolver.hpp"
+#include "LagrangePointLocator.hpp"
+#include "LagrangeVTK.hpp"
 
 using namespace std;
 using namespace mfem;
 
 
+Mesh* read_mfem_mesh(const char* mesh_file);
+
+// add the LG diffusion (coefficient Q) and source (f) integrators to a and b,
+// assemble both and form A X = B with the essential values of x
+void form_diffusion_system(LG_FECollection* fec, Coefficient& Q,
+    Coefficient& f, const Array<int>& ess_tdof_list, LinearForm& b,
+    BilinearForm& a, Vector& x, OperatorPtr& A, Vector& X, Vector& B);
+
+// set cg up on A with the preconditioner M, stopping at the relative
+// tolerance rel_tol or after max_iter iterations, without output
+void setup_cg(CGSolver& cg, const Operator& A, Solver& M, double rel_tol,
+    int max_iter = 5000);
+
+// assemble the matrix of the diffusion operator on fes, which the partial
+// assembly runs never build, and print its memory footprint and time per
+// application (and dofs/s) next to those of the partial assembly operator
+void compare_pa_assembled(FiniteElementSpace* fes, LG_FECollection* fec,
+    const LG_PADiffusionOperator& A_pa, int myid);
+
+// solve with MFEM's own element restriction and partial assembly diffusion
+// kernels on the LG space (quads and hexes only), then assemble the matrix
+// and compare the time per application of both
+void solve_mfem_pa(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, LinearForm& b, GridFunction& x,
+    int myid);
+
+// assemble and solve the full (not condensed) system and print its size and
+// solve time next to those of the statically condensed system
+void compare_static_condensation(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, LinearForm& b, int sc_size,
+    double sc_time, int myid);
+
+// assemble the matrix and the right-hand side with LG_ThreadedAssembler on
+// 1, 2, 4, ... and nthreads threads, print the times per thread count and
+// return the nthreads results in A and B
+void threaded_assembly(FiniteElementSpace* fes, LG_FECollection* fec,
+    Coefficient& f, int nthreads, SparseMatrix*& A, Vector& B, int myid);
+
+// solve on the mesh refined 0, 1, ..., mrefine times with PCG preconditioned
+// by GSSmoother and by LG_PMultigrid (LG_GMultigrid over the refinements of
+// the loaded mesh when geometric) and print the iterations and times per
+// refinement level
+void compare_preconditioners(const char* mesh_file, int mrefine, int order,
+    int btype, bool geometric, Coefficient& f, int myid);
+
+// nested iteration: solve on the loaded mesh, interpolate the solution to
+// the next uniform refinement as the initial guess and repeat up to mrefine,
+// with every level solved only to below its discretization error; print the
+// iterations per level next to a cold start to the same residual and the
+// total time against a cold start on the finest level
+void nested_iteration(const char* mesh_file, int mrefine, int order,
+    int btype, Coefficient& f, int myid);
+
+// adaptive refinement: solve, estimate the error with the
+// ZienkiewiczZhuEstimator on the LG flux of LG_DiffusionIntegrator, refine
+// the elements holding most of it and repeat until the estimate is below
+// target_error; then refine uniformly down to the same estimate and print
+// the unknowns and times of both
+void adaptive_refinement(const char* mesh_file, int order, int btype,
+    double target_error, Coefficient& f, int myid);
+
+// read the heat source configurations of sources_file, one per line as
+// groups of "cx cy radius value" discs, and solve for all of them: once
+// rebuilding the system and running PCG per source, and once with the
+// operator and preconditioner set up once and LG_BlockPCG on blocks of
+// block_size right-hand sides; print the solves per second of both
+void batch_solve(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, const char* sources_file, int block_size,
+    int myid);
+
+// run nsolves solves with a moving heat source: rebuilding the system every
+// time, and with one LG_PersistentSolver taking only the new right-hand
+// side, then also new coefficients on 1% of the elements (updated in
+// place), then a refresh of all the values; print the time per solve of
+// every mode and check the in-place updates against a full reassembly
+void reuse_solves(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, int nsolves, int myid);
+
+// sample x at npoints random points of the mesh bounding box, located with
+// the bin grid of LG_PointLocator on 1 and on all hardware threads and by a
+// linear search over the elements (on a subset), and print the points per
+// second of the location and of the evaluation
+void probe_points(Mesh* mesh, const GridFunction& x, int npoints, int myid);
+
+// monitor x at the element centroids through the sparse interpolation
+// operator of LG_InterpolationMatrix, loaded from file when it was written
+// for this mesh, space and points and otherwise built and written there;
+// print the time per sampling step of the SpMV against recomputing the
+// transformations and shapes as GridFunction::GetValue does
+void centroid_monitoring(Mesh* mesh, FiniteElementSpace* fes,
+    const GridFunction& x, const char* file, int myid);
+
+// assemble and solve on the mesh in file order and after the Hilbert
+// element and RCM dof renumbering, and print the bandwidth, the assembly,
+// SpMV and PCG times of both
+void compare_reordering(const char* mesh_file, int mrefine, int order,
+    int btype, Coefficient& f, int myid);
+
+// solve A X = B with PCG and GSSmoother in double and with
+// LG_MixedPrecisionSolver (single precision operator and smoother, iterative
+// refinement in double) to the same relative residual, and print the
+// matrix memory held, the bytes read per product, the iterations, the times
+// and the final residuals of both
+void compare_mixed_precision(const SparseMatrix& A, const Vector& B, int myid);
+
+// solve on a ParMesh partitioned on 1, 2, 4, ..., num_procs ranks with
+// BoomerAMG preconditioned PCG and print a strong scaling table; the
+// solution of the num_procs run is written to one VTK file per rank
+void parallel_strong_scaling(Mesh* mesh, int order, int btype, int vrefine,
+    int myid, int num_procs);
+
+// write the mesh and gf as one VTK Lagrange cell per element with
+// LG_VTKWriter to file and print its size and write time next to those of
+// the output subdivided for vrefine (ref_bytes, ref_time)
+void write_lagrange_cells(const GridFunction& gf, const string& file,
+    long ref_bytes, double ref_time, int myid);
 
 // source function corresponding to heat source/sink at (0.25,0.25) and (0.75, 0.75)
 double source_term(const Vector& x)
@@ -32,6 +159,23 @@ int main(int argc, char *argv[])
   int vrefine = 1;
   int mrefine = 0;
   int order  = 1;
+  bool serendipity = false;
+  bool pa = false;
+  bool mfem_pa = false;
+  bool static_cond = false;
+  int nthreads = 0;
+  const char *prec = "gs";
+  bool parallel = false;
+  bool nested = false;
+  const char *sources_file = "";
+  int block_size = 8;
+  bool reorder = false;
+  double amr_error = 0.;
+  bool mixed = false;
+  int nreuse = 0;
+  int nprobe = 0;
+  const char *sample_file = "";
+  bool lagrange_cells = false;
 
   OptionsParser args(argc, argv);
   args.AddOption(&mfem_mesh_file, "-m", "--mesh",
@@ -41,7 +185,55 @@ int main(int argc, char *argv[])
   args.AddOption(&vrefine, "-vr", "--vrefine",
       "Refinement level used for visualization");
   args.AddOption(&order, "-o", "--order",
-      "Order for Lagrange Elements 1 or 2");
+      "Order for Lagrange Elements (1 to 10)");
+  args.AddOption(&serendipity, "-ser", "--serendipity", "-no-ser",
+      "--no-serendipity", "Use the serendipity quad (2D only)");
+  args.AddOption(&pa, "-pa", "--pa", "-no-pa", "--no-pa",
+      "Solve with the matrix-free partial assembly operator and Jacobi");
+  args.AddOption(&mfem_pa, "-mpa", "--mfem-pa", "-no-mpa", "--no-mfem-pa",
+      "Solve with MFEM's partial assembly kernels (AssemblyLevel::PARTIAL)");
+  args.AddOption(&static_cond, "-sc", "--static-condensation", "-no-sc",
+      "--no-static-condensation", "Enable static condensation of the "
+      "element interior dofs");
+  args.AddOption(&nthreads, "-nt", "--threads",
+      "Assemble with N threads (colored elements) and report the assembly "
+      "time per thread count (0: serial BilinearForm::Assemble)");
+  args.AddOption(&prec, "-pc", "--prec",
+      "Preconditioner of the assembled solve: gs (GSSmoother), pmg "
+      "(p-multigrid over the LG orders) or gmg (geometric multigrid over the "
+      "mesh refinements)");
+  args.AddOption(&parallel, "-par", "--parallel", "-no-par", "--no-parallel",
+      "Distributed solve (ParMesh, BoomerAMG) on 1, 2, 4, ... ranks with a "
+      "strong scaling table");
+  args.AddOption(&nested, "-ni", "--nested-iteration", "-no-ni",
+      "--no-nested-iteration", "Solve on every refinement level, starting "
+      "each level from the interpolated solution of the previous one");
+  args.AddOption(&sources_file, "-src", "--sources",
+      "File of heat source configurations (one per line, groups of "
+      "\"cx cy radius value\" discs) to solve for in a batch");
+  args.AddOption(&block_size, "-bs", "--block-size",
+      "Number of right-hand sides per block solve in the batch mode");
+  args.AddOption(&reorder, "-ro", "--reorder", "-no-ro", "--no-reorder",
+      "Renumber the elements along a Hilbert curve and the dofs by reverse "
+      "Cuthill-McKee before the solve");
+  args.AddOption(&amr_error, "-amr", "--amr-error",
+      "Refine adaptively from the loaded mesh until the ZZ error estimate is "
+      "below this value and compare with uniform refinement (0: off)");
+  args.AddOption(&mixed, "-mp", "--mixed-precision", "-no-mp",
+      "--no-mixed-precision", "Solve with the operator and smoother in single "
+      "precision and iterative refinement in double");
+  args.AddOption(&nreuse, "-rs", "--reuse-solves",
+      "Number of solves with changing sources and element coefficients to "
+      "run with a persistent solver against rebuilding (0: off)");
+  args.AddOption(&nprobe, "-pp", "--probe-points",
+      "Number of random points to sample the solution at after the solve "
+      "(0: off)");
+  args.AddOption(&sample_file, "-so", "--sample-operator",
+      "Sample the solution at the element centroids with an interpolation "
+      "matrix read from this file, or built and written to it");
+  args.AddOption(&lagrange_cells, "-lc", "--lagrange-cells", "-no-lc",
+      "--no-lagrange-cells", "Also write the solution as VTK Lagrange cells "
+      "of the element order (1D and 2D, no serendipity)");
   args.Parse();
   if (!args.Good())
   {
@@ -56,69 +248,264 @@ int main(int argc, char *argv[])
   {
     args.PrintOptions(cout);
   }
+  const bool pmg = !strcmp(prec, "pmg");
+  const bool gmg = !strcmp(prec, "gmg");
+  MFEM_VERIFY(pmg || gmg || !strcmp(prec, "gs"),
+      "unknown preconditioner " << prec);
+  const bool batch = sources_file[0] != '\0';
+  MFEM_VERIFY(block_size >= 1, "the block size must be positive");
+  const bool amr = amr_error > 0.;
+  // every solver mode replaces the default solve, so at most one is chosen
+  const bool modes[] = { pa, mfem_pa, static_cond, nthreads > 0, pmg || gmg,
+    parallel, nested, batch, reorder, amr, mixed, nreuse > 0 };
+  const char* mode_names[] = { "--pa", "--mfem-pa", "--static-condensation",
+    "--threads", "--prec pmg/gmg", "--parallel", "--nested-iteration",
+    "--sources", "--reorder", "--amr-error", "--mixed-precision",
+    "--reuse-solves" };
+  int nmodes = 0;
+  string chosen;
+  for (unsigned m = 0; m < sizeof(modes)/sizeof(modes[0]); m++)
+    if (modes[m])
+    {
+      nmodes++;
+      chosen += string(" ") + mode_names[m];
+    }
+  MFEM_VERIFY(nmodes <= 1, "the solver modes exclude each other, got"
+      << chosen);
+  MFEM_VERIFY(!lagrange_cells || !serendipity,
+      "serendipity elements have no VTK Lagrange cell");
 
-  // TODO: load the mesh
-  Mesh* mfem_mesh = ;
+  // load the mesh
+  Mesh* mfem_mesh = read_mfem_mesh(mfem_mesh_file);
 
-  // refine the mesh if needed
+  // refine the mesh if needed; geometric multigrid rebuilds the levels
+  // from the loaded mesh
+  Mesh* coarse_mesh = gmg ? new Mesh(*mfem_mesh) : NULL;
   for (int i = 0; i < mrefine; i++)
     mfem_mesh->UniformRefinement();
+  if (reorder)
+    LG_ReorderElements(mfem_mesh);
 
   int dim  = mfem_mesh->Dimension();
   int sdim = mfem_mesh->SpaceDimension();
+  const int btype = serendipity ? BasisType::Serendipity : BasisType::GaussLobatto;
+
+  if (parallel)
+  {
+    parallel_strong_scaling(mfem_mesh, order, btype, vrefine, myid, num_procs);
+    delete mfem_mesh;
+    MPI_Finalize();
+    return 0;
+  }
 
 
-  // TODO: create the Lagrange finite element collection and space for a scalar Temperature field
-  FiniteElementCollection *fec = ;
-  FiniteElementSpace *fes = ;
+  // create the Lagrange finite element collection and space for a scalar Temperature field
+  LG_FECollection *fec = new LG_FECollection(order, dim, btype);
+  FiniteElementSpace *fes = new FiniteElementSpace(mfem_mesh, fec);
+  // first touch dof numbering along the reordered elements
+  if (reorder)
+    fes->ReorderElementToDofTable();
+  if (myid == 0)
+    cout << "Number of unknowns: " << fes->GetTrueVSize() << endl;
 
 
-  // TODO: set Dirichlet boundary condition on all edges and get the essential dofs
-  // Hint: see ex1.cpp in mfem/examples/
+  // set Dirichlet boundary condition on all edges and get the essential dofs
   Array<int> ess_tdof_list;
+  Array<int> ess_bdr(mfem_mesh->bdr_attributes.Size() ?
+      mfem_mesh->bdr_attributes.Max() : 0);
+  if (mfem_mesh->bdr_attributes.Size())
+  {
+    ess_bdr = 1;
+    fes->GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+  }
 
 
-  // TODO: set and assemble the linear form (the right-hand-side)
-  // Hints:
-  //   use FunctionCoefficient to define right-side of equation - del del u = source_term.
-  //   use DomainFIntegrator
-  //   see ex1.cpp in mfem/examples/
+  // set and assemble the linear form (the right-hand-side) of - del del u = source_term
+  // the LG integrators read the shapes of all quadrature points from the
+  // shape tables cached in fec, which are computed once per geometry
+  FunctionCoefficient f(source_term);
   LinearForm b(fes);
+  b.AddDomainIntegrator(new LG_DomainLFIntegrator(f, fec));
+  b.Assemble();
 
   // define the solution vector and initialize to 0.
   GridFunction x(fes);
   x = 0.;
 
-  // TODO: set and assemble the bilinear form (the left-hand-side)
-  // Hints:
-  //   use DiffusionIntegrator for the operator -del del ()
-  //   use ConstantCoefficient to define the coefficient of - del del () (in this case 1)
-  //   see ex1.cpp in mfem/examples/
+  // set the bilinear form (the left-hand-side) for the operator - del del ();
+  // it is assembled only by the modes using the global matrix
+  ConstantCoefficient one(1.0);
+  // with static condensation the interior dofs are eliminated element by
+  // element and only the dofs of the LG_Trace_FECollection remain global
   BilinearForm a(fes);
+  if (static_cond)
+    a.EnableStaticCondensation();
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
 
 
-  // form the linear system
-  OperatorPtr A;
-  Vector B, X;
-  a.FormLinearSystem(ess_tdof_list, x, b, A, X, B);
+  if (pa)
+  {
+    // matrix-free operator; x = 0 on the boundary so the Dirichlet values
+    // eliminated from the right-hand side are 0 as well
+    LG_PADiffusionOperator A_pa(fes, fec, one);
+    ConstrainedOperator A_c(&A_pa, ess_tdof_list);
+    Vector B_pa(b);
+    A_c.EliminateRHS(x, B_pa);
 
-  // Solve step
-  GSSmoother M((SparseMatrix&)(*A));
-  PCG(*A, M, B, X, 1, 200, 1e-12, 0.0);
+    Vector diag;
+    A_pa.AssembleDiagonal(diag);
+    LG_JacobiSmoother M_pa(diag, ess_tdof_list);
+    PCG(A_c, M_pa, B_pa, x, 1, 200, 1e-12, 0.0);
 
-  // Recover the solution
-  a.RecoverFEMSolution(X, b, x);
+    compare_pa_assembled(fes, fec, A_pa, myid);
+  }
+  else if (mfem_pa)
+  {
+    solve_mfem_pa(fes, fec, ess_tdof_list, b, x, myid);
+  }
+  else if (batch)
+  {
+    batch_solve(fes, fec, ess_tdof_list, sources_file, block_size, myid);
+  }
+  else if (nested)
+  {
+    nested_iteration(mfem_mesh_file, mrefine, order, btype, f, myid);
+  }
+  else if (amr)
+  {
+    adaptive_refinement(mfem_mesh_file, order, btype, amr_error, f, myid);
+  }
+  else if (nreuse > 0)
+  {
+    reuse_solves(fes, fec, ess_tdof_list, nreuse, myid);
+  }
+  else if (nthreads > 0)
+  {
+    SparseMatrix* A_t = NULL;
+    Vector B_t;
+    threaded_assembly(fes, fec, f, nthreads, A_t, B_t, myid);
+
+    // check against the serial assembly
+    a.Assemble();
+    a.Finalize();
+    SparseMatrix* D = Add(1., *A_t, -1., a.SpMat());
+    Vector db(B_t);
+    db -= b;
+    if (myid == 0)
+      printf("max difference to the serial assembly: matrix %e, rhs %e\n",
+          D->MaxNorm(), db.Normlinf());
+    delete D;
+
+    // eliminate the Dirichlet dofs (x = 0 there) and solve
+    for (int i = 0; i < ess_tdof_list.Size(); i++)
+      A_t->EliminateRowCol(ess_tdof_list[i], x(ess_tdof_list[i]), B_t);
+
+    GSSmoother M(*A_t);
+    PCG(*A_t, M, B_t, x, 1, 200, 1e-12, 0.0);
+    delete A_t;
+  }
+  else
+  {
+    // assemble and form the linear system
+    a.Assemble();
+    OperatorPtr A;
+    Vector B, X;
+    a.FormLinearSystem(ess_tdof_list, x, b, A, X, B);
+
+    // Solve step
+    StopWatch sw_solve;
+    sw_solve.Start();
+    if (pmg)
+    {
+      LG_PMultigrid M(fes, (SparseMatrix&)(*A), ess_bdr, one);
+      PCG(*A, M, B, X, 1, 200, 1e-12, 0.0);
+    }
+    else if (gmg)
+    {
+      LG_GMultigrid M(fes, (SparseMatrix&)(*A), ess_bdr, one, *coarse_mesh,
+          mrefine);
+      PCG(*A, M, B, X, 1, 200, 1e-12, 0.0);
+    }
+    else if (reorder)
+    {
+      // solve the RCM renumbered system
+      Array<int> rcm;
+      LG_RCMOrdering((SparseMatrix&)(*A), rcm);
+      SparseMatrix* A_rcm = LG_PermuteMatrix((SparseMatrix&)(*A), rcm);
+      Vector B_rcm, X_rcm;
+      LG_PermuteVector(B, rcm, B_rcm);
+      LG_PermuteVector(X, rcm, X_rcm);
+      GSSmoother M(*A_rcm);
+      PCG(*A_rcm, M, B_rcm, X_rcm, 1, 200, 1e-12, 0.0);
+      LG_UnpermuteVector(X_rcm, rcm, X);
+      delete A_rcm;
+    }
+    else if (mixed)
+    {
+      LG_MixedPrecisionSolver M;
+      M.SetOperator(*A);
+      M.Mult(B, X);
+    }
+    else if (static_cond)
+    {
+      // silent and with the settings of the full system solve it is
+      // compared with
+      GSSmoother M((SparseMatrix&)(*A));
+      CGSolver cg;
+      setup_cg(cg, *A, M, 1e-6, 200);
+      cg.Mult(B, X);
+    }
+    else
+    {
+      GSSmoother M((SparseMatrix&)(*A));
+      PCG(*A, M, B, X, 1, 200, 1e-12, 0.0);
+    }
+    sw_solve.Stop();
+
+    // Recover the solution (and the interior dofs when condensed)
+    a.RecoverFEMSolution(X, b, x);
+
+    if (static_cond)
+      compare_static_condensation(fes, fec, ess_tdof_list, b, A->Height(),
+          sw_solve.RealTime(), myid);
+    if (pmg || gmg)
+      compare_preconditioners(mfem_mesh_file, mrefine, order, btype, gmg, f,
+          myid);
+    if (reorder)
+      compare_reordering(mfem_mesh_file, mrefine, order, btype, f, myid);
+    if (mixed)
+      compare_mixed_precision((SparseMatrix&)(*A), B, myid);
+  }
+  if (myid == 0)
+    cout << "Shape table cache: " << fec->GetShapeTableHits() << " hits, "
+         << fec->GetShapeTableMisses() << " misses" << endl;
+
+  if (nprobe > 0)
+    probe_points(mfem_mesh, x, nprobe, myid);
+  if (sample_file[0] != '\0')
+    centroid_monitoring(mfem_mesh, fes, x, sample_file, myid);
 
   // Write to VTK for visualization
   stringstream ss;
   ss << "mesh_field_order_" << order << ".vtk";
+  StopWatch sw_vtk;
+  sw_vtk.Start();
   ofstream ofs;
   ofs.open(ss.str().c_str(), ofstream::out);
   mfem_mesh->PrintVTK(ofs, vrefine);
   x.SaveVTK(ofs, "field", vrefine);
+  const long vtk_bytes = ofs.tellp();
   ofs.close();
+  sw_vtk.Stop();
+  if (lagrange_cells)
+  {
+    stringstream ss_lc;
+    ss_lc << "mesh_field_order_" << order << "_lagrange.vtk";
+    write_lagrange_cells(x, ss_lc.str(), vtk_bytes, sw_vtk.RealTime(), myid);
+  }
 
   /* delete grid_f; */
+  delete coarse_mesh;
   delete mfem_mesh;
   delete fes;
   delete fec;
@@ -126,3 +513,1179 @@ int main(int argc, char *argv[])
 
   return 0;
 }
+
+void form_diffusion_system(LG_FECollection* fec, Coefficient& Q,
+    Coefficient& f, const Array<int>& ess_tdof_list, LinearForm& b,
+    BilinearForm& a, Vector& x, OperatorPtr& A, Vector& X, Vector& B)
+{
+  b.AddDomainIntegrator(new LG_DomainLFIntegrator(f, fec));
+  b.Assemble();
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(Q, fec));
+  a.Assemble();
+  a.FormLinearSystem(ess_tdof_list, x, b, A, X, B);
+}
+
+void setup_cg(CGSolver& cg, const Operator& A, Solver& M, double rel_tol,
+    int max_iter)
+{
+  cg.SetRelTol(rel_tol);
+  cg.SetAbsTol(0.0);
+  cg.SetMaxIter(max_iter);
+  cg.SetPrintLevel(-1);
+  cg.SetPreconditioner(M);
+  cg.SetOperator(A);
+}
+
+void compare_pa_assembled(FiniteElementSpace* fes, LG_FECollection* fec,
+    const LG_PADiffusionOperator& A_pa, int myid)
+{
+  ConstantCoefficient one(1.0);
+  BilinearForm a(fes);
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+  a.Assemble();
+  a.Finalize();
+  const SparseMatrix& A = a.SpMat();
+
+  const int nmult = 20;
+  Vector u(A.Width()), v(A.Height());
+  u = 1.;
+
+  StopWatch sw_fa, sw_pa;
+  sw_fa.Start();
+  for (int i = 0; i < nmult; i++)
+    A.Mult(u, v);
+  sw_fa.Stop();
+  sw_pa.Start();
+  for (int i = 0; i < nmult; i++)
+    A_pa.Mult(u, v);
+  sw_pa.Stop();
+
+  const double mem_fa = double(A.NumNonZeroElems()) * (sizeof(double) + sizeof(int))
+    + double(A.Height() + 1) * sizeof(int);
+  const double mem_pa = double(A_pa.GetMemoryFootprint());
+  const double t_fa = sw_fa.RealTime() / nmult;
+  const double t_pa = sw_pa.RealTime() / nmult;
+  if (myid == 0) {
+    printf("assembled : %10.3f MB, %e s per Mult, %8.2f MDofs/s\n",
+        mem_fa / 1.e6, t_fa, A.Height() / t_fa / 1.e6);
+    printf("partial   : %10.3f MB, %e s per Mult, %8.2f MDofs/s\n",
+        mem_pa / 1.e6, t_pa, A.Height() / t_pa / 1.e6);
+  }
+}
+
+void compare_static_condensation(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, LinearForm& b, int sc_size,
+    double sc_time, int myid)
+{
+  ConstantCoefficient one(1.0);
+  BilinearForm a(fes);
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+  a.Assemble();
+
+  GridFunction x(fes);
+  x = 0.;
+  OperatorPtr A;
+  Vector B, X;
+  a.FormLinearSystem(ess_tdof_list, x, b, A, X, B);
+
+  StopWatch sw_solve;
+  sw_solve.Start();
+  GSSmoother M((SparseMatrix&)(*A));
+  CGSolver cg;
+  setup_cg(cg, *A, M, 1e-6, 200);
+  cg.Mult(B, X);
+  sw_solve.Stop();
+
+  if (myid == 0) {
+    printf("condensed system : %8d unknowns, %e s solve\n", sc_size, sc_time);
+    printf("full system      : %8d unknowns, %e s solve\n", A->Height(),
+        sw_solve.RealTime());
+    printf("reduction        : %8.2fx unknowns, %8.2fx solve time\n",
+        double(A->Height()) / sc_size, sw_solve.RealTime() / sc_time);
+  }
+}
+
+// heat sources/sinks on discs, as source_term
+double disc_source(const Vector& x, const vector<double>& discs)
+{
+  double res = 0.;
+  for (size_t d = 0; d + 3 < discs.size(); d += 4)
+  {
+    const double dx = x(0) - discs[d], dy = x(1) - discs[d+1];
+    if (dx*dx + dy*dy < discs[d+2]*discs[d+2])
+      res += discs[d+3];
+  }
+  return res;
+}
+
+void batch_solve(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, const char* sources_file, int block_size,
+    int myid)
+{
+  ifstream ifs(sources_file);
+  MFEM_VERIFY(ifs, "can not open the source file " << sources_file);
+  vector<vector<double> > sources;
+  string line;
+  while (getline(ifs, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    istringstream iss(line);
+    vector<double> discs;
+    double v;
+    while (iss >> v)
+      discs.push_back(v);
+    MFEM_VERIFY(discs.size() % 4 == 0, "a source line needs groups of "
+        "\"cx cy radius value\": " << line);
+    sources.push_back(discs);
+  }
+  const int ns = sources.size();
+  MFEM_VERIFY(ns > 0, "no sources in " << sources_file);
+  const int n = fes->GetTrueVSize();
+  ConstantCoefficient one(1.0);
+
+  // one at a time: rebuild and solve the system for every source
+  DenseMatrix X_loop(ns, n);
+  int its_loop = 0;
+  StopWatch sw_loop;
+  sw_loop.Start();
+  for (int s = 0; s < ns; s++)
+  {
+    FunctionCoefficient f_s([&sources, s](const Vector& x)
+        { return disc_source(x, sources[s]); });
+    LinearForm b(fes);
+    BilinearForm a(fes);
+    GridFunction x(fes);
+    x = 0.;
+    OperatorPtr A;
+    Vector B, X;
+    form_diffusion_system(fec, one, f_s, ess_tdof_list, b, a, x, A, X, B);
+
+    GSSmoother M((SparseMatrix&)(*A));
+    CGSolver cg;
+    setup_cg(cg, *A, M, 1e-6, 1000);
+    cg.Mult(B, X);
+    its_loop += cg.GetNumIterations();
+    for (int i = 0; i < n; i++)
+      X_loop(s, i) = X(i);
+  }
+  sw_loop.Stop();
+
+  // batch: operator and preconditioner once, block solves of the sources
+  StopWatch sw_setup, sw_rhs, sw_solve;
+  sw_setup.Start();
+  GridFunction x(fes);
+  x = 0.;
+  BilinearForm a(fes);
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+  a.Assemble();
+  OperatorPtr A_op;
+  a.FormSystemMatrix(ess_tdof_list, A_op);
+  const SparseMatrix& A = *A_op.As<SparseMatrix>();
+  LG_BlockGSSmoother M(A);
+  LG_BlockPCG cg;
+  cg.SetOperator(A);
+  cg.SetPreconditioner(M);
+  cg.SetRelTol(1e-6);
+  cg.SetMaxIter(1000);
+  sw_setup.Stop();
+
+  DenseMatrix X_batch(ns, n), B_blk, X_blk;
+  int its_batch = 0;
+  for (int s0 = 0; s0 < ns; s0 += block_size)
+  {
+    const int k = min(block_size, ns - s0);
+    sw_rhs.Start();
+    B_blk.SetSize(k, n);
+    for (int j = 0; j < k; j++)
+    {
+      // x = 0 on the boundary, so the eliminated right-hand side is b with
+      // zero essential entries
+      FunctionCoefficient f_s([&sources, s0, j](const Vector& x)
+          { return disc_source(x, sources[s0 + j]); });
+      LinearForm b(fes);
+      b.AddDomainIntegrator(new LG_DomainLFIntegrator(f_s, fec));
+      b.Assemble();
+      for (int i = 0; i < n; i++)
+        B_blk(j, i) = b(i);
+      for (int i = 0; i < ess_tdof_list.Size(); i++)
+        B_blk(j, ess_tdof_list[i]) = 0.;
+    }
+    sw_rhs.Stop();
+
+    sw_solve.Start();
+    cg.Mult(B_blk, X_blk);
+    sw_solve.Stop();
+    for (int j = 0; j < k; j++)
+    {
+      its_batch += cg.GetNumIterations(j);
+      for (int i = 0; i < n; i++)
+        X_batch(s0 + j, i) = X_blk(j, i);
+    }
+  }
+
+  X_batch -= X_loop;
+  const double t_batch = sw_setup.RealTime() + sw_rhs.RealTime() +
+    sw_solve.RealTime();
+  if (myid == 0) {
+    printf("%d sources, %d unknowns, block size %d\n", ns, n, block_size);
+    printf("one at a time : %e s, %10.2f solves/s, %d PCG iterations\n",
+        sw_loop.RealTime(), ns / sw_loop.RealTime(), its_loop);
+    printf("batch         : %e s, %10.2f solves/s, %d PCG iterations "
+        "(setup %e s, rhs %e s, block solves %e s)\n", t_batch,
+        ns / t_batch, its_batch, sw_setup.RealTime(), sw_rhs.RealTime(),
+        sw_solve.RealTime());
+    printf("max difference of the solutions : %e\n", X_batch.MaxMaxNorm());
+  }
+}
+
+void reuse_solves(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, int nsolves, int myid)
+{
+  ConstantCoefficient one(1.0);
+  const int ne = fes->GetNE();
+  const int nupdate = max(1, ne / 100);
+  const double rel_tol = 1e-10;
+  int its[4] = {0, 0, 0, 0};
+  double times[4], setup_time;
+
+  // the source of solve s: a disc moving along the diagonal
+  vector<vector<double> > sources(nsolves);
+  for (int s = 0; s < nsolves; s++)
+  {
+    const double c = 0.2 + (0.6*s) / max(1, nsolves - 1);
+    sources[s] = {c, c, 0.1, 1.};
+  }
+
+  // rebuild everything for every solve
+  StopWatch sw;
+  sw.Start();
+  // X refers to the data of the loop-local x, the last solution is copied
+  Vector X_last;
+  for (int s = 0; s < nsolves; s++)
+  {
+    FunctionCoefficient f_s([&sources, s](const Vector& x)
+        { return disc_source(x, sources[s]); });
+    LinearForm b(fes);
+    BilinearForm a(fes);
+    GridFunction x(fes);
+    x = 0.;
+    OperatorPtr A;
+    Vector X, B;
+    form_diffusion_system(fec, one, f_s, ess_tdof_list, b, a, x, A, X, B);
+    GSSmoother M((SparseMatrix&)(*A));
+    CGSolver cg;
+    setup_cg(cg, *A, M, rel_tol);
+    cg.Mult(B, X);
+    its[0] += cg.GetNumIterations();
+    X_last = X;
+  }
+  sw.Stop();
+  times[0] = sw.RealTime();
+
+  sw.Clear();
+  sw.Start();
+  LG_PersistentSolver solver(fes, fec, one, ess_tdof_list);
+  solver.SetRelTol(rel_tol);
+  sw.Stop();
+  setup_time = sw.RealTime();
+
+  // 1: new right-hand sides, 2: and new coefficients on a few elements,
+  // 3: and all the values refreshed
+  GridFunction x(fes);
+  Array<int> elems(nupdate);
+  Vector values(nupdate);
+  double rhs_diff = 0., update_diff = 0.;
+  for (int mode = 1; mode <= 3; mode++)
+  {
+    sw.Clear();
+    sw.Start();
+    for (int s = 0; s < nsolves; s++)
+    {
+      if (mode == 2)
+      {
+        for (int i = 0; i < nupdate; i++)
+        {
+          elems[i] = (int) (((long) s*7919 + (long) i*104729) % ne);
+          values(i) = 1. + (s + i) % 9;
+        }
+        solver.SetElementCoefficients(elems, values);
+      }
+      else if (mode == 3)
+        solver.Reassemble();
+      FunctionCoefficient f_s([&sources, s](const Vector& x)
+          { return disc_source(x, sources[s]); });
+      LinearForm b(fes);
+      b.AddDomainIntegrator(new LG_DomainLFIntegrator(f_s, fec));
+      b.Assemble();
+      x = 0.;
+      solver.Solve(b, x);
+      its[mode] += solver.GetNumIterations();
+    }
+    sw.Stop();
+    times[mode] = sw.RealTime();
+
+    if (mode == 1)
+    {
+      // same system as the last rebuild
+      Vector dx(x);
+      dx -= X_last;
+      rhs_diff = dx.Normlinf() / X_last.Normlinf();
+    }
+    else if (mode == 2)
+    {
+      // the in-place updates against all the values recomputed
+      const SparseMatrix& A = solver.GetMatrix();
+      const int nnz = A.NumNonZeroElems();
+      vector<double> updated(A.GetData(), A.GetData() + nnz);
+      solver.Reassemble();
+      double diff = 0., norm = 0.;
+      for (int m = 0; m < nnz; m++)
+      {
+        diff = max(diff, fabs(updated[m] - A.GetData()[m]));
+        norm = max(norm, fabs(A.GetData()[m]));
+      }
+      update_diff = diff / norm;
+    }
+  }
+
+  if (myid == 0) {
+    const char* names[4] = {"rebuild", "rhs only", "element update",
+                            "values refresh"};
+    printf("%d solves, %d of %d elements updated per solve\n", nsolves,
+        nupdate, ne);
+    printf("mode            per solve (s)  PCG its  speedup\n");
+    for (int mode = 0; mode < 4; mode++)
+      printf("%-14s  %e  %7d  %7.2fx\n", names[mode], times[mode] / nsolves,
+          its[mode], times[0] / times[mode]);
+    printf("persistent solver setup : %e s\n", setup_time);
+    printf("rhs only vs rebuild, relative solution difference : %e\n",
+        rhs_diff);
+    printf("in-place updates vs reassembly, relative difference : %e\n",
+        update_diff);
+  }
+}
+
+void probe_points(Mesh* mesh, const GridFunction& x, int npoints, int myid)
+{
+  const int sdim = mesh->SpaceDimension();
+  const int nthreads = max(1u, std::thread::hardware_concurrency());
+  const int nlinear = min(npoints, 1000);
+
+  Vector bb_min, bb_max;
+  mesh->GetBoundingBox(bb_min, bb_max, 1);
+  DenseMatrix pts(sdim, npoints);
+  srand(1);
+  for (int i = 0; i < npoints; i++)
+    for (int d = 0; d < sdim; d++)
+      pts(d, i) = bb_min(d) + (bb_max(d) - bb_min(d)) * rand() / RAND_MAX;
+
+  StopWatch sw_build;
+  sw_build.Start();
+  LG_PointLocator locator(mesh);
+  sw_build.Stop();
+
+  if (myid == 0) {
+    printf("bin grid of %d bins for %d elements built in %e s\n",
+        locator.GetNumBins(), mesh->GetNE(), sw_build.RealTime());
+    printf("search  threads    points     found  locate (pts/s)  "
+        "evaluate (pts/s)\n");
+  }
+  Array<int> elems;
+  Array<IntegrationPoint> ips;
+  DenseMatrix vals;
+  for (int nt = 1; ; nt = nthreads)
+  {
+    locator.SetNumThreads(nt);
+    StopWatch sw_locate, sw_eval;
+    sw_locate.Start();
+    const int found = locator.Locate(pts, elems, ips);
+    sw_locate.Stop();
+    sw_eval.Start();
+    locator.Evaluate(x, elems, ips, vals);
+    sw_eval.Stop();
+    if (myid == 0)
+      printf("bins    %7d  %8d  %8d  %e    %e\n", nt, npoints, found,
+          npoints / sw_locate.RealTime(), npoints / sw_eval.RealTime());
+    if (nt == nthreads)
+      break;
+  }
+
+  // linear search on the first points, checked against the bins
+  DenseMatrix pts_lin(sdim, nlinear), vals_lin;
+  for (int i = 0; i < nlinear; i++)
+    for (int d = 0; d < sdim; d++)
+      pts_lin(d, i) = pts(d, i);
+  Array<int> elems_lin;
+  Array<IntegrationPoint> ips_lin;
+  locator.SetNumThreads(1);
+  StopWatch sw_linear;
+  sw_linear.Start();
+  const int found_lin = locator.LocateLinear(pts_lin, elems_lin, ips_lin);
+  sw_linear.Stop();
+  locator.Evaluate(x, elems_lin, ips_lin, vals_lin);
+  double diff = 0.;
+  int mismatch = 0;
+  for (int i = 0; i < nlinear; i++)
+  {
+    diff = max(diff, fabs(vals_lin(0, i) - vals(0, i)));
+    mismatch += (elems_lin[i] < 0) != (elems[i] < 0);
+  }
+  if (myid == 0) {
+    printf("linear  %7d  %8d  %8d  %e\n", 1, nlinear, found_lin,
+        nlinear / sw_linear.RealTime());
+    printf("linear vs bins: %d points found by one only, max value "
+        "difference %e\n", mismatch, diff);
+  }
+}
+
+void centroid_monitoring(Mesh* mesh, FiniteElementSpace* fes,
+    const GridFunction& x, const char* file, int myid)
+{
+  const int ne = mesh->GetNE();
+  const int sdim = mesh->SpaceDimension();
+  const int nsteps = 100;
+
+  DenseMatrix pts(sdim, ne);
+  Vector c;
+  for (int e = 0; e < ne; e++)
+  {
+    ElementTransformation* T = mesh->GetElementTransformation(e);
+    T->Transform(Geometries.GetCenter(mesh->GetElementBaseGeometry(e)), c);
+    for (int d = 0; d < sdim; d++)
+      pts(d, e) = c(d);
+  }
+
+  // what the operator was built for
+  Vector key;
+  LG_InterpolationKey(*fes, pts, key);
+
+  StopWatch sw_setup;
+  sw_setup.Start();
+  SparseMatrix* P = LG_LoadInterpolation(key, fes->GetVSize(), file);
+  const bool loaded = P != NULL;
+  if (!loaded)
+  {
+    LG_PointLocator locator(mesh);
+    Array<int> elems;
+    Array<IntegrationPoint> ips;
+    locator.Locate(pts, elems, ips);
+    P = LG_InterpolationMatrix(*fes, elems, ips);
+    LG_SaveInterpolation(*P, key, file);
+  }
+  sw_setup.Stop();
+
+  // the solution changes every step
+  Vector u(x), samples(P->Height()), direct(ne);
+  StopWatch sw_spmv, sw_direct;
+  for (int step = 0; step < nsteps; step++)
+  {
+    u.Set(1. + 0.01 * step, x);
+    sw_spmv.Start();
+    P->Mult(u, samples);
+    sw_spmv.Stop();
+  }
+  GridFunction u_gf(fes);
+  for (int step = 0; step < nsteps; step++)
+  {
+    u_gf.Set(1. + 0.01 * step, x);
+    sw_direct.Start();
+    for (int e = 0; e < ne; e++)
+      direct(e) = u_gf.GetValue(e,
+          Geometries.GetCenter(mesh->GetElementBaseGeometry(e)));
+    sw_direct.Stop();
+  }
+  direct -= samples;
+
+  if (myid == 0) {
+    printf("interpolation operator %d x %d, %d nonzeros, %s %s in %e s\n",
+        P->Height(), P->Width(), P->NumNonZeroElems(),
+        loaded ? "read from" : "built and written to", file,
+        sw_setup.RealTime());
+    printf("per step: GetValue %e s, SpMV %e s, speedup %.2fx\n",
+        sw_direct.RealTime() / nsteps, sw_spmv.RealTime() / nsteps,
+        sw_direct.RealTime() / sw_spmv.RealTime());
+    printf("max difference of the samples %e\n", direct.Normlinf());
+  }
+  delete P;
+}
+
+void nested_iteration(const char* mesh_file, int mrefine, int order,
+    int btype, Coefficient& f, int myid)
+{
+  ConstantCoefficient one(1.0);
+  Mesh* mesh = read_mfem_mesh(mesh_file);
+  LG_FECollection fec(order, mesh->Dimension(), btype);
+  FiniteElementSpace fes(mesh, &fec);
+  GridFunction x(&fes);
+  x = 0.;
+  Array<int> ess_bdr(mesh->bdr_attributes.Size() ?
+      mesh->bdr_attributes.Max() : 0);
+  Array<int> ess_tdof_list;
+  ess_bdr = 1;
+
+  // The initial guess of level l carries the discretization error of level
+  // l-1, which is about 2^p times the one of level l (energy norm). Reducing
+  // the initial residual by theta 2^-p thus leaves an algebraic error of
+  // about theta times the discretization error of the level. The loaded mesh
+  // has no initial guess and its discretization error is not known; it only
+  // provides the guess of the next level and gets the same tolerance.
+  const double theta = 0.1;
+  const double level_tol = theta * pow(2., -order);
+
+  StopWatch sw_nested;
+  Vector X;
+  double final_norm = 0.;
+  if (myid == 0)
+    printf("level  unknowns   rel tol  warm its  cold its  saved  "
+        "solve (s)\n");
+  for (int l = 0; l <= mrefine; l++)
+  {
+    StopWatch sw_solve;
+    sw_nested.Start();
+    if (l > 0)
+    {
+      // interpolates the solution of the previous level
+      mesh->UniformRefinement();
+      fes.Update();
+      x.Update();
+    }
+    if (mesh->bdr_attributes.Size())
+      fes.GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+    LinearForm b(&fes);
+    BilinearForm a(&fes);
+    OperatorPtr A;
+    Vector B;
+    form_diffusion_system(&fec, one, f, ess_tdof_list, b, a, x, A, X, B);
+
+    GSSmoother M((SparseMatrix&)(*A));
+    CGSolver cg;
+    cg.iterative_mode = true;
+    setup_cg(cg, *A, M, level_tol);
+    sw_solve.Start();
+    cg.Mult(B, X);
+    sw_solve.Stop();
+    a.RecoverFEMSolution(X, b, x);
+    sw_nested.Stop();
+    final_norm = cg.GetFinalNorm();
+
+    // iterations from x = 0 down to the residual reached by the warm start
+    Vector X_cold(X.Size());
+    X_cold = 0.;
+    CGSolver cg_cold;
+    setup_cg(cg_cold, *A, M, 0.0);
+    cg_cold.SetAbsTol(cg.GetFinalNorm());
+    cg_cold.Mult(B, X_cold);
+
+    if (myid == 0)
+      printf("%5d  %8d  %8.2e  %8d  %8d  %5d  %e\n", l, A->Height(),
+          level_tol, cg.GetNumIterations(),
+          cg_cold.GetNumIterations(),
+          cg_cold.GetNumIterations() - cg.GetNumIterations(),
+          sw_solve.RealTime());
+  }
+
+  // cold start on the finest level down to the residual the nested
+  // iteration reached there, assembly included as above
+  StopWatch sw_cold;
+  sw_cold.Start();
+  GridFunction x_cold(&fes);
+  x_cold = 0.;
+  LinearForm b(&fes);
+  BilinearForm a(&fes);
+  OperatorPtr A_cold;
+  Vector B_cold, X_cold;
+  form_diffusion_system(&fec, one, f, ess_tdof_list, b, a, x_cold, A_cold,
+      X_cold, B_cold);
+  GSSmoother M((SparseMatrix&)(*A_cold));
+  CGSolver cg;
+  setup_cg(cg, *A_cold, M, 0.0);
+  cg.SetAbsTol(final_norm);
+  cg.Mult(B_cold, X_cold);
+  sw_cold.Stop();
+
+  // energy norm of the difference of the two finest answers
+  Vector AX(X.Size()), dX(X);
+  dX -= X_cold;
+  A_cold->Mult(dX, AX);
+  const double diff = sqrt(AX * dX);
+  A_cold->Mult(X_cold, AX);
+  const double norm = sqrt(AX * X_cold);
+
+  if (myid == 0) {
+    printf("nested iteration : %e s (all levels, assembly included)\n",
+        sw_nested.RealTime());
+    printf("cold start       : %e s (%d iterations on the finest level to "
+        "the same residual %e)\n", sw_cold.RealTime(), cg.GetNumIterations(),
+        final_norm);
+    printf("speedup %.2fx, relative energy norm difference %e\n",
+        sw_cold.RealTime() / sw_nested.RealTime(), diff / norm);
+  }
+  delete mesh;
+}
+
+void adaptive_refinement(const char* mesh_file, int order, int btype,
+    double target_error, Coefficient& f, int myid)
+{
+  ConstantCoefficient one(1.0);
+  const int max_dofs = 1000000;
+  int dofs[2];
+  double times[2];
+  bool reached[2];
+
+  if (myid == 0)
+    printf("refinement  step  unknowns  elements  estimate      time (s)\n");
+  for (int adaptive = 1; adaptive >= 0; adaptive--)
+  {
+    Mesh* mesh = read_mfem_mesh(mesh_file);
+    // quads and hexes are refined nonconformingly, simplices by bisection
+    if (adaptive)
+      mesh->EnsureNCMesh();
+    LG_FECollection fec(order, mesh->Dimension(), btype);
+    FiniteElementSpace fes(mesh, &fec);
+    GridFunction x(&fes);
+    Array<int> ess_bdr(mesh->bdr_attributes.Size() ?
+        mesh->bdr_attributes.Max() : 0);
+    Array<int> ess_tdof_list;
+    ess_bdr = 1;
+
+    // the smoothed flux lives in the vector LG space of the solution, which
+    // the estimator updates itself after every refinement
+    FiniteElementSpace flux_fes(mesh, &fec, mesh->SpaceDimension());
+    LG_DiffusionIntegrator flux_integ(one, &fec);
+    ZienkiewiczZhuEstimator estimator(flux_integ, x, flux_fes);
+    ThresholdRefiner refiner(estimator);
+    refiner.SetTotalErrorFraction(0.7);
+
+    StopWatch sw;
+    double error = 0.;
+    for (int step = 0; ; step++)
+    {
+      sw.Start();
+      if (mesh->bdr_attributes.Size())
+        fes.GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+      x = 0.;
+      LinearForm b(&fes);
+      BilinearForm a(&fes);
+      // with hanging nodes A = P^T K P over the conforming dofs
+      OperatorPtr A;
+      Vector B, X;
+      form_diffusion_system(&fec, one, f, ess_tdof_list, b, a, x, A, X, B);
+      GSSmoother M((SparseMatrix&)(*A));
+      CGSolver cg;
+      setup_cg(cg, *A, M, 1e-6);
+      cg.Mult(B, X);
+      a.RecoverFEMSolution(X, b, x);
+
+      // local errors are the energy norms of the flux jumps per element
+      error = estimator.GetLocalErrors().Norml2();
+      sw.Stop();
+      if (myid == 0)
+        printf("%-10s  %4d  %8d  %8d  %e  %e\n",
+            adaptive ? "adaptive" : "uniform", step, fes.GetTrueVSize(),
+            mesh->GetNE(), error, sw.RealTime());
+
+      reached[adaptive] = error <= target_error;
+      if (reached[adaptive] || fes.GetTrueVSize() > max_dofs)
+        break;
+      sw.Start();
+      if (adaptive)
+      {
+        refiner.Apply(*mesh);
+        if (refiner.Stop())
+        {
+          sw.Stop();
+          break;
+        }
+      }
+      else
+        mesh->UniformRefinement();
+      fes.Update();
+      x.Update();
+      sw.Stop();
+    }
+    dofs[adaptive] = fes.GetTrueVSize();
+    times[adaptive] = sw.RealTime();
+    delete mesh;
+  }
+
+  if (myid == 0) {
+    printf("target estimate %e\n", target_error);
+    for (int adaptive = 1; adaptive >= 0; adaptive--)
+      printf("%-8s : %8d unknowns, %e s%s\n",
+          adaptive ? "adaptive" : "uniform", dofs[adaptive], times[adaptive],
+          reached[adaptive] ? "" : " (target not reached)");
+    printf("unknowns ratio %.2fx, time ratio %.2fx\n",
+        double(dofs[0]) / dofs[1], times[0] / times[1]);
+  }
+}
+
+void compare_reordering(const char* mesh_file, int mrefine, int order,
+    int btype, Coefficient& f, int myid)
+{
+  ConstantCoefficient one(1.0), zero(0.0);
+  const int nmult = 20;
+  const double check_tol = 1e-4;
+  double norm[2], energy[2];
+
+  if (myid == 0)
+    printf("ordering    bandwidth  assembly (s)  SpMV (s)      PCG its  "
+        "PCG (s)\n");
+  for (int reordered = 0; reordered < 2; reordered++)
+  {
+    Mesh* mesh = read_mfem_mesh(mesh_file);
+    for (int i = 0; i < mrefine; i++)
+      mesh->UniformRefinement();
+    if (reordered)
+      LG_ReorderElements(mesh);
+    LG_FECollection fec(order, mesh->Dimension(), btype);
+    FiniteElementSpace fes(mesh, &fec);
+    if (reordered)
+      fes.ReorderElementToDofTable();
+    Array<int> ess_bdr(mesh->bdr_attributes.Size() ?
+        mesh->bdr_attributes.Max() : 0);
+    Array<int> ess_tdof_list;
+    if (mesh->bdr_attributes.Size())
+    {
+      ess_bdr = 1;
+      fes.GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+    }
+
+    StopWatch sw_asm, sw_spmv, sw_pcg;
+    sw_asm.Start();
+    LinearForm b(&fes);
+    BilinearForm a(&fes);
+    GridFunction x(&fes);
+    x = 0.;
+    OperatorPtr A;
+    Vector B, X;
+    form_diffusion_system(&fec, one, f, ess_tdof_list, b, a, x, A, X, B);
+    sw_asm.Stop();
+
+    SparseMatrix* A_s = A.As<SparseMatrix>();
+    SparseMatrix* A_rcm = NULL;
+    Array<int> rcm;
+    if (reordered)
+    {
+      LG_RCMOrdering(*A_s, rcm);
+      A_rcm = A_s = LG_PermuteMatrix(*A_s, rcm);
+      Vector tmp(B);
+      LG_PermuteVector(tmp, rcm, B);
+    }
+
+    Vector u(A_s->Width()), v(A_s->Height());
+    u = 1.;
+    sw_spmv.Start();
+    for (int i = 0; i < nmult; i++)
+      A_s->Mult(u, v);
+    sw_spmv.Stop();
+
+    GSSmoother M(*A_s);
+    CGSolver cg;
+    setup_cg(cg, *A_s, M, 1e-6);
+    X = 0.;
+    sw_pcg.Start();
+    cg.Mult(B, X);
+    sw_pcg.Stop();
+
+    // the dof numbers differ between the two runs, the energy and the L2
+    // norm of the solution must not
+    energy[reordered] = X * B;
+    if (reordered)
+    {
+      Vector tmp(X);
+      LG_UnpermuteVector(tmp, rcm, X);
+    }
+    a.RecoverFEMSolution(X, b, x);
+    norm[reordered] = x.ComputeL2Error(zero);
+
+    if (myid == 0)
+      printf("%-10s  %9d  %e  %e  %7d  %e\n",
+          reordered ? "SFC + RCM" : "mesh file", LG_Bandwidth(*A_s),
+          sw_asm.RealTime(), sw_spmv.RealTime() / nmult,
+          cg.GetNumIterations(), sw_pcg.RealTime());
+    delete A_rcm;
+    delete mesh;
+  }
+
+  const double norm_diff = fabs(norm[1] - norm[0]) / norm[0];
+  const double energy_diff = fabs(energy[1] - energy[0]) / fabs(energy[0]);
+  if (myid == 0)
+    printf("reordered vs file order, relative difference: L2 norm %e, "
+        "energy %e\n", norm_diff, energy_diff);
+  MFEM_VERIFY(norm_diff < check_tol && energy_diff < check_tol,
+      "the reordered solve does not match the file order one");
+}
+
+void compare_mixed_precision(const SparseMatrix& A, const Vector& B, int myid)
+{
+  const double rel_tol = 1e-12;
+  const long nnz = A.NumNonZeroElems();
+  const long double_bytes = nnz*(sizeof(double) + sizeof(int)) +
+                            (A.Height() + 1)*sizeof(int);
+  Vector X(A.Width()), R(A.Height());
+
+  // all double
+  StopWatch sw_double;
+  sw_double.Start();
+  GSSmoother M(A);
+  CGSolver cg;
+  setup_cg(cg, A, M, rel_tol);
+  X = 0.;
+  cg.Mult(B, X);
+  sw_double.Stop();
+  A.Mult(X, R);
+  R -= B;
+  const double double_res = R.Norml2() / B.Norml2();
+
+  // single precision operator and smoother, setup included
+  StopWatch sw_mixed;
+  sw_mixed.Start();
+  LG_MixedPrecisionSolver mp;
+  mp.SetRelTol(rel_tol);
+  mp.SetOperator(A);
+  X = 0.;
+  mp.Mult(B, X);
+  sw_mixed.Stop();
+
+  if (myid == 0) {
+    printf("precision  memory (MB)  SpMV (MB)  refinements  PCG its  "
+        "time (s)      rel residual\n");
+    printf("%-9s  %11.2f  %9.2f  %11d  %7d  %e  %e\n", "double",
+        double_bytes / 1048576., double_bytes / 1048576., 0,
+        cg.GetNumIterations(), sw_double.RealTime(), double_res);
+    printf("%-9s  %11.2f  %9.2f  %11d  %7d  %e  %e\n", "mixed",
+        mp.MemoryUsage() / 1048576., mp.GetInnerSpMVBytes() / 1048576.,
+        mp.GetNumRefinements(), mp.GetNumInnerIterations(),
+        sw_mixed.RealTime(), mp.GetFinalNorm() / B.Norml2());
+    printf("memory: matrix data held (the mixed solver keeps the double "
+        "values for the residuals next to the float ones); SpMV: bytes "
+        "read per PCG product\n");
+  }
+}
+
+void parallel_strong_scaling(Mesh* mesh, int order, int btype, int vrefine,
+    int myid, int num_procs)
+{
+  FunctionCoefficient f(source_term);
+  ConstantCoefficient one(1.0);
+  double t_one = 0.;
+
+  if (myid == 0)
+    printf("ranks  unknowns   partition (s)  assembly (s)   solve (s)     "
+        "its  speedup\n");
+  for (int np = 1; ; np = min(2*np, num_procs))
+  {
+    // ranks np, np+1, ... sit this run out
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, myid < np ? 0 : MPI_UNDEFINED, myid, &comm);
+    if (comm != MPI_COMM_NULL)
+    {
+      StopWatch sw_part, sw_asm, sw_solve;
+      sw_part.Start();
+      ParMesh pmesh(comm, *mesh);
+      sw_part.Stop();
+
+      LG_FECollection fec(order, pmesh.Dimension(), btype);
+      ParFiniteElementSpace pfes(&pmesh, &fec);
+      Array<int> ess_bdr(pmesh.bdr_attributes.Size() ?
+          pmesh.bdr_attributes.Max() : 0);
+      Array<int> ess_tdof_list;
+      if (pmesh.bdr_attributes.Size())
+      {
+        ess_bdr = 1;
+        pfes.GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+      }
+
+      sw_asm.Start();
+      ParLinearForm b(&pfes);
+      b.AddDomainIntegrator(new LG_DomainLFIntegrator(f, &fec));
+      b.Assemble();
+      ParGridFunction x(&pfes);
+      x = 0.;
+      ParBilinearForm a(&pfes);
+      a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, &fec));
+      a.Assemble();
+      OperatorPtr A(Operator::Hypre_ParCSR);
+      Vector B, X;
+      a.FormLinearSystem(ess_tdof_list, x, b, A, X, B);
+      sw_asm.Stop();
+
+      // the AMG setup runs in the first Mult, so it is part of the solve
+      sw_solve.Start();
+      HypreBoomerAMG amg(*A.As<HypreParMatrix>());
+      amg.SetPrintLevel(0);
+      CGSolver cg(comm);
+      setup_cg(cg, *A, amg, 1e-6, 500);
+      cg.Mult(B, X);
+      sw_solve.Stop();
+      a.RecoverFEMSolution(X, b, x);
+
+      // the slowest rank sets the time
+      double t_loc[3] = { sw_part.RealTime(), sw_asm.RealTime(),
+        sw_solve.RealTime() };
+      double t[3] = { 0., 0., 0. };
+      MPI_Reduce(t_loc, t, 3, MPI_DOUBLE, MPI_MAX, 0, comm);
+      if (np == 1)
+        t_one = t[1] + t[2];
+      if (myid == 0)
+        printf("%5d  %8d  %e  %e  %e  %5d  %7.2f\n", np,
+            int(pfes.GlobalTrueVSize()), t[0], t[1], t[2],
+            cg.GetNumIterations(), t_one / (t[1] + t[2]));
+
+      if (np == num_procs)
+      {
+        stringstream ss;
+        ss << "mesh_field_order_" << order << "." << setfill('0') << setw(6)
+           << myid << ".vtk";
+        ofstream ofs(ss.str().c_str());
+        pmesh.PrintVTK(ofs, vrefine);
+        x.SaveVTK(ofs, "field", vrefine);
+      }
+      MPI_Comm_free(&comm);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (np == num_procs)
+      break;
+  }
+}
+
+void compare_preconditioners(const char* mesh_file, int mrefine, int order,
+    int btype, bool geometric, Coefficient& f, int myid)
+{
+  ConstantCoefficient one(1.0);
+  Mesh* mesh = read_mfem_mesh(mesh_file);
+  Mesh coarse_mesh(*mesh);
+  LG_FECollection fec(order, mesh->Dimension(), btype);
+  const char* mg = geometric ? "GMG" : "pMG";
+
+  if (myid == 0)
+    printf("level  unknowns   GS its  GS solve (s)   %s its  %s setup (s)  "
+        "%s solve (s)\n", mg, mg, mg);
+  for (int l = 0; l <= mrefine; l++)
+  {
+    if (l > 0)
+      mesh->UniformRefinement();
+    FiniteElementSpace fes(mesh, &fec);
+    Array<int> ess_bdr(mesh->bdr_attributes.Size() ?
+        mesh->bdr_attributes.Max() : 0);
+    Array<int> ess_tdof_list;
+    if (mesh->bdr_attributes.Size())
+    {
+      ess_bdr = 1;
+      fes.GetEssentialTrueDofs(ess_bdr, ess_tdof_list);
+    }
+
+    LinearForm b(&fes);
+    BilinearForm a(&fes);
+    GridFunction x(&fes);
+    x = 0.;
+    OperatorPtr A;
+    Vector B, X, X0;
+    form_diffusion_system(&fec, one, f, ess_tdof_list, b, a, x, A, X, B);
+    X0 = X;
+
+    StopWatch sw_gs, sw_setup, sw_mg;
+    GSSmoother M_gs((SparseMatrix&)(*A));
+    CGSolver cg;
+    setup_cg(cg, *A, M_gs, 1e-6);
+    sw_gs.Start();
+    cg.Mult(B, X);
+    sw_gs.Stop();
+    const int gs_its = cg.GetNumIterations();
+
+    X = X0;
+    sw_setup.Start();
+    LG_Multigrid* M_mg;
+    if (geometric)
+      M_mg = new LG_GMultigrid(&fes, (SparseMatrix&)(*A), ess_bdr, one,
+          coarse_mesh, l);
+    else
+      M_mg = new LG_PMultigrid(&fes, (SparseMatrix&)(*A), ess_bdr, one);
+    sw_setup.Stop();
+    cg.SetPreconditioner(*M_mg);
+    sw_mg.Start();
+    cg.Mult(B, X);
+    sw_mg.Stop();
+    delete M_mg;
+
+    if (myid == 0)
+      printf("%5d  %8d  %7d  %e  %8d  %e  %e\n", l, A->Height(), gs_its,
+          sw_gs.RealTime(), cg.GetNumIterations(), sw_setup.RealTime(),
+          sw_mg.RealTime());
+  }
+  delete mesh;
+}
+
+void threaded_assembly(FiniteElementSpace* fes, LG_FECollection* fec,
+    Coefficient& f, int nthreads, SparseMatrix*& A, Vector& B, int myid)
+{
+  ConstantCoefficient one(1.0);
+  double t_one = 0.;
+
+  if (myid == 0)
+    printf("threads  colors   setup (s)   matrix (s)   rhs (s)   speedup\n");
+  for (int nt = 1; ; nt = min(2*nt, nthreads))
+  {
+    StopWatch sw_setup, sw_matrix, sw_rhs;
+    sw_setup.Start();
+    LG_ThreadedAssembler assembler(fes, nt);
+    sw_setup.Stop();
+
+    // integrators keep scratch data, so each thread gets its own
+    Array<BilinearFormIntegrator*> a_integs(nt);
+    Array<LinearFormIntegrator*> b_integs(nt);
+    for (int t = 0; t < nt; t++)
+    {
+      a_integs[t] = new LG_DiffusionIntegrator(one, fec);
+      b_integs[t] = new LG_DomainLFIntegrator(f, fec);
+    }
+
+    delete A;
+    sw_matrix.Start();
+    A = assembler.AssembleMatrix(a_integs);
+    sw_matrix.Stop();
+    sw_rhs.Start();
+    assembler.AssembleVector(b_integs, B);
+    sw_rhs.Stop();
+
+    for (int t = 0; t < nt; t++)
+    {
+      delete a_integs[t];
+      delete b_integs[t];
+    }
+
+    if (nt == 1)
+      t_one = sw_matrix.RealTime() + sw_rhs.RealTime();
+    if (myid == 0)
+      printf("%7d  %6d  %e  %e  %e  %7.2f\n", nt, assembler.GetNumColors(),
+          sw_setup.RealTime(), sw_matrix.RealTime(), sw_rhs.RealTime(),
+          t_one / (sw_matrix.RealTime() + sw_rhs.RealTime()));
+    if (nt == nthreads)
+      break;
+  }
+}
+
+void solve_mfem_pa(FiniteElementSpace* fes, LG_FECollection* fec,
+    const Array<int>& ess_tdof_list, LinearForm& b, GridFunction& x,
+    int myid)
+{
+  // MFEM's tensor kernels take the lexicographic order of the element dofs
+  // from the dof map of the collection's tensor elements
+  const FiniteElement* fe = fes->GetFE(0);
+  MFEM_VERIFY(dynamic_cast<const TensorBasisElement*>(fe),
+      "MFEM partial assembly requires a quad or hex mesh");
+
+  // ElementRestriction reads TensorBasisElement::GetDofMap, never the
+  // collection's GetDofMap: check that both give the same permutation
+  const Geometry::Type tensor_geoms[] =
+    { Geometry::SEGMENT, Geometry::SQUARE, Geometry::CUBE };
+  for (int g = 0; g < 3; g++)
+  {
+    const Geometry::Type geom = tensor_geoms[g];
+    const FiniteElement* gfe = fec->FiniteElementForGeometry(geom);
+    if (!gfe)
+      continue;
+    const TensorBasisElement* tfe =
+      dynamic_cast<const TensorBasisElement*>(gfe);
+    MFEM_VERIFY(tfe, Geometry::Name[geom] << " element is not a tensor one");
+    const Array<int>& elem_map = tfe->GetDofMap();
+    const int* fec_map = fec->GetDofMap(geom);
+    const int nd = gfe->GetDof();
+    MFEM_VERIFY(elem_map.Size() == nd, Geometry::Name[geom]
+        << " element has " << elem_map.Size() << " dof map entries for "
+        << nd << " dofs");
+    Array<int> seen(nd);
+    seen = 0;
+    for (int i = 0; i < nd; i++)
+    {
+      MFEM_VERIFY(fec_map[i] == elem_map[i], Geometry::Name[geom]
+          << " dof map differs at entry " << i << ": collection "
+          << fec_map[i] << ", element " << elem_map[i]);
+      MFEM_VERIFY(0 <= fec_map[i] && fec_map[i] < nd && !seen[fec_map[i]],
+          Geometry::Name[geom] << " dof map is not a permutation");
+      seen[fec_map[i]] = 1;
+    }
+  }
+
+  ConstantCoefficient one(1.0);
+  BilinearForm a_pa(fes);
+  a_pa.SetAssemblyLevel(AssemblyLevel::PARTIAL);
+  a_pa.AddDomainIntegrator(new DiffusionIntegrator(one));
+  StopWatch sw_setup;
+  sw_setup.Start();
+  a_pa.Assemble();
+  sw_setup.Stop();
+
+  OperatorPtr A_pa;
+  Vector B, X;
+  a_pa.FormLinearSystem(ess_tdof_list, x, b, A_pa, X, B);
+  OperatorJacobiSmoother M(a_pa, ess_tdof_list);
+  PCG(*A_pa, M, B, X, 1, 200, 1e-12, 0.0);
+  a_pa.RecoverFEMSolution(X, b, x);
+
+  // the assembled matrix, only built now for the comparison
+  BilinearForm a(fes);
+  a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+  a.Assemble();
+  a.Finalize();
+  const SparseMatrix& A = a.SpMat();
+
+  const int nmult = 20;
+  Vector u(A.Width()), v(A.Height());
+  u = 1.;
+  StopWatch sw_fa, sw_pa;
+  sw_fa.Start();
+  for (int i = 0; i < nmult; i++)
+    A.Mult(u, v);
+  sw_fa.Stop();
+  sw_pa.Start();
+  for (int i = 0; i < nmult; i++)
+    a_pa.Mult(u, v);
+  sw_pa.Stop();
+
+  const double t_fa = sw_fa.RealTime() / nmult;
+  const double t_pa = sw_pa.RealTime() / nmult;
+  if (myid == 0) {
+    printf("MFEM partial assembly setup : %e s\n", sw_setup.RealTime());
+    printf("assembled  : %e s per Mult, %8.2f MDofs/s\n",
+        t_fa, A.Height() / t_fa / 1.e6);
+    printf("MFEM PA    : %e s per Mult, %8.2f MDofs/s\n",
+        t_pa, A.Height() / t_pa / 1.e6);
+  }
+}
+
+void write_lagrange_cells(const GridFunction& gf, const string& file,
+    long ref_bytes, double ref_time, int myid)
+{
+  StopWatch sw;
+  sw.Start();
+  LG_VTKWriter writer(gf.FESpace());
+  ofstream ofs(file.c_str());
+  writer.PrintMesh(ofs);
+  writer.SaveField(ofs, gf, "field");
+  const long bytes = ofs.tellp();
+  ofs.close();
+  sw.Stop();
+
+  if (myid == 0)
+  {
+    printf("VTK refined  : %10.3f MB, %e s\n", ref_bytes/1.e6, ref_time);
+    printf("VTK Lagrange : %10.3f MB, %e s (%d points, %s)\n", bytes/1.e6,
+        sw.RealTime(), writer.GetNPoints(), file.c_str());
+  }
+}
+
+Mesh* read_mfem_mesh(const char* mesh_file)
+{
+  // read the mesh and solution files
+  named_ifgzstream meshin(mesh_file);
+  if (!meshin)
+  {
+    cerr << "Can not open mesh file " << mesh_file << ". Exit.\n";
+    exit(1);
+  }
+
+  Mesh* mesh = new Mesh(meshin, 1, 0, false);
+  return mesh;
+}
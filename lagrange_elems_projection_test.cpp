@@ -1,9 +1,14 @@
 #include <mfem.hpp>
 #include <fstream>
 #include <iostream>
+#include <iomanip>
 #include <queue>
 
 #include "LagrangeElements.hpp"
+#include "LagrangeIntegrators.hpp"
+#include "LagrangeErrorNorms.hpp"
+#include "LagrangeProjection.hpp"
+#include "LagrangeVTK.hpp"
 
 using namespace std;
 using namespace mfem;
@@ -11,9 +16,47 @@ using namespace mfem;
 
 // for testing
 void VField_exact(const Vector &x, Vector &E);
+void VField_grad_exact(const Vector &x, DenseMatrix &G);
+// VField_exact at npts points in sdim dimensions, structures of arrays
+void VField_exact_batch(int sdim, int npts, const double *x, double *E);
 
 Mesh* read_mfem_mesh(const char* mesh_file);
 
+// evaluate gf at the visualization points of every element with per-point
+// CalcShape/CalcDShape calls and with batched shape tables, and report the
+// timings of both together with the max error against VField_exact; on a
+// ParFiniteElementSpace the errors and times are reduced over the ranks
+void compare_shape_evaluation(FiniteElementSpace* fes, GridFunction& gf,
+    int vrefine, int myid);
+
+// assemble a scalar diffusion matrix on mesh with fec and report the time
+// per element, e.g. to compare the 2D and 3D assembly costs; a ParMesh is
+// assembled in parallel into a HypreParMatrix
+void time_diffusion_assembly(Mesh* mesh, LG_FECollection* fec, int myid);
+
+// project VField_exact onto gf with GridFunction::ProjectCoefficient
+// (one call per node of every element) and with LG_ProjectCoefficient (one
+// batched call for all the dofs) and print the function calls, the times
+// and the difference of the two; gf keeps the batched projection
+void compare_projection(GridFunction& gf, int myid);
+
+// L2, H1 seminorm and max norm errors of gf against VField_exact with
+// LG_ErrorNorms on nthreads threads, summed over the ranks of a
+// ParFiniteElementSpace; returns the time of the local computation
+double compute_errors(GridFunction& gf, int nthreads, double& l2, double& h1,
+    double& max_err, Vector* elem_l2 = NULL);
+
+// project VField_exact on the mesh refined 0, ..., mrefine times for the
+// orders 1, ..., order and print the errors and convergence rates
+void convergence_study(const char* mesh_file, int mrefine, int order,
+    int btype, int nthreads, int myid);
+
+// write the mesh and gf as one VTK Lagrange cell per element with
+// LG_VTKWriter to file and print its size and write time next to those of
+// the output subdivided for vrefine (ref_bytes, ref_time)
+void write_lagrange_cells(const GridFunction& gf, const string& file,
+    long ref_bytes, double ref_time, int myid);
+
 int main(int argc, char *argv[])
 {
   int num_procs, myid;
@@ -25,6 +68,13 @@ int main(int argc, char *argv[])
   int vrefine = 1;
   int mrefine = 0;
   int order  = 1;
+  bool serendipity = false;
+  bool parallel = false;
+  int nthreads = 1;
+  bool study = false;
+  bool batched = false;
+  bool lagrange_cells = false;
+  bool shape_bench = false;
 
   OptionsParser args(argc, argv);
   args.AddOption(&mfem_mesh_file, "-m", "--mesh",
@@ -34,7 +84,25 @@ int main(int argc, char *argv[])
   args.AddOption(&mrefine, "-mr", "--mrefine",
       "Refinement level used to refine mesh after loading it");
   args.AddOption(&order, "-o", "--order",
-      "Order for Lagrange Elements 1 or 2");
+      "Order for Lagrange Elements (1 to 10)");
+  args.AddOption(&serendipity, "-ser", "--serendipity", "-no-ser",
+      "--no-serendipity", "Use the serendipity quad (2D only)");
+  args.AddOption(&parallel, "-par", "--parallel", "-no-par", "--no-parallel",
+      "Partition the mesh (ParMesh) and work on the local elements");
+  args.AddOption(&nthreads, "-nt", "--threads",
+      "Number of threads computing the error norms");
+  args.AddOption(&study, "-cs", "--convergence-study", "-no-cs",
+      "--no-convergence-study", "Print the errors and rates for the orders "
+      "up to --order and the refinements up to --mrefine");
+  args.AddOption(&batched, "-bp", "--batched-projection", "-no-bp",
+      "--no-batched-projection", "Project with one batched coefficient "
+      "call for all the dofs and compare with ProjectCoefficient");
+  args.AddOption(&lagrange_cells, "-lc", "--lagrange-cells", "-no-lc",
+      "--no-lagrange-cells", "Also write the field as VTK Lagrange cells "
+      "of the element order (1D and 2D, no serendipity)");
+  args.AddOption(&shape_bench, "-se", "--shape-evaluation", "-no-se",
+      "--no-shape-evaluation", "Time the pointwise and the batched shape "
+      "evaluation at the visualization points");
   args.Parse();
   if (!args.Good())
   {
@@ -49,34 +117,86 @@ int main(int argc, char *argv[])
   {
     args.PrintOptions(cout);
   }
+  MFEM_VERIFY(nthreads >= 1, "at least one thread is needed");
+  MFEM_VERIFY(!study || !parallel,
+      "the convergence study runs on the serial mesh");
+  MFEM_VERIFY(!lagrange_cells || !serendipity,
+      "serendipity elements have no VTK Lagrange cell");
+  const int btype = serendipity ? BasisType::Serendipity :
+                    BasisType::GaussLobatto;
 
   Mesh* mfem_mesh = read_mfem_mesh(mfem_mesh_file);
 
   for (int i = 0; i < mrefine; i++)
     mfem_mesh->UniformRefinement();
 
+  // every rank works on its part of the mesh only
+  if (parallel)
+  {
+    Mesh* serial_mesh = mfem_mesh;
+    mfem_mesh = new ParMesh(MPI_COMM_WORLD, *serial_mesh);
+    delete serial_mesh;
+  }
+
   int dim  = mfem_mesh->Dimension();
   int sdim = mfem_mesh->SpaceDimension();
 
-  FiniteElementCollection *fec = new LG_FECollection(order, dim);
-  FiniteElementSpace *fes = new FiniteElementSpace(mfem_mesh, fec, sdim);
+  LG_FECollection *fec = new LG_FECollection(order, dim, btype);
+  FiniteElementSpace *fes = parallel ?
+    new ParFiniteElementSpace((ParMesh*)mfem_mesh, fec, sdim) :
+    new FiniteElementSpace(mfem_mesh, fec, sdim);
 
 
   GridFunction gf(fes);
   VectorFunctionCoefficient E(sdim, VField_exact);
-  gf.ProjectCoefficient(E);
+  if (batched)
+    compare_projection(gf, myid);
+  else
+    gf.ProjectCoefficient(E);
+
+  if (shape_bench)
+    compare_shape_evaluation(fes, gf, vrefine, myid);
+  time_diffusion_assembly(mfem_mesh, fec, myid);
+
+  // quadrature errors, with the L2 error of every element for the output
+  L2_FECollection fec_elem(0, dim);
+  FiniteElementSpace fes_elem(mfem_mesh, &fec_elem);
+  GridFunction elem_error(&fes_elem);
+  double l2, h1, max_err;
+  const double t_err = compute_errors(gf, nthreads, l2, h1, max_err,
+      &elem_error);
+  if (myid == 0)
+    printf("errors (%d threads, %e s): L2 %e, H1 seminorm %e, max %e\n",
+        nthreads, t_err, l2, h1, max_err);
+  if (study)
+    convergence_study(mfem_mesh_file, mrefine, order, btype, nthreads, myid);
 
+  stringstream rank;
+  if (parallel)
+    rank << "." << setfill('0') << setw(6) << myid;
   stringstream ss;
-  ss << "mesh_field_order_" << order << ".vtk";
+  ss << "mesh_field_order_" << order << rank.str() << ".vtk";
+  StopWatch sw_vtk;
+  sw_vtk.Start();
   ofstream ofs;
   ofs.open(ss.str().c_str(), ofstream::out);
   mfem_mesh->PrintVTK(ofs, vrefine);
   gf.SaveVTK(ofs, "field", vrefine);
+  elem_error.SaveVTK(ofs, "l2_error", vrefine);
+  const long vtk_bytes = ofs.tellp();
   ofs.close();
+  sw_vtk.Stop();
+  if (lagrange_cells)
+  {
+    stringstream ss_lc;
+    ss_lc << "mesh_field_order_" << order << "_lagrange" << rank.str()
+          << ".vtk";
+    write_lagrange_cells(gf, ss_lc.str(), vtk_bytes, sw_vtk.RealTime(), myid);
+  }
 
   /* delete grid_f; */
-  delete mfem_mesh;
   delete fes;
+  delete mfem_mesh;
   delete fec;
   MPI_Finalize();
 
@@ -87,6 +207,291 @@ void VField_exact(const Vector &x, Vector &E)
 {
   E(0) = 100. * x(0) * x(0);
   E(1) =  50. * x(0) * x(1);
+  if (x.Size() == 3)
+    E(2) =  25. * x(1) * x(2);
+}
+
+// G(i,j) = d E(i) / d x(j)
+void VField_grad_exact(const Vector &x, DenseMatrix &G)
+{
+  G = 0.;
+  G(0,0) = 200. * x(0);
+  G(1,0) =  50. * x(1);
+  G(1,1) =  50. * x(0);
+  if (x.Size() == 3)
+  {
+    G(2,1) = 25. * x(2);
+    G(2,2) = 25. * x(1);
+  }
+}
+
+void VField_exact_batch(int sdim, int npts, const double *x, double *E)
+{
+  const double *x0 = x, *x1 = x + npts, *x2 = x + 2*npts;
+  for (int i = 0; i < npts; i++)
+  {
+    E[i]        = 100. * x0[i] * x0[i];
+    E[npts + i] =  50. * x0[i] * x1[i];
+  }
+  if (sdim == 3)
+    for (int i = 0; i < npts; i++)
+      E[2*npts + i] = 25. * x1[i] * x2[i];
+}
+
+void compare_projection(GridFunction& gf, int myid)
+{
+  FiniteElementSpace* fes = gf.FESpace();
+  const int sdim = fes->GetMesh()->SpaceDimension();
+
+  // per element, counting the calls of the user function
+  long calls = 0;
+  VectorFunctionCoefficient E(sdim, [&calls](const Vector& x, Vector& v)
+      { calls++; VField_exact(x, v); });
+  GridFunction gf_elem(fes);
+  StopWatch sw_elem, sw_batch;
+  sw_elem.Start();
+  gf_elem.ProjectCoefficient(E);
+  sw_elem.Stop();
+
+  LG_BatchVectorCoefficient E_batch(sdim,
+      [sdim](int npts, const double* x, double* v)
+      { VField_exact_batch(sdim, npts, x, v); });
+  sw_batch.Start();
+  LG_ProjectCoefficient(E_batch, gf);
+  sw_batch.Stop();
+
+  gf_elem -= gf;
+  double diff = gf_elem.Normlinf();
+  long batch_calls = E_batch.GetNumCalls();
+  long batch_points = E_batch.GetNumPoints();
+  double t_elem = sw_elem.RealTime();
+  double t_batch = sw_batch.RealTime();
+  ParFiniteElementSpace* pfes = dynamic_cast<ParFiniteElementSpace*>(fes);
+  if (pfes) {
+    MPI_Comm comm = pfes->GetComm();
+    MPI_Allreduce(MPI_IN_PLACE, &calls, 1, MPI_LONG, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &batch_calls, 1, MPI_LONG, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &batch_points, 1, MPI_LONG, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &diff, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &t_elem, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &t_batch, 1, MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  if (myid == 0) {
+    printf("ProjectCoefficient    : %ld function calls, %e s\n", calls,
+        t_elem);
+    printf("LG_ProjectCoefficient : %ld batched calls of %ld points, %e s\n",
+        batch_calls, batch_points, t_batch);
+    printf("speedup %.2fx, %.2fx fewer points, max difference %e\n",
+        t_elem / t_batch, double(calls) / batch_points, diff);
+  }
+}
+
+double compute_errors(GridFunction& gf, int nthreads, double& l2, double& h1,
+    double& max_err, Vector* elem_l2)
+{
+  const int sdim = gf.FESpace()->GetMesh()->SpaceDimension();
+  VectorFunctionCoefficient E(sdim, VField_exact);
+  MatrixFunctionCoefficient G(sdim, VField_grad_exact);
+
+  StopWatch sw;
+  sw.Start();
+  LG_ErrorNorms norms(gf, nthreads);
+  norms.Compute(E, &G);
+  sw.Stop();
+  if (elem_l2)
+    *elem_l2 = norms.GetElementL2Errors();
+
+  l2 = norms.GetL2Error() * norms.GetL2Error();
+  h1 = norms.GetH1SemiError() * norms.GetH1SemiError();
+  max_err = norms.GetMaxError();
+  double t = sw.RealTime();
+  ParFiniteElementSpace* pfes =
+    dynamic_cast<ParFiniteElementSpace*>(gf.FESpace());
+  if (pfes) {
+    MPI_Comm comm = pfes->GetComm();
+    MPI_Allreduce(MPI_IN_PLACE, &l2, 1, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &h1, 1, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &max_err, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+  }
+  l2 = sqrt(l2);
+  h1 = sqrt(h1);
+  return t;
+}
+
+void convergence_study(const char* mesh_file, int mrefine, int order,
+    int btype, int nthreads, int myid)
+{
+  if (myid == 0)
+    printf("order  refine  elements  L2 error      rate   H1 error      "
+        "rate   max error     time (s)\n");
+  for (int p = 1; p <= order; p++)
+  {
+    Mesh* mesh = read_mfem_mesh(mesh_file);
+    const int sdim = mesh->SpaceDimension();
+    LG_FECollection fec(p, mesh->Dimension(), btype);
+    double l2_prev = 0., h1_prev = 0.;
+    for (int r = 0; r <= mrefine; r++)
+    {
+      if (r > 0)
+        mesh->UniformRefinement();
+      FiniteElementSpace fes(mesh, &fec, sdim);
+      GridFunction gf(&fes);
+      VectorFunctionCoefficient E(sdim, VField_exact);
+      gf.ProjectCoefficient(E);
+
+      double l2, h1, max_err;
+      const double t = compute_errors(gf, nthreads, l2, h1, max_err);
+      // h halves with every refinement
+      const double l2_rate = (r > 0) ? log2(l2_prev / l2) : 0.;
+      const double h1_rate = (r > 0) ? log2(h1_prev / h1) : 0.;
+      if (myid == 0)
+        printf("%5d  %6d  %8d  %e  %5.2f  %e  %5.2f  %e  %e\n", p, r,
+            mesh->GetNE(), l2, l2_rate, h1, h1_rate, max_err, t);
+      l2_prev = l2;
+      h1_prev = h1;
+    }
+    delete mesh;
+  }
+}
+
+void compare_shape_evaluation(FiniteElementSpace* fes, GridFunction& gf,
+    int vrefine, int myid)
+{
+  Mesh* mesh = fes->GetMesh();
+  int sdim = mesh->SpaceDimension();
+  int vdim = fes->GetVDim();
+
+  StopWatch sw_point, sw_batch;
+  LG_ShapeTable table;
+  Array<int> vdofs;
+  Vector dofs, shape, x(sdim), E(vdim);
+  DenseMatrix dshape;
+  double checksum = 0.;
+  double max_error = 0.;
+
+  for (int i = 0; i < mesh->GetNE(); i++) {
+    const FiniteElement* fe = fes->GetFE(i);
+    int nd = fe->GetDof();
+    RefinedGeometry* RefG =
+      GlobGeometryRefiner.Refine(fe->GetGeomType(), vrefine);
+    const IntegrationRule& ir = RefG->RefPts;
+
+    shape.SetSize(nd);
+    dshape.SetSize(nd, fe->GetDim());
+    sw_point.Start();
+    for (int q = 0; q < ir.GetNPoints(); q++) {
+      fe->CalcShape(ir.IntPoint(q), shape);
+      fe->CalcDShape(ir.IntPoint(q), dshape);
+      checksum += shape(0) + dshape(0,0);
+    }
+    sw_point.Stop();
+
+    sw_batch.Start();
+    LG_CalcShapeTable(*fe, ir, table);
+    sw_batch.Stop();
+
+    fes->GetElementVDofs(i, vdofs);
+    gf.GetSubVector(vdofs, dofs);
+    ElementTransformation* T = fes->GetElementTransformation(i);
+    for (int q = 0; q < ir.GetNPoints(); q++) {
+      T->Transform(ir.IntPoint(q), x);
+      VField_exact(x, E);
+      const double* s = table.GetShape(q);
+      for (int c = 0; c < vdim; c++) {
+        double val = 0.;
+        for (int k = 0; k < nd; k++)
+          val += dofs(c*nd + k) * s[k];
+        max_error = max(max_error, fabs(val - E(c)));
+      }
+    }
+  }
+
+  double t_point = sw_point.RealTime();
+  double t_batch = sw_batch.RealTime();
+  ParFiniteElementSpace* pfes = dynamic_cast<ParFiniteElementSpace*>(fes);
+  if (pfes) {
+    MPI_Comm comm = pfes->GetComm();
+    MPI_Allreduce(MPI_IN_PLACE, &max_error, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &checksum, 1, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &t_point, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &t_batch, 1, MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  if (myid == 0) {
+    printf("shape evaluation (per-point) : %e s\n", t_point);
+    printf("shape evaluation (batched)   : %e s\n", t_batch);
+    printf("max error at visualization points is %e (checksum %e)\n",
+        max_error, checksum);
+  }
+}
+
+void time_diffusion_assembly(Mesh* mesh, LG_FECollection* fec, int myid)
+{
+  ConstantCoefficient one(1.0);
+  ParMesh* pmesh = dynamic_cast<ParMesh*>(mesh);
+  long ne = mesh->GetNE();
+  long ndofs;
+  double t;
+
+  StopWatch sw;
+  if (pmesh)
+  {
+    ParFiniteElementSpace pfes(pmesh, fec);
+    ParBilinearForm a(&pfes);
+    a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+    sw.Start();
+    a.Assemble();
+    a.Finalize();
+    HypreParMatrix* A = a.ParallelAssemble();
+    sw.Stop();
+    delete A;
+
+    t = sw.RealTime();
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, pmesh->GetComm());
+    ne = pmesh->GetGlobalNE();
+    ndofs = pfes.GlobalTrueVSize();
+  }
+  else
+  {
+    FiniteElementSpace fes(mesh, fec);
+    BilinearForm a(&fes);
+    a.AddDomainIntegrator(new LG_DiffusionIntegrator(one, fec));
+    sw.Start();
+    a.Assemble();
+    a.Finalize();
+    sw.Stop();
+
+    t = sw.RealTime();
+    ndofs = fes.GetVSize();
+  }
+
+  if (myid == 0) {
+    printf("diffusion assembly (%dD, %ld elements, %ld dofs) : %e s"
+        " (%e s per element)\n", mesh->Dimension(), ne, ndofs, t, t/ne);
+  }
+}
+
+void write_lagrange_cells(const GridFunction& gf, const string& file,
+    long ref_bytes, double ref_time, int myid)
+{
+  StopWatch sw;
+  sw.Start();
+  LG_VTKWriter writer(gf.FESpace());
+  ofstream ofs(file.c_str());
+  writer.PrintMesh(ofs);
+  writer.SaveField(ofs, gf, "field");
+  const long bytes = ofs.tellp();
+  ofs.close();
+  sw.Stop();
+
+  if (myid == 0)
+  {
+    printf("VTK refined  : %10.3f MB, %e s\n", ref_bytes/1.e6, ref_time);
+    printf("VTK Lagrange : %10.3f MB, %e s (%d points, %s)\n", bytes/1.e6,
+        sw.RealTime(), writer.GetNPoints(), file.c_str());
+  }
 }
 
 Mesh* read_mfem_mesh(const char* mesh_file)